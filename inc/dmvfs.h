@@ -4,6 +4,346 @@
 #include "dmod.h"
 #include "dmfsi.h"
 
+/**
+ * @brief Monotonic clock source in microseconds
+ *
+ * DMOD does not provide a portable time base, so the features that measure
+ * time (e.g. tracing) use the clock registered with dmvfs_set_clock().
+ */
+typedef uint64_t (*dmvfs_clock_t)(void);
+
+/**
+ * @brief Function that blocks the calling thread for a time in microseconds
+ *
+ * DMOD does not provide a portable way to sleep either, so the features that
+ * have to wait (e.g. throttling) use the function registered with
+ * dmvfs_set_sleep(). It can sleep longer, but must not return earlier.
+ */
+typedef void (*dmvfs_sleep_t)(uint64_t us);
+
+/**
+ * @brief Function that returns the ID of the calling process
+ *
+ * DMOD does not tell which process is calling either. With the function
+ * registered by dmvfs_set_getpid(), every call that accepts a path resolves
+ * relative paths against the working directory of the calling process.
+ */
+typedef int (*dmvfs_getpid_t)(void);
+
+/**
+ * @brief Operation codes stored in the trace ring buffer
+ */
+typedef enum
+{
+    DMVFS_TRACE_OP_NONE = 0,
+    DMVFS_TRACE_OP_FOPEN,
+    DMVFS_TRACE_OP_FCLOSE,
+    DMVFS_TRACE_OP_FREAD,
+    DMVFS_TRACE_OP_FWRITE,
+    DMVFS_TRACE_OP_LSEEK,
+    DMVFS_TRACE_OP_FTELL,
+    DMVFS_TRACE_OP_FEOF,
+    DMVFS_TRACE_OP_FFLUSH,
+    DMVFS_TRACE_OP_ERROR,
+    DMVFS_TRACE_OP_REMOVE,
+    DMVFS_TRACE_OP_RENAME,
+    DMVFS_TRACE_OP_IOCTL,
+    DMVFS_TRACE_OP_SYNC,
+    DMVFS_TRACE_OP_STAT,
+    DMVFS_TRACE_OP_GETC,
+    DMVFS_TRACE_OP_PUTC,
+    DMVFS_TRACE_OP_CHMOD,
+    DMVFS_TRACE_OP_UTIME,
+    DMVFS_TRACE_OP_UNLINK,
+    DMVFS_TRACE_OP_MKDIR,
+    DMVFS_TRACE_OP_RMDIR,
+    DMVFS_TRACE_OP_CHDIR,
+    DMVFS_TRACE_OP_OPENDIR,
+    DMVFS_TRACE_OP_READDIR,
+    DMVFS_TRACE_OP_CLOSEDIR,
+    DMVFS_TRACE_OP_DIREXISTS,
+
+    DMVFS_TRACE_OP_COUNT
+} dmvfs_trace_op_t;
+
+/**
+ * @brief Single record of the trace ring buffer
+ *
+ * The layout is fixed (no implicit padding) because the records are also
+ * the payload of trace files written by dmvfs_trace_save().
+ */
+typedef struct
+{
+    uint64_t timestamp;     //!< Clock value when the backend call started
+    uint32_t sequence;      //!< Global sequence number of the record
+    uint32_t duration;      //!< Duration of the backend call
+    int32_t  pid;           //!< Process ID (-1 for path based operations)
+    uint16_t op;            //!< dmvfs_trace_op_t
+    int16_t  mount_index;   //!< Index of the mount point (-1 if unknown)
+    int32_t  handle;        //!< Index of the file entry (-1 if none)
+    union
+    {
+        uint32_t size;      //!< Requested size
+        int32_t  offset;    //!< Requested offset (lseek only)
+    };
+    int32_t  arg;           //!< Transferred bytes, open mode or whence
+    int32_t  result;        //!< Result returned by the backend
+} dmvfs_trace_entry_t;
+
+#define DMVFS_TRACE_MAGIC       0x54564D44u     //!< "DMVT"
+#define DMVFS_TRACE_VERSION     1
+
+/**
+ * @brief Header of a trace file written by dmvfs_trace_save()
+ */
+typedef struct
+{
+    uint32_t magic;         //!< DMVFS_TRACE_MAGIC
+    uint16_t version;       //!< DMVFS_TRACE_VERSION
+    uint16_t entry_size;    //!< sizeof(dmvfs_trace_entry_t)
+    uint32_t count;         //!< Number of records following the header
+    uint32_t dropped;       //!< Records overwritten before they were saved
+} dmvfs_trace_header_t;
+
+/**
+ * @brief Statistics of the DMVFS internal allocator
+ */
+typedef struct
+{
+    size_t arena_size;          //!< Size of the arena (0 when the heap is used)
+    size_t arena_used;          //!< Bytes of the arena already carved into blocks
+    size_t slab_pages;          //!< Number of slab pages for small blocks
+    size_t heap_bytes;          //!< Bytes of big blocks taken directly from the heap
+    size_t used_bytes;          //!< Bytes of blocks currently in use
+    size_t peak_used_bytes;     //!< Highest value of used_bytes
+    size_t used_blocks;         //!< Number of blocks currently in use
+    uint32_t allocations;       //!< Total number of allocations
+    uint32_t failures;          //!< Number of failed allocations
+} dmvfs_alloc_stats_t;
+
+#define DMVFS_CAP_THREAD_SAFE       0x00000001u     //!< Backend is reentrant - DMVFS does not serialize calls to it
+#define DMVFS_CAP_ALIGNED_IO        0x00000002u     //!< Backend needs aligned buffers - DMVFS stages unaligned transfers
+
+/**
+ * @brief Open a file relative to a directory handle of the backend
+ */
+typedef int (*dmvfs_openat_t)(dmfsi_context_t ctx, void* dir, void** fp, const char* path, int mode, int attr);
+
+/**
+ * @brief Get file information relative to a directory handle of the backend
+ */
+typedef int (*dmvfs_statat_t)(dmfsi_context_t ctx, void* dir, const char* path, dmfsi_stat_t* stat);
+
+/**
+ * @brief Create a directory relative to a directory handle of the backend
+ */
+typedef int (*dmvfs_mkdirat_t)(dmfsi_context_t ctx, void* dir, const char* path, int mode);
+
+/**
+ * @brief Replace the content of a file atomically in the backend
+ */
+typedef int (*dmvfs_write_atomic_t)(dmfsi_context_t ctx, const char* path, const void* data, size_t size);
+
+/**
+ * @brief Transfer data between two open files of the backend
+ */
+typedef int (*dmvfs_sendfile_t)(dmfsi_context_t ctx, void* out_fp, void* in_fp, size_t count, size_t* sent);
+
+/**
+ * @brief Read the next entry of an open directory of the backend whose name starts with a prefix
+ */
+typedef int (*dmvfs_readdir_prefix_t)(dmfsi_context_t ctx, void* dir, const char* prefix, dmfsi_dir_entry_t* entry);
+
+/**
+ * @brief Capabilities and optional operations of a mounted file system
+ */
+typedef struct
+{
+    uint32_t caps;                         //!< DMVFS_CAP_* flags
+    uint32_t alignment;                    //!< Buffer alignment needed by the backend (power of 2, with DMVFS_CAP_ALIGNED_IO)
+    dmvfs_openat_t openat;                 //!< Optional: open a file relative to an open directory
+    dmvfs_statat_t statat;                 //!< Optional: stat a path relative to an open directory
+    dmvfs_mkdirat_t mkdirat;               //!< Optional: create a directory relative to an open directory
+    dmvfs_write_atomic_t write_atomic;     //!< Optional: replace the content of a file atomically
+    dmvfs_sendfile_t sendfile;             //!< Optional: transfer data between two open files
+    dmvfs_readdir_prefix_t readdir_prefix; //!< Optional: read the next directory entry whose name starts with a prefix
+} dmvfs_mount_ops_t;
+
+#define DMVFS_HASH_CRC32C           0               //!< CRC32C (Castagnoli) checksum, 4 bytes
+#define DMVFS_HASH_SHA256           1               //!< SHA-256 digest, 32 bytes
+
+#define DMVFS_UNMOUNT_FORCE         0x00000001      //!< Invalidate and close the handles that are still open
+#define DMVFS_UNMOUNT_LAZY          0x00000002      //!< Detach now, release with the last open handle
+
+#define DMVFS_IO_CLASS_RT           0               //!< Latency critical requests, dispatched first
+#define DMVFS_IO_CLASS_BE           1               //!< Best effort requests (default)
+#define DMVFS_IO_CLASS_IDLE         2               //!< Background requests
+#define DMVFS_IO_CLASSES            3
+
+#define DMVFS_ERR_AGAIN             (-11)           //!< Throttling limit reached and no sleep function is set - retry later (backend errors are reported as -1)
+#define DMVFS_ERR_TOO_BIG           (-27)           //!< The file does not fit in the buffer of the caller
+
+/**
+ * @brief Parameters of the I/O scheduler of a mount point
+ */
+typedef struct
+{
+    uint32_t max_active;                    //!< Requests passed to the backend at once (0 disables the scheduler)
+    uint64_t deadline[DMVFS_IO_CLASSES];    //!< Deadline of each class in microseconds (0 for none)
+} dmvfs_io_sched_t;
+
+/**
+ * @brief Statistics of the I/O scheduler of a mount point
+ */
+typedef struct
+{
+    uint32_t requests;          //!< Requests that went through the scheduler
+    uint32_t delayed;           //!< Requests that had to wait in the queue
+    uint32_t queue_depth;       //!< Requests waiting at the moment
+    uint32_t max_queue_depth;   //!< Highest queue depth
+    uint32_t deadline_misses;   //!< Requests dispatched after their deadline
+    uint64_t total_wait;        //!< Sum of the wait times in microseconds
+    uint64_t max_wait;          //!< Longest wait time in microseconds
+} dmvfs_io_sched_stats_t;
+
+/**
+ * @brief Token bucket limits of the I/O of a process or a mount point
+ */
+typedef struct
+{
+    uint32_t bytes_per_sec;     //!< Bandwidth limit (0 for none)
+    uint32_t ops_per_sec;       //!< Limit of read and write operations (0 for none)
+    uint32_t burst_bytes;       //!< Bucket size in bytes (0 for one second of bandwidth)
+    uint32_t burst_ops;         //!< Bucket size in operations (0 for one second of operations)
+} dmvfs_throttle_t;
+
+/**
+ * @brief Geometry of a flash device used to coalesce the writes of a mount point
+ */
+typedef struct
+{
+    uint32_t program_size;      //!< Program block size in bytes (0 disables write coalescing)
+    uint32_t erase_size;        //!< Erase block size in bytes, a multiple of program_size (0 to coalesce up to a program block)
+} dmvfs_coalesce_t;
+
+/**
+ * @brief Statistics of write coalescing of a mount point
+ *
+ * backend_writes / writes shows how many writes were merged, and
+ * programmed_bytes / bytes is the write amplification - the program blocks
+ * touched by the backend writes compared to the written data.
+ */
+typedef struct
+{
+    uint32_t writes;            //!< Writes requested by the callers
+    uint32_t backend_writes;    //!< Writes passed to the backend
+    uint32_t aligned_writes;    //!< Backend writes that start and end on program block boundaries
+    uint32_t partial_flushes;   //!< Buffers written before they reached a block boundary
+    uint64_t bytes;             //!< Bytes requested by the callers
+    uint64_t backend_bytes;     //!< Bytes passed to the backend
+    uint64_t programmed_bytes;  //!< Bytes of the program blocks touched by the backend writes
+} dmvfs_coalesce_stats_t;
+
+/**
+ * @brief Statistics of the pool of aligned bounce buffers
+ */
+typedef struct
+{
+    uint32_t buffers;           //!< Number of buffers in the pool
+    uint32_t buffer_size;       //!< Size of each buffer in bytes
+    uint32_t alignment;         //!< Alignment of the buffers
+    uint32_t in_use;            //!< Buffers taken at the moment
+    uint32_t staged;            //!< Transfers staged through the pool
+    uint32_t lent;              //!< Buffers lent to backends with dmvfs_bounce_alloc()
+    uint32_t misses;            //!< Requests that found the pool empty
+    uint64_t staged_bytes;      //!< Bytes copied through the pool
+} dmvfs_bounce_stats_t;
+
+/**
+ * @brief Statistics of the open-handle cache
+ */
+typedef struct
+{
+    uint32_t cached;            //!< Handles kept in the cache at the moment
+    uint32_t hits;              //!< Opens served from the cache
+    uint32_t misses;            //!< Read-only opens that had to open the file in the backend
+    uint32_t stale;             //!< Cached handles that failed revalidation
+    uint32_t evictions;         //!< Handles closed to make room for newer ones
+    uint32_t invalidations;     //!< Handles closed because their path was modified
+} dmvfs_handle_cache_stats_t;
+
+/**
+ * @brief Result of a copy or move
+ */
+typedef struct
+{
+    uint64_t bytes;             //!< Number of bytes copied
+    uint64_t elapsed;           //!< Duration of the copy in clock units (see dmvfs_set_clock)
+    uint64_t bytes_per_sec;     //!< Throughput (0 if no clock is set)
+    bool renamed;               //!< The file was moved by a rename of the backend without copying
+} dmvfs_copy_stats_t;
+
+#define DMVFS_WALK_CONTINUE         0               //!< Continue the walk
+#define DMVFS_WALK_PRUNE            1               //!< Do not descend into the reported directory
+#define DMVFS_WALK_STOP             2               //!< Stop the whole walk
+
+#define DMVFS_WALK_DIRS_ONLY        0x1             //!< Report only directories to the callback
+#define DMVFS_WALK_MOUNTS           0x2             //!< Also descend into mount points located in the walked directories
+
+/**
+ * @brief Recursive walk of a directory tree (see dmvfs_walk_open)
+ */
+typedef struct dmvfs_walk dmvfs_walk_t;
+
+/**
+ * @brief Callback of a tree walk, called for every entry below the root
+ *
+ * When the walk is run by several threads, the callback is called from all
+ * of them at the same time.
+ *
+ * @param path Path of the entry
+ * @param entry Directory entry as reported by the file system
+ * @param is_dir True if the entry is a directory
+ * @param depth Depth of the entry, 1 for the entries of the root
+ * @param arg Argument given to dmvfs_walk_open()
+ * @return DMVFS_WALK_CONTINUE, DMVFS_WALK_PRUNE or DMVFS_WALK_STOP
+ */
+typedef int (*dmvfs_walk_callback_t)(const char* path, const dmfsi_dir_entry_t* entry, bool is_dir, int depth, void* arg);
+
+/**
+ * @brief Progress of a recursive copy or removal of a directory tree
+ */
+typedef struct
+{
+    uint32_t files;             //!< Files copied or removed so far
+    uint32_t dirs;              //!< Directories created or removed so far
+    uint64_t bytes;             //!< Bytes copied or freed so far
+    uint64_t elapsed;           //!< Duration of the operation in clock units (see dmvfs_set_clock)
+    uint64_t bytes_per_sec;     //!< Throughput (0 if no clock is set)
+} dmvfs_tree_stats_t;
+
+/**
+ * @brief Progress function of a recursive copy or removal
+ *
+ * @param path Path of the last processed entry or directory
+ * @param stats Progress of the operation
+ * @param arg Argument given to the operation
+ * @return true to continue, false to cancel the operation
+ */
+typedef bool (*dmvfs_tree_progress_t)(const char* path, const dmvfs_tree_stats_t* stats, void* arg);
+
+/**
+ * @brief Function called for every path that matches a glob pattern
+ *
+ * @param path Path of the matching entry
+ * @param entry Directory entry as reported by the file system
+ * @param arg Argument given to dmvfs_glob()
+ * @return true to continue, false to stop the search
+ */
+typedef bool (*dmvfs_glob_callback_t)(const char* path, const dmfsi_dir_entry_t* entry, void* arg);
+
+DMOD_BUILTIN_API( dmvfs, 1.0, bool, _set_arena, (void* arena, size_t size) );
+DMOD_BUILTIN_API( dmvfs, 1.0, bool, _get_alloc_stats, (dmvfs_alloc_stats_t* stats) );
 DMOD_BUILTIN_API( dmvfs, 1.0, bool, _init, (int max_mount_points, int max_open_files) );
 DMOD_BUILTIN_API( dmvfs, 1.0, bool, _reinit_mutex, (void) );
 DMOD_BUILTIN_API( dmvfs, 1.0, bool, _deinit, (void) );
@@ -12,8 +352,27 @@ DMOD_BUILTIN_API( dmvfs, 1.0, int, _get_max_open_files, (void) );
 
 DMOD_BUILTIN_API( dmvfs, 1.0, bool, _mount_fs, (const char* fs_name, const char* mount_point, const char* config) );
 DMOD_BUILTIN_API( dmvfs, 1.0, bool, _unmount_fs, (const char* mount_point) );
+DMOD_BUILTIN_API( dmvfs, 1.0, bool, _unmount_fs_ex, (const char* mount_point, int flags) );
+DMOD_BUILTIN_API( dmvfs, 1.0, int, _refresh_fs, (void) );
+DMOD_BUILTIN_API( dmvfs, 1.0, bool, _set_mount_ops, (const char* mount_point, const dmvfs_mount_ops_t* ops) );
+DMOD_BUILTIN_API( dmvfs, 1.0, bool, _get_mount_ops, (const char* mount_point, dmvfs_mount_ops_t* ops) );
+DMOD_BUILTIN_API( dmvfs, 1.0, bool, _set_io_sched, (const char* mount_point, const dmvfs_io_sched_t* sched) );
+DMOD_BUILTIN_API( dmvfs, 1.0, bool, _get_io_sched_stats, (const char* mount_point, dmvfs_io_sched_stats_t* stats) );
+DMOD_BUILTIN_API( dmvfs, 1.0, bool, _set_io_class, (int pid, int io_class) );
+DMOD_BUILTIN_API( dmvfs, 1.0, bool, _set_file_io_class, (void* fp, int io_class) );
+DMOD_BUILTIN_API( dmvfs, 1.0, bool, _set_throttle, (int pid, const dmvfs_throttle_t* limits) );
+DMOD_BUILTIN_API( dmvfs, 1.0, bool, _set_mount_throttle, (const char* mount_point, const dmvfs_throttle_t* limits) );
+DMOD_BUILTIN_API( dmvfs, 1.0, bool, _set_write_coalescing, (const char* mount_point, const dmvfs_coalesce_t* config) );
+DMOD_BUILTIN_API( dmvfs, 1.0, bool, _get_write_coalescing_stats, (const char* mount_point, dmvfs_coalesce_stats_t* stats) );
+DMOD_BUILTIN_API( dmvfs, 1.0, bool, _set_bounce_pool, (size_t count, size_t size, size_t alignment) );
+DMOD_BUILTIN_API( dmvfs, 1.0, bool, _get_bounce_stats, (dmvfs_bounce_stats_t* stats) );
+DMOD_BUILTIN_API( dmvfs, 1.0, void*, _bounce_alloc, (size_t size) );
+DMOD_BUILTIN_API( dmvfs, 1.0, void, _bounce_free, (void* buffer) );
+DMOD_BUILTIN_API( dmvfs, 1.0, bool, _set_handle_cache, (int entries) );
+DMOD_BUILTIN_API( dmvfs, 1.0, bool, _get_handle_cache_stats, (dmvfs_handle_cache_stats_t* stats) );
 
 DMOD_BUILTIN_API( dmvfs, 1.0, int, _fopen, (void** fp, const char* path, int mode, int attr, int pid) );
+DMOD_BUILTIN_API( dmvfs, 1.0, int, _openat, (void** fp, void* dp, const char* path, int mode, int attr, int pid) );
 DMOD_BUILTIN_API( dmvfs, 1.0, int, _fclose, (void* fp) );
 DMOD_BUILTIN_API( dmvfs, 1.0, int, _fclose_process, (int pid) );
 DMOD_BUILTIN_API( dmvfs, 1.0, int, _fread, (void* fp, void* buf, size_t size, size_t* read_bytes) );
@@ -28,6 +387,14 @@ DMOD_BUILTIN_API( dmvfs, 1.0, int, _rename, (const char* oldpath, const char* ne
 DMOD_BUILTIN_API( dmvfs, 1.0, int, _ioctl, (void* fp, int command, void* arg) );
 DMOD_BUILTIN_API( dmvfs, 1.0, int, _sync, (void* fp) );
 DMOD_BUILTIN_API( dmvfs, 1.0, int, _stat, (const char* path, dmfsi_stat_t* stat) );
+DMOD_BUILTIN_API( dmvfs, 1.0, int, _statat, (void* dp, const char* path, dmfsi_stat_t* stat) );
+DMOD_BUILTIN_API( dmvfs, 1.0, int, _read_file, (const char* path, void** buffer, size_t* size) );
+DMOD_BUILTIN_API( dmvfs, 1.0, void, _free_buffer, (void* buffer) );
+DMOD_BUILTIN_API( dmvfs, 1.0, int, _write_file_atomic, (const char* path, const void* data, size_t size) );
+DMOD_BUILTIN_API( dmvfs, 1.0, int, _copy, (const char* src, const char* dst, dmvfs_copy_stats_t* stats) );
+DMOD_BUILTIN_API( dmvfs, 1.0, int, _move, (const char* src, const char* dst, dmvfs_copy_stats_t* stats) );
+DMOD_BUILTIN_API( dmvfs, 1.0, int, _sendfile, (void* out_fp, void* in_fp, long* offset, size_t count, size_t* sent) );
+DMOD_BUILTIN_API( dmvfs, 1.0, int, _hash_file, (const char* path, int algo, uint8_t* out, size_t out_size) );
 DMOD_BUILTIN_API( dmvfs, 1.0, int, _getc, (void* fp) );
 DMOD_BUILTIN_API( dmvfs, 1.0, int, _putc, (void* fp, int c) );
 DMOD_BUILTIN_API( dmvfs, 1.0, int, _chmod, (const char* path, int mode) );
@@ -36,18 +403,44 @@ DMOD_BUILTIN_API( dmvfs, 1.0, int, _unlink, (const char* path) );
 
 
 // Directory operations
+//
+// The working directory set by _chdir_process is used by the calls that take
+// a process ID (_fopen and _getcwd_process). When a function that returns the
+// calling process is registered with _set_getpid, all other calls that accept
+// a path (and _chdir, _getcwd and _toabs) use the working directory of the
+// calling process as well - otherwise they use the global working directory.
 DMOD_BUILTIN_API( dmvfs, 1.0, int, _mkdir, (const char* path, int mode) );
+DMOD_BUILTIN_API( dmvfs, 1.0, int, _mkdirat, (void* dp, const char* path, int mode) );
 DMOD_BUILTIN_API( dmvfs, 1.0, int, _rmdir, (const char* path) );
 DMOD_BUILTIN_API( dmvfs, 1.0, int, _chdir, (const char* path) );
+DMOD_BUILTIN_API( dmvfs, 1.0, int, _chdir_process, (const char* path, int pid) );
 DMOD_BUILTIN_API( dmvfs, 1.0, int, _opendir, (void** dp, const char* path) );
 DMOD_BUILTIN_API( dmvfs, 1.0, int, _readdir, (void* dp, dmfsi_dir_entry_t* entry) );
+DMOD_BUILTIN_API( dmvfs, 1.0, int, _readdir_prefix, (void* dp, const char* prefix, dmfsi_dir_entry_t* entry) );
 DMOD_BUILTIN_API( dmvfs, 1.0, int, _closedir, (void* dp) );
 DMOD_BUILTIN_API( dmvfs, 1.0, int, _direxists, (const char* path) );
+DMOD_BUILTIN_API( dmvfs, 1.0, dmvfs_walk_t*, _walk_open, (const char* root, int max_depth, int flags, dmvfs_walk_callback_t callback, void* arg) );
+DMOD_BUILTIN_API( dmvfs, 1.0, int, _walk_run, (dmvfs_walk_t* walk) );
+DMOD_BUILTIN_API( dmvfs, 1.0, int, _walk_close, (dmvfs_walk_t* walk) );
+DMOD_BUILTIN_API( dmvfs, 1.0, int, _walk, (const char* root, int max_depth, int flags, dmvfs_walk_callback_t callback, void* arg) );
+DMOD_BUILTIN_API( dmvfs, 1.0, int, _remove_tree, (const char* path, dmvfs_tree_progress_t progress, void* arg, dmvfs_tree_stats_t* stats) );
+DMOD_BUILTIN_API( dmvfs, 1.0, int, _copy_tree, (const char* src, const char* dst, dmvfs_tree_progress_t progress, void* arg, dmvfs_tree_stats_t* stats) );
+DMOD_BUILTIN_API( dmvfs, 1.0, int, _glob, (const char* pattern, dmvfs_glob_callback_t callback, void* arg) );
 
 // Current working directory
 DMOD_BUILTIN_API( dmvfs, 1.0, int, _getcwd, (char* buffer, size_t size) );
+DMOD_BUILTIN_API( dmvfs, 1.0, int, _getcwd_process, (char* buffer, size_t size, int pid) );
 DMOD_BUILTIN_API( dmvfs, 1.0, int, _getpwd, (char* buffer, size_t size) );
 
 DMOD_BUILTIN_API( dmvfs, 1.0, int, _toabs, (const char* path, char* abs_path, size_t size) );
 
+// Clock and tracing
+DMOD_BUILTIN_API( dmvfs, 1.0, bool, _set_clock, (dmvfs_clock_t clock) );
+DMOD_BUILTIN_API( dmvfs, 1.0, bool, _set_sleep, (dmvfs_sleep_t sleep) );
+DMOD_BUILTIN_API( dmvfs, 1.0, bool, _set_getpid, (dmvfs_getpid_t getpid) );
+DMOD_BUILTIN_API( dmvfs, 1.0, bool, _trace_start, (size_t capacity) );
+DMOD_BUILTIN_API( dmvfs, 1.0, bool, _trace_stop, (void) );
+DMOD_BUILTIN_API( dmvfs, 1.0, int, _trace_read, (dmvfs_trace_entry_t* entries, size_t max_entries) );
+DMOD_BUILTIN_API( dmvfs, 1.0, int, _trace_save, (const char* path) );
+
 #endif // DMVFS_H
\ No newline at end of file
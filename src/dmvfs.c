@@ -1,10 +1,153 @@
 #define ENABLE_DIF_REGISTRATIONS    ON
 #include "dmvfs.h"
 #include <string.h>
+#include <stdint.h>
+#if defined(__SSE4_2__) && defined(__x86_64__)
+#   include <nmmintrin.h>
+#   define DMVFS_CRC32C_SSE42
+#elif defined(__ARM_FEATURE_CRC32) && defined(__aarch64__)
+#   include <arm_acle.h>
+#   define DMVFS_CRC32C_ARMV8
+#endif
+
+#ifndef DMVFS_MAX_PROCESS_CWDS
+#   define DMVFS_MAX_PROCESS_CWDS   8
+#endif
+
+#ifndef DMVFS_PATH_MAX
+#   define DMVFS_PATH_MAX           128
+#endif
+
+#ifndef DMVFS_MAX_IO_CLASS_PIDS
+#   define DMVFS_MAX_IO_CLASS_PIDS  8
+#endif
+
+#ifndef DMVFS_MAX_THROTTLED_PIDS
+#   define DMVFS_MAX_THROTTLED_PIDS 8
+#endif
+
+#ifndef DMVFS_HANDLE_CACHE_SIZE
+#   define DMVFS_HANDLE_CACHE_SIZE      8
+#endif
+
+#ifndef DMVFS_ATOMIC_SUFFIX
+#   define DMVFS_ATOMIC_SUFFIX          ".tmp"
+#endif
+
+#ifndef DMVFS_COPY_CHUNK_SIZE
+#   define DMVFS_COPY_CHUNK_SIZE        4096
+#endif
+
+#ifndef DMVFS_BOUNCE_MIN_TRANSFER
+#   define DMVFS_BOUNCE_MIN_TRANSFER    64
+#endif
+
+#ifndef DMVFS_TREE_BATCH_SIZE
+#   define DMVFS_TREE_BATCH_SIZE        16
+#endif
+
+#ifndef DMVFS_SPIN_LIMIT
+#   define DMVFS_SPIN_LIMIT         64
+#endif
+
+#ifndef DMVFS_FS_REGISTRY_SIZE
+#   define DMVFS_FS_REGISTRY_SIZE   32
+#endif
+
+#ifndef DMVFS_ALLOC_MIN_BLOCK
+#   define DMVFS_ALLOC_MIN_BLOCK    16
+#endif
+
+#ifndef DMVFS_ALLOC_CLASSES
+#   define DMVFS_ALLOC_CLASSES      24
+#endif
+
+#ifndef DMVFS_SLAB_CLASSES
+#   define DMVFS_SLAB_CLASSES       5
+#endif
+
+#ifndef DMVFS_SLAB_PAGE_SIZE
+#   define DMVFS_SLAB_PAGE_SIZE     1024
+#endif
+
+#define DMVFS_ALLOC_HEADER_SIZE     sizeof(uint64_t)
+#define DMVFS_ALLOC_LARGE           0xFFu
+#define DMVFS_TOKEN_SCALE           1000000     // tokens are kept in units per microsecond
+#define DMVFS_BOUNCE_MAX_BUFFERS    32
+#define DMVFS_CRC32C_POLY           0x82F63B78u // reflected Castagnoli polynomial
+
+typedef enum
+{
+    MOUNT_STATE_UNUSED = 0,
+    MOUNT_STATE_ACTIVE,
+    MOUNT_STATE_DETACHING,
+    MOUNT_STATE_DETACHED,
+    MOUNT_STATE_CLOSING
+} mount_state_t;
+
+typedef struct {
+    void* mutex;
+    uint32_t next;
+    uint32_t owner;
+} ticket_lock_t;
+
+typedef struct gate {
+    struct gate* next;
+    void* mutex;
+    uint32_t refs;
+} gate_t;
+
+typedef struct mount_pin {
+    struct mount_pin* next;
+    struct mount_point* mount_point;
+    gate_t* gate;
+} mount_pin_t;
+
+typedef struct io_request {
+    struct io_request* next;
+    struct mount_point* mount_point;
+    mount_pin_t pin;
+    gate_t* gate;
+    uint64_t enqueued;
+    uint64_t deadline;
+    uint32_t sequence;
+    int io_class;
+    bool granted;
+} io_request_t;
+
+typedef struct {
+    ticket_lock_t lock;
+    dmvfs_io_sched_t params;
+    uint32_t active;
+    uint32_t sequence;
+    io_request_t* queue;
+    io_request_t* running;
+    dmvfs_io_sched_stats_t stats;
+} io_sched_t;
 
 typedef struct {
+    dmvfs_throttle_t limits;
+    int64_t bytes;
+    int64_t ops;
+    uint64_t updated;
+} token_bucket_t;
+
+typedef struct mount_point {
     Dmod_Context_t* fs_context;
     char* mount_point;
+    size_t mount_point_length;
+    uint32_t fingerprint;
+    uint32_t fingerprint_mask;
+    uint32_t generation;
+    mount_state_t state;
+    int handles;
+    uint32_t in_flight;
+    mount_pin_t* pins;
+    dmvfs_mount_ops_t ops;
+    io_sched_t sched;
+    token_bucket_t throttle;
+    dmvfs_coalesce_t coalesce;
+    dmvfs_coalesce_stats_t coalesce_stats;
     dmfsi_context_t mount_context;
 } mount_point_t;
 
@@ -12,15 +155,189 @@ typedef struct {
     mount_point_t* mount_point;
     void* fs_file;
     int pid;
+    bool is_dir;
+    bool revoked;
+    int io_class;
+    uint8_t* write_buffer;
+    uint32_t write_buffer_size;
+    uint32_t write_buffered;
+    long write_offset;
+    int mode;
+    char* fs_path;
 } file_t;
 
+typedef struct {
+    char* path;
+    mount_point_t* mount_point;
+    const char* fs_path;
+    int pid;
+} cwd_t;
+
+typedef struct {
+    mount_point_t* mount_point;
+    const char* fs_path;
+    char* allocated;
+    bool locked;
+    bool pinned;
+    mount_pin_t pin;
+    char buffer[DMVFS_PATH_MAX];
+} resolved_path_t;
+
+typedef struct {
+    int count;
+    mount_point_t** entries;
+} mount_table_t;
+
+typedef struct {
+    bool used;
+    int pid;
+    int io_class;
+} io_class_entry_t;
+
+typedef struct {
+    bool used;
+    int pid;
+    token_bucket_t bucket;
+} pid_throttle_t;
+
+typedef struct {
+    uint32_t hash;
+    Dmod_Context_t* fs_context;
+} fs_entry_t;
+
+typedef struct {
+    mount_point_t* mount_point;
+    void* fs_file;
+    char* path;
+    int mode;
+    uint64_t used;
+    uint32_t size;
+    uint32_t mtime;
+} cached_handle_t;
+
+typedef struct {
+    uint32_t state[8];
+    uint64_t length;
+    size_t used;
+    uint8_t buffer[64];
+} sha256_t;
+
+typedef struct {
+    void* memory;
+    uint8_t* buffers;
+    size_t size;
+    size_t alignment;
+    uint32_t count;
+    uint32_t free_mask;
+    dmvfs_bounce_stats_t stats;
+} bounce_pool_t;
+
+typedef struct walk_node {
+    struct walk_node* next;
+    int depth;
+    bool listed;
+    char path[];
+} walk_node_t;
+
+typedef struct walk_worker {
+    struct walk_worker* next;
+    gate_t* gate;
+} walk_worker_t;
+
+struct dmvfs_walk {
+    ticket_lock_t lock;
+    walk_node_t* stack;
+    walk_worker_t* busy;
+    uint32_t pending;
+    uint32_t visited;
+    bool stop;
+    bool failed;
+    int max_depth;
+    int flags;
+    dmvfs_walk_callback_t callback;
+    void* arg;
+};
+
+typedef struct {
+    char* dst;
+    size_t src_length;
+    uint64_t start;
+    bool failed;
+    bool cancelled;
+    dmvfs_tree_stats_t stats;
+    dmvfs_tree_progress_t progress;
+    void* arg;
+} tree_copy_t;
+
+typedef struct {
+    char** components;
+    int count;
+    int matches;
+    bool stop;
+    bool failed;
+    walk_node_t* stack;
+    dmvfs_glob_callback_t callback;
+    void* arg;
+} glob_state_t;
+
+typedef struct trace_ring {
+    struct trace_ring* next;
+    uint32_t capacity;
+    dmvfs_trace_entry_t entries[];
+} trace_ring_t;
+
+typedef struct {
+    uint8_t* base;
+    size_t size;
+    size_t used;
+    void* free_lists[DMVFS_ALLOC_CLASSES];
+    void* slab_pages;
+    uint8_t* slab_next[DMVFS_SLAB_CLASSES];
+    uint8_t* slab_end[DMVFS_SLAB_CLASSES];
+    dmvfs_alloc_stats_t stats;
+} allocator_t;
+
 static mount_point_t* g_mount_points = NULL;
 static int g_max_mount_points = 0;
 static int g_max_open_files = 0;
 static void* g_mutex = NULL;
-static char* g_cwd = NULL;
+static ticket_lock_t g_fallback_lock;
+static ticket_lock_t g_mount_writer_lock;
+static mount_table_t g_mount_tables[2];
+static mount_table_t* g_mount_table = NULL;
+static uint32_t g_mount_epoch = 0;
+static uint32_t g_mount_readers[2];
+static cwd_t g_cwd = { NULL, NULL, NULL, 0 };
+static cwd_t g_process_cwds[DMVFS_MAX_PROCESS_CWDS];
+static io_class_entry_t g_io_classes[DMVFS_MAX_IO_CLASS_PIDS];
+static pid_throttle_t g_pid_throttles[DMVFS_MAX_THROTTLED_PIDS];
 static char* g_pwd = NULL;
 static file_t* g_open_files = NULL;
+static dmvfs_clock_t g_clock = NULL;
+static dmvfs_sleep_t g_sleep = NULL;
+static dmvfs_getpid_t g_getpid = NULL;
+static trace_ring_t* g_trace_ring = NULL;
+static trace_ring_t* g_trace_rings = NULL;
+static gate_t* g_gates = NULL;
+static uint32_t g_trace_head = 0;
+static bool g_trace_enabled = false;
+static fs_entry_t g_fs_registry[DMVFS_FS_REGISTRY_SIZE];
+static bool g_fs_registry_valid = false;
+static allocator_t g_allocator;
+static bounce_pool_t g_bounce;
+static ticket_lock_t g_handle_cache_lock;
+static cached_handle_t g_handle_cache[DMVFS_HANDLE_CACHE_SIZE];
+static int g_handle_cache_limit = 0;
+static uint64_t g_handle_cache_tick = 0;
+static dmvfs_handle_cache_stats_t g_handle_cache_stats;
+static uint32_t g_atomic_sequence = 0;
+#if !defined(DMVFS_CRC32C_SSE42) && !defined(DMVFS_CRC32C_ARMV8)
+static uint32_t g_crc32c_tables[8][256];
+static bool g_crc32c_ready = false;
+#endif
+#ifdef DMVFS_STATIC_ARENA_SIZE
+static uint64_t g_static_arena[(DMVFS_STATIC_ARENA_SIZE + sizeof(uint64_t) - 1) / sizeof(uint64_t)];
+#endif
 
 /**
  * @brief Check if DMVFS is initialized
@@ -32,1113 +349,7035 @@ static inline bool is_initialized(void)
 }
 
 /**
- * @brief Lock the DMVFS mutex
- * @return true on success, false on failure
+ * @brief Back off in a spin loop
+ *
+ * After DMVFS_SPIN_LIMIT rounds the caller sleeps with the function set by
+ * dmvfs_set_sleep(), so a lower priority thread that was preempted while it
+ * held what the caller waits for can run and release it. Without a sleep
+ * function DMVFS has no way to yield and keeps spinning.
+ *
+ * @param spins Spin counter of the loop, starting at 0
  */
-static inline bool lock_mutex(void)
+static inline void spin_wait(uint32_t* spins)
 {
-    if(g_mutex == NULL)
+    if(++(*spins) < DMVFS_SPIN_LIMIT)
     {
-        dmvfs_reinit_mutex();
+        return;
     }
-    if(g_mutex != NULL)
+    *spins = 0;
+    dmvfs_sleep_t sleep = g_sleep;
+    if(sleep != NULL)
     {
-        return (Dmod_Mutex_Lock(g_mutex) == 0);
+        sleep(1);
     }
-    Dmod_EnterCritical();
-    return true;
 }
 
 /**
- * @brief Unlock the DMVFS mutex
+ * @brief Give a ticket lock a DMOD mutex to block on
+ *
+ * When the mutex cannot be created (e.g. the scheduler is not started yet)
+ * the lock keeps spinning on its tickets.
+ *
+ * @param lock Ticket lock that is not held by anybody
  */
-static inline void unlock_mutex(void)
+static void ticket_lock_init(ticket_lock_t* lock)
 {
-    if(g_mutex != NULL)
+    if(lock->mutex == NULL)
     {
-        Dmod_Mutex_Unlock(g_mutex);
+        lock->mutex = Dmod_Mutex_New(false);
     }
-    Dmod_ExitCritical();
 }
 
 /**
- * @brief Duplicate a string
- * @param str String to duplicate
- * @return Pointer to duplicated string, or NULL on failure
+ * @brief Delete the DMOD mutex of a ticket lock
+ * @param lock Ticket lock that is not held by anybody
  */
-static char* duplicate_string(const char* str)
+static void ticket_lock_deinit(ticket_lock_t* lock)
 {
-    if(str == NULL)
+    if(lock->mutex != NULL)
     {
-        return NULL;
+        Dmod_Mutex_Delete(lock->mutex);
+        lock->mutex = NULL;
     }
+}
 
-    char* dup = Dmod_Malloc(strlen(str) + 1);
-    if(dup != NULL)
+/**
+ * @brief Take a ticket lock
+ *
+ * A lock with a DMOD mutex blocks on it, so a preempted owner does not make
+ * the other threads burn their time slices (and can inherit their priority
+ * if the mutex supports it). Otherwise interrupts are disabled only while
+ * the ticket is drawn, the lock itself is held without a critical section
+ * and the waiters back off with spin_wait(). The lock is not recursive.
+ *
+ * @param lock Ticket lock
+ */
+static inline void ticket_lock(ticket_lock_t* lock)
+{
+    if(lock->mutex != NULL)
     {
-        strcpy(dup, str);
+        Dmod_Mutex_Lock(lock->mutex);
+        return;
+    }
+
+    Dmod_EnterCritical();
+    uint32_t ticket = lock->next++;
+    Dmod_ExitCritical();
+    uint32_t spins = 0;
+    while(__atomic_load_n(&lock->owner, __ATOMIC_ACQUIRE) != ticket)
+    {
+        spin_wait(&spins);
     }
-    return dup;
 }
 
 /**
- * @brief Update a string (free old and duplicate new)
- * @param old_str Old string to free
- * @param new_str New string to duplicate
- * @return Pointer to duplicated new string, or NULL on failure
+ * @brief Release a ticket lock
+ * @param lock Ticket lock
  */
-static char* update_string(const char* old_str, const char* new_str)
+static inline void ticket_unlock(ticket_lock_t* lock)
 {
-    if(old_str != NULL)
+    if(lock->mutex != NULL)
     {
-        Dmod_Free((void*)old_str);
+        Dmod_Mutex_Unlock(lock->mutex);
+        return;
     }
-    return duplicate_string(new_str);
+    __atomic_store_n(&lock->owner, lock->owner + 1, __ATOMIC_RELEASE);
 }
 
 /**
- * @brief Convert path to absolute path
- * @param path Input path
- * @return Pointer to absolute path, or NULL on failure
+ * @brief Lock the DMVFS mutex
+ *
+ * When the mutex could not be created, a ticket lock is used instead.
+ * Interrupts are disabled only while the ticket is drawn, so the backend
+ * operations never run inside of a critical section. The lock is not
+ * recursive - it must not be taken again by the owner.
+ *
+ * @return true on success, false on failure
  */
-static char* to_absolute_path(const char* path)
+static inline bool lock_mutex(void)
 {
-    if(path == NULL)
+    if(g_mutex != NULL)
     {
-        return NULL;
+        return (Dmod_Mutex_Lock(g_mutex) == 0);
     }
 
-    if(path[0] == '/')
+    ticket_lock(&g_fallback_lock);
+    return true;
+}
+
+/**
+ * @brief Unlock the DMVFS mutex
+ */
+static inline void unlock_mutex(void)
+{
+    if(g_mutex != NULL)
     {
-        return duplicate_string(path);
+        Dmod_Mutex_Unlock(g_mutex);
+        return;
     }
-    else
+    ticket_unlock(&g_fallback_lock);
+}
+
+/**
+ * @brief Enter a read section of the mount table
+ *
+ * Readers never block - they only increment the counter of the current
+ * epoch. A mount point that is removed from the table is not released
+ * until all the readers of the old epoch leave their sections. A section
+ * covers only the lookup in the table - a reader that needs the mount point
+ * for longer pins it with pin_mount_point() before it leaves the section.
+ *
+ * @return Reader slot to pass to mount_read_end()
+ */
+static inline int mount_read_begin(void)
+{
+    for(;;)
     {
-        size_t cwd_len = (g_cwd != NULL) ? strlen(g_cwd) : 0;
-        size_t path_len = strlen(path);
-        char* abs_path = (char*)Dmod_Malloc(cwd_len + 1 + path_len + 1);
-        if(abs_path != NULL)
+        uint32_t epoch = __atomic_load_n(&g_mount_epoch, __ATOMIC_ACQUIRE);
+        __atomic_fetch_add(&g_mount_readers[epoch & 1], 1, __ATOMIC_SEQ_CST);
+        if(__atomic_load_n(&g_mount_epoch, __ATOMIC_SEQ_CST) == epoch)
         {
-            if(cwd_len > 0)
-            {
-                strcpy(abs_path, g_cwd);
-                abs_path[cwd_len] = '/';
-                strcpy(abs_path + cwd_len + 1, path);
-            }
-            else
-            {
-                strcpy(abs_path, "/");
-                strcpy(abs_path + 1, path);
-            }
+            return (int)(epoch & 1);
         }
-        return abs_path;
+        __atomic_fetch_sub(&g_mount_readers[epoch & 1], 1, __ATOMIC_RELEASE);
     }
 }
 
 /**
- * @brief Find free mount point entry
- * @return Pointer to free mount point entry, or NULL if none available
+ * @brief Leave a read section of the mount table
+ * @param reader Reader slot returned by mount_read_begin()
  */
-static mount_point_t* find_free_mount_point(void)
+static inline void mount_read_end(int reader)
 {
-    if(!is_initialized())
+    __atomic_fetch_sub(&g_mount_readers[reader], 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Start a new epoch and wait for the readers of the previous one
+ *
+ * The function must be called with the mount writer lock taken, so the
+ * table of the previous epoch is not rebuilt while it is read. The DMVFS
+ * mutex does not have to be locked - readers never wait for it inside of
+ * their sections, so this cannot deadlock either way. The sections are only
+ * table lookups, so the writer spins, backing off with spin_wait() in case
+ * a reader was preempted inside of its section.
+ */
+static void wait_for_mount_readers(void)
+{
+    uint32_t epoch = __atomic_load_n(&g_mount_epoch, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_mount_epoch, epoch + 1, __ATOMIC_SEQ_CST);
+    uint32_t spins = 0;
+    while(__atomic_load_n(&g_mount_readers[epoch & 1], __ATOMIC_ACQUIRE) != 0)
     {
-        DMOD_LOG_ERROR("DMVFS is not initialized\n");
-        return NULL;
+        spin_wait(&spins);
     }
+}
 
-    for(int i = 0; i < g_max_mount_points; i++)
+/**
+ * @brief Get the start time of a traced operation
+ * @return Current clock value, or 0 if tracing is disabled
+ */
+static inline uint64_t trace_begin(void)
+{
+    if(!__atomic_load_n(&g_trace_enabled, __ATOMIC_ACQUIRE) || g_clock == NULL)
     {
-        if(g_mount_points[i].mount_point == NULL)
-        {
-            return &g_mount_points[i];
-        }
+        return 0;
     }
-
-    DMOD_LOG_ERROR("No free mount points available\n");
-    return NULL;
+    return g_clock();
 }
 
 /**
- * @brief Find mount point by path
- * @param mount_point Mount point path
- * @return Pointer to the mount point entry, or NULL if not found
+ * @brief Record an operation in the trace ring buffer
+ *
+ * Writers never block each other: each of them reserves a slot by incrementing
+ * the head index and publishes the record by storing its sequence number last.
+ * A reader accepts a slot only if the sequence number is the expected one
+ * before and after copying it. Rings are never freed before dmvfs_deinit(),
+ * so a writer that raced with dmvfs_trace_start() still writes valid memory.
+ *
+ * @param op Operation code
+ * @param pid Process ID (-1 if unknown)
+ * @param mp_entry Mount point used by the operation (can be NULL)
+ * @param file_entry File entry used by the operation (can be NULL)
+ * @param size Requested size (signed offset for lseek)
+ * @param arg Operation specific argument
+ * @param result Result returned by the backend
+ * @param start Value returned by trace_begin()
  */
-static mount_point_t* find_mount_point(const char* mount_point)
+static void trace_record(dmvfs_trace_op_t op, int pid, const mount_point_t* mp_entry, const file_t* file_entry,
+                         int64_t size, int32_t arg, int32_t result, uint64_t start)
 {
-    if(!is_initialized())
+    if(!__atomic_load_n(&g_trace_enabled, __ATOMIC_ACQUIRE))
     {
-        DMOD_LOG_ERROR("DMVFS is not initialized\n");
-        return NULL;
+        return;
     }
 
-    for(int i = 0; i < g_max_mount_points; i++)
+    trace_ring_t* ring = __atomic_load_n(&g_trace_ring, __ATOMIC_ACQUIRE);
+    if(ring == NULL)
     {
-        if(g_mount_points[i].mount_point != NULL &&
-           strcmp(g_mount_points[i].mount_point, mount_point) == 0)
-        {
-            return &g_mount_points[i];
-        }
+        return;
     }
 
-    DMOD_LOG_WARN("Mount point '%s' not found\n", mount_point);
-    return NULL;
+    uint64_t now = (g_clock != NULL) ? g_clock() : 0;
+    uint32_t sequence = __atomic_fetch_add(&g_trace_head, 1, __ATOMIC_RELAXED);
+    dmvfs_trace_entry_t* entry = &ring->entries[sequence & (ring->capacity - 1)];
+
+    __atomic_store_n(&entry->sequence, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    entry->timestamp    = start;
+    entry->duration     = (start != 0 && now >= start) ? (uint32_t)(now - start) : 0;
+    entry->pid          = pid;
+    entry->op           = (uint16_t)op;
+    entry->mount_index  = (mp_entry != NULL) ? (int16_t)(mp_entry - g_mount_points) : -1;
+    entry->handle       = (file_entry != NULL) ? (int32_t)(file_entry - g_open_files) : -1;
+    if(op == DMVFS_TRACE_OP_LSEEK)
+    {
+        entry->offset   = (size > INT32_MAX) ? INT32_MAX : (size < INT32_MIN) ? INT32_MIN : (int32_t)size;
+    }
+    else
+    {
+        entry->size     = (size > UINT32_MAX) ? UINT32_MAX : (uint32_t)size;
+    }
+    entry->arg          = arg;
+    entry->result       = result;
+
+    __atomic_store_n(&entry->sequence, sequence + 1, __ATOMIC_RELEASE);
 }
 
 /**
- * @brief Get mount point for a given path
- * @param path File path
- * @return Pointer to the mount point entry, or NULL if not found
+ * @brief Copy consistent records from the trace ring buffer
+ * @param ring Ring to copy from
+ * @param entries Output array
+ * @param max_entries Size of the output array
+ * @param dropped Optional pointer to store the number of lost records
+ * @return Number of records copied
  */
-static mount_point_t* get_mount_point_for_path(const char* path)
+static size_t trace_copy(const trace_ring_t* ring, dmvfs_trace_entry_t* entries, size_t max_entries, uint32_t* dropped)
 {
-    if(!is_initialized())
+    uint32_t head = __atomic_load_n(&g_trace_head, __ATOMIC_ACQUIRE);
+    uint32_t first = (head > ring->capacity) ? head - ring->capacity : 0;
+    if(head - first > max_entries)
     {
-        DMOD_LOG_ERROR("DMVFS is not initialized\n");
-        return NULL;
+        first = head - (uint32_t)max_entries;
     }
 
-    for(int i = 0; i < g_max_mount_points; i++)
+    size_t count = 0;
+    for(uint32_t sequence = first; sequence != head; sequence++)
     {
-        if(g_mount_points[i].mount_point != NULL &&
-           strncmp(path, g_mount_points[i].mount_point, strlen(g_mount_points[i].mount_point)) == 0)
+        const dmvfs_trace_entry_t* slot = &ring->entries[sequence & (ring->capacity - 1)];
+        uint32_t before = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        if(before != sequence + 1)
         {
-            return &g_mount_points[i];
+            continue;
+        }
+        entries[count] = *slot;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if(__atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) != before)
+        {
+            continue;
         }
+        entries[count].sequence = before;
+        count++;
     }
 
-    DMOD_LOG_WARN("No mount point found for path '%s'\n", path);
-    return NULL;
+    if(dropped != NULL)
+    {
+        *dropped = head - (uint32_t)count;
+    }
+    return count;
 }
 
 /**
- * @brief Find free file entry
- * @return Pointer to free file entry, or NULL if none available
+ * @brief Set up the allocator
+ *
+ * The function must be called only when no block is allocated - it forgets
+ * all the free lists and slab pages.
+ *
+ * @param arena Memory for the arena, or NULL to use the heap
+ * @param size Size of the memory
  */
-static file_t* find_free_file_entry(void)
+static void allocator_setup(void* arena, size_t size)
 {
-    if(!is_initialized())
+    memset(&g_allocator, 0, sizeof(g_allocator));
+    if(arena != NULL)
     {
-        DMOD_LOG_ERROR("DMVFS is not initialized\n");
-        return NULL;
+        uintptr_t address = (uintptr_t)arena;
+        size_t padding = (DMVFS_ALLOC_HEADER_SIZE - (address % DMVFS_ALLOC_HEADER_SIZE)) % DMVFS_ALLOC_HEADER_SIZE;
+        g_allocator.base = (uint8_t*)arena + padding;
+        g_allocator.size = (size > padding) ? size - padding : 0;
     }
+    g_allocator.stats.arena_size = g_allocator.size;
+}
 
-    for(int i = 0; i < g_max_open_files; i++)
+/**
+ * @brief Release the slab pages taken from the heap and reset the allocator
+ *
+ * The function must be called only when no block is allocated.
+ */
+static void allocator_reset(void)
+{
+    if(g_allocator.base == NULL)
     {
-        if(g_open_files[i].mount_point == NULL)
+        void* page = g_allocator.slab_pages;
+        while(page != NULL)
         {
-            return &g_open_files[i];
+            void* next = *(void**)page;
+            Dmod_Free(page);
+            page = next;
         }
     }
-
-    DMOD_LOG_ERROR("No free file entries available\n");
-    return NULL;
+    allocator_setup(g_allocator.base, g_allocator.size);
 }
 
 /**
- * @brief Close all files of a given mount point
- * @param mp_entry Pointer to the mount point entry
- * @return true on success, false on failure
+ * @brief Take fresh memory from the arena
+ * @param size Number of bytes
+ * @return Pointer to the memory, or NULL on failure
  */
-static bool close_all_file_of_mount_point(mount_point_t* mp_entry)
+static void* allocator_take(size_t size)
 {
-    if(!is_initialized())
+    if(g_allocator.base == NULL || g_allocator.size - g_allocator.used < size)
     {
-        DMOD_LOG_ERROR("DMVFS is not initialized\n");
-        return false;
+        return NULL;
     }
+    void* memory = g_allocator.base + g_allocator.used;
+    g_allocator.used += size;
+    g_allocator.stats.arena_used = g_allocator.used;
+    return memory;
+}
 
-    for(int i = 0; i < g_max_open_files; i++)
+/**
+ * @brief Carve a block of a slab size class
+ * @param size_class Size class of the block
+ * @param heap Heap memory prepared by the caller (set to NULL when it is used)
+ * @param need_heap Set to true when a new page has to be taken from the heap
+ * @return Pointer to the block (including its header), or NULL on failure
+ */
+static uint8_t* slab_carve(int size_class, uint8_t** heap, bool* need_heap)
+{
+    size_t block_size = DMVFS_ALLOC_HEADER_SIZE + ((size_t)DMVFS_ALLOC_MIN_BLOCK << size_class);
+    if(g_allocator.slab_end[size_class] - g_allocator.slab_next[size_class] < (ptrdiff_t)block_size)
     {
-        if(g_open_files[i].mount_point == mp_entry)
+        uint8_t* page = NULL;
+        if(g_allocator.base != NULL)
         {
-            dmod_dmfsi_fclose_t close_func = (dmod_dmfsi_fclose_t)Dmod_GetDifFunction(mp_entry->fs_context, dmod_dmfsi_fclose_sig);
-            if(close_func != NULL)
-            {
-                if(!close_func(mp_entry->mount_context, g_open_files[i].fs_file))
-                {
-                    DMOD_LOG_ERROR("Failed to close file in mount point '%s'\n", mp_entry->mount_point);
-                    return false;
-                }
-            }
-
-            g_open_files[i].mount_point = NULL;
-            g_open_files[i].fs_file = NULL;
+            page = (uint8_t*)allocator_take(DMVFS_SLAB_PAGE_SIZE);
+        }
+        else if(*heap == NULL)
+        {
+            *need_heap = true;
+        }
+        else
+        {
+            page = *heap;
+            *heap = NULL;
+        }
+        if(page == NULL)
+        {
+            return NULL;
         }
+        *(void**)page = g_allocator.slab_pages;
+        g_allocator.slab_pages = page;
+        g_allocator.slab_next[size_class] = page + DMVFS_ALLOC_HEADER_SIZE;
+        g_allocator.slab_end[size_class] = page + DMVFS_SLAB_PAGE_SIZE;
+        g_allocator.stats.slab_pages++;
     }
 
-    return true;
+    uint8_t* block = g_allocator.slab_next[size_class];
+    g_allocator.slab_next[size_class] += block_size;
+    return block;
 }
 
 /**
- * @brief Find file system by name
- * @param fs_name Name of the file system
- * @return Pointer to the file system context, or NULL if not found
+ * @brief Get the size class of an allocation
+ * @param size Number of bytes to allocate
+ * @return Size class (DMVFS_ALLOC_CLASSES for blocks bigger than all classes)
  */
-static Dmod_Context_t* find_fs_by_name(const char* fs_name)
+static inline int allocator_size_class(size_t size)
 {
-    if(!is_initialized())
+    int size_class = 0;
+    while(size_class < DMVFS_ALLOC_CLASSES && ((size_t)DMVFS_ALLOC_MIN_BLOCK << size_class) < size)
     {
-        DMOD_LOG_ERROR("DMVFS is not initialized\n");
-        return NULL;
+        size_class++;
     }
+    return size_class;
+}
 
-    if(!lock_mutex())
+/**
+ * @brief Allocate a block from the slab pages, the arena or the heap
+ *
+ * The size is rounded up to a power of 2 size class and a released block of
+ * the class is reused when there is one. Small blocks (paths, names, per
+ * handle structures) are carved from slab pages of DMVFS_SLAB_PAGE_SIZE
+ * bytes, so they do not fragment the shared heap. Bigger blocks are carved
+ * from the arena, or taken from the heap when no arena is set (they are
+ * returned to the heap when released).
+ *
+ * The function runs in a critical section, so it never calls the heap - when
+ * heap memory is needed it sets need_heap and the caller takes the memory
+ * (see allocator_heap_size()) and calls the function again.
+ *
+ * @param size Number of bytes to allocate
+ * @param heap Heap memory prepared by the caller (set to NULL when it is used)
+ * @param need_heap Set to true when heap memory has to be prepared
+ * @return Pointer to the memory, or NULL on failure
+ */
+static void* allocator_alloc(size_t size, uint8_t** heap, bool* need_heap)
+{
+    int size_class = allocator_size_class(size);
+    *need_heap = false;
+
+    uint8_t* block = NULL;
+    uint64_t header = (uint64_t)size_class;
+    size_t block_size = (size_t)DMVFS_ALLOC_MIN_BLOCK << size_class;
+    if(size_class < DMVFS_ALLOC_CLASSES && g_allocator.free_lists[size_class] != NULL)
     {
-        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
-        return NULL;
+        block = (uint8_t*)g_allocator.free_lists[size_class] - DMVFS_ALLOC_HEADER_SIZE;
+        g_allocator.free_lists[size_class] = *(void**)(block + DMVFS_ALLOC_HEADER_SIZE);
+    }
+    else if(size_class < DMVFS_SLAB_CLASSES)
+    {
+        block = slab_carve(size_class, heap, need_heap);
+    }
+    else if(g_allocator.base != NULL && size_class < DMVFS_ALLOC_CLASSES)
+    {
+        block = (uint8_t*)allocator_take(DMVFS_ALLOC_HEADER_SIZE + block_size);
+    }
+    else if(g_allocator.base == NULL && *heap == NULL)
+    {
+        *need_heap = true;
+    }
+    else if(g_allocator.base == NULL)
+    {
+        block = *heap;
+        *heap = NULL;
+        header = ((uint64_t)size << 8) | DMVFS_ALLOC_LARGE;
+        block_size = size;
+        g_allocator.stats.heap_bytes += size;
     }
 
-    Dmod_Context_t* fs_context = Dmod_GetNextDifModule(dmod_dmfsi_fopen_sig, NULL);
-    while(fs_context != NULL)
+    if(block == NULL)
     {
-        if(fs_context->Header != NULL && strcmp(fs_context->Header->Name, fs_name) == 0)
+        if(!*need_heap)
         {
-            DMOD_LOG_VERBOSE("File system '%s' found\n", fs_name);
-            unlock_mutex();
-            return fs_context;
+            g_allocator.stats.failures++;
         }
-        fs_context = Dmod_GetNextDifModule(dmod_dmfsi_fopen_sig, fs_context);
+        return NULL;
     }
 
-    DMOD_LOG_WARN("File system '%s' not found\n", fs_name);
-    unlock_mutex();
-    return NULL;
+    *(uint64_t*)block = header;
+    g_allocator.stats.allocations++;
+    g_allocator.stats.used_blocks++;
+    g_allocator.stats.used_bytes += block_size;
+    if(g_allocator.stats.used_bytes > g_allocator.stats.peak_used_bytes)
+    {
+        g_allocator.stats.peak_used_bytes = g_allocator.stats.used_bytes;
+    }
+    return block + DMVFS_ALLOC_HEADER_SIZE;
 }
 
 /**
- * @brief Add mount point
- * @param mount_point Mount point path
- * @param fs_context File system context
- * @param config Configuration string for the file system (file system specific)
- * @return Pointer to the mount point entry, or NULL on failure
+ * @brief Get the size of the heap memory requested by allocator_alloc()
+ * @param size Number of bytes to allocate
+ * @return Number of bytes to take from the heap
  */
-static mount_point_t* add_mount_point(const char* mount_point, Dmod_Context_t* fs_context, const char* config)
+static inline size_t allocator_heap_size(size_t size)
 {
-    if(!is_initialized())
-    {
-        DMOD_LOG_ERROR("DMVFS is not initialized\n");
-        return NULL;
-    }
+    return (allocator_size_class(size) < DMVFS_SLAB_CLASSES) ? DMVFS_SLAB_PAGE_SIZE : DMVFS_ALLOC_HEADER_SIZE + size;
+}
 
-    if(fs_context == NULL)
+/**
+ * @brief Release memory allocated with allocator_alloc()
+ * @param ptr Pointer to the memory (can be NULL)
+ * @return Memory that the caller has to return to the heap, or NULL
+ */
+static void* allocator_release(void* ptr)
+{
+    if(ptr == NULL)
     {
-        DMOD_LOG_ERROR("Cannot add mount point '%s': Invalid file system context\n", mount_point);
         return NULL;
     }
 
-    const char* module_name = Dmod_GetName(fs_context);
-    if(module_name == NULL)
+    uint8_t* block = (uint8_t*)ptr - DMVFS_ALLOC_HEADER_SIZE;
+    uint64_t header = *(uint64_t*)block;
+    g_allocator.stats.used_blocks--;
+    if((header & 0xFF) == DMVFS_ALLOC_LARGE)
     {
-        DMOD_LOG_ERROR("Cannot add mount point '%s': Failed to get module name\n", mount_point);
-        return NULL;
+        g_allocator.stats.used_bytes -= (size_t)(header >> 8);
+        g_allocator.stats.heap_bytes -= (size_t)(header >> 8);
+        return block;
     }
 
-    Dmod_BeginUsage(module_name);
+    g_allocator.stats.used_bytes -= (size_t)DMVFS_ALLOC_MIN_BLOCK << header;
+    *(void**)ptr = g_allocator.free_lists[header];
+    g_allocator.free_lists[header] = ptr;
+    return NULL;
+}
 
-    mount_point_t* free_entry = find_free_mount_point();
-    if(free_entry == NULL)
-    {
-        return NULL;
-    }
+/**
+ * @brief Allocate memory for DMVFS internal data
+ *
+ * The allocator state is updated in a short critical section, so the memory
+ * can be allocated and released with or without the DMVFS mutex. The heap is
+ * called outside of the critical section; a slab page that is not needed
+ * anymore when the critical section is entered again is returned to it.
+ *
+ * @param size Number of bytes to allocate
+ * @return Pointer to the memory, or NULL on failure
+ */
+static void* vfs_malloc(size_t size)
+{
+    uint8_t* heap = NULL;
+    bool need_heap = false;
 
-    dmod_dmfsi_init_t init_func = (dmod_dmfsi_init_t)Dmod_GetDifFunction(fs_context, dmod_dmfsi_init_sig);
-    if(init_func != NULL)
+    Dmod_EnterCritical();
+    void* ptr = allocator_alloc(size, &heap, &need_heap);
+    Dmod_ExitCritical();
+
+    if(need_heap)
     {
-        free_entry->mount_context = init_func(config);
-        if(free_entry->mount_context == NULL)
+        heap = (uint8_t*)Dmod_Malloc(allocator_heap_size(size));
+
+        Dmod_EnterCritical();
+        ptr = allocator_alloc(size, &heap, &need_heap);
+        if(need_heap)
         {
-            DMOD_LOG_ERROR("Failed to initialize mount context for mount point '%s'\n", mount_point);
-            return NULL;
+            g_allocator.stats.failures++;
+        }
+        Dmod_ExitCritical();
+
+        if(heap != NULL)
+        {
+            Dmod_Free(heap);
         }
     }
 
-    free_entry->mount_point = Dmod_Malloc(strlen(mount_point) + 1);
-    if(free_entry->mount_point == NULL)
+    if(ptr == NULL)
     {
-        DMOD_LOG_ERROR("Failed to allocate memory for mount point\n");
-        return NULL;
+        DMOD_LOG_ERROR("Cannot allocate %zu bytes\n", size);
     }
-
-
-    strcpy(free_entry->mount_point, mount_point);
-    free_entry->fs_context = fs_context;
-    return free_entry;
-    return NULL;
+    return ptr;
 }
 
 /**
- * @brief Remove mount point
- * @param mount_point Mount point path
- * @return true on success, false on failure
+ * @brief Free memory allocated with vfs_malloc()
+ * @param ptr Pointer to the memory (can be NULL)
  */
-static bool remove_mount_point(const char* mount_point)
+static void vfs_free(void* ptr)
 {
-    if(!is_initialized())
+    if(ptr != NULL)
     {
-        DMOD_LOG_ERROR("DMVFS is not initialized\n");
-        return false;
-    }
-
-    mount_point_t* mp_entry = find_mount_point(mount_point);
-    if(mp_entry == NULL)
-    {
-        DMOD_LOG_ERROR("Mount point '%s' not found\n", mount_point);
-        return false;
-    }
+        Dmod_EnterCritical();
+        void* heap = allocator_release(ptr);
+        Dmod_ExitCritical();
 
-    dmod_dmfsi_deinit_t deinit_func = (dmod_dmfsi_deinit_t)Dmod_GetDifFunction(mp_entry->fs_context, dmod_dmfsi_deinit_sig);
-    if(deinit_func != NULL)
-    {
-        int result = deinit_func(mp_entry->mount_context);
-        if(result != 0)
+        if(heap != NULL)
         {
-            DMOD_LOG_WARN("Failed to deinitialize mount context for mount point '%s'\n", mount_point);
+            Dmod_Free(heap);
         }
     }
+}
 
-    const char* module_name = Dmod_GetName(mp_entry->fs_context);
-    if(module_name == NULL)
+/**
+ * @brief Duplicate a string
+ * @param str String to duplicate
+ * @return Pointer to duplicated string, or NULL on failure
+ */
+static char* duplicate_string(const char* str)
+{
+    if(str == NULL)
     {
-        DMOD_LOG_ERROR("Cannot remove mount point '%s': Failed to get module name\n", mount_point);
-        return false;
+        return NULL;
     }
 
-    Dmod_EndUsage(module_name);
-
-    Dmod_Free(mp_entry->mount_point);
-    mp_entry->mount_point = NULL;
-    mp_entry->mount_context = NULL;
-    mp_entry->fs_context = NULL;
-    return true;
+    char* dup = vfs_malloc(strlen(str) + 1);
+    if(dup != NULL)
+    {
+        strcpy(dup, str);
+    }
+    return dup;
 }
 
 /**
- * @brief Initialize DMVFS
- * 
- * The function initializes the DMVFS with a specified maximum number of mount points.
- * It allocates memory for the mount points and creates a mutex for thread safety.
- * @param max_mount_points Maximum number of mount points
- * 
- * @return true on success, false on failure
+ * @brief Join a base path and a relative path
+ * @param base Base path (e.g. a working directory)
+ * @param path Relative path
+ * @param buffer Local buffer used if the result fits in it (can be NULL)
+ * @param size Size of the local buffer
+ * @param allocated Pointer to store the heap buffer (NULL if the local buffer was used)
+ * @return Pointer to the joined path, or NULL on failure
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, bool, _init, (int max_mount_points, int max_open_files))
+static char* join_path(const char* base, const char* path, char* buffer, size_t size, char** allocated)
 {
-    if (is_initialized())
+    size_t base_len = strlen(base);
+    size_t path_len = strlen(path);
+    bool separator = (base_len == 0 || base[base_len - 1] != '/');
+    size_t length = base_len + (separator ? 1 : 0) + path_len;
+
+    char* joined = buffer;
+    *allocated = NULL;
+    if(buffer == NULL || length + 1 > size)
     {
-        DMOD_LOG_WARN("DMVFS is already initialized\n");
-        return false;
+        joined = (char*)vfs_malloc(length + 1);
+        if(joined == NULL)
+        {
+            DMOD_LOG_ERROR("Failed to allocate memory for path\n");
+            return NULL;
+        }
+        *allocated = joined;
     }
 
-    if (max_mount_points <= 0)
+    memcpy(joined, base, base_len);
+    if(separator)
     {
-        DMOD_LOG_ERROR("Invalid maximum mount points: %d\n", max_mount_points);
-        return false;
+        joined[base_len++] = '/';
     }
+    memcpy(joined + base_len, path, path_len + 1);
+    return joined;
+}
 
-    g_mount_points = (mount_point_t*)Dmod_Malloc(sizeof(mount_point_t) * max_mount_points);
-    if (g_mount_points == NULL)
+/**
+ * @brief Convert path to absolute path
+ * @param path Input path
+ * @param cwd Working directory used for relative paths
+ * @return Pointer to absolute path, or NULL on failure
+ */
+static char* to_absolute_path(const char* path, const cwd_t* cwd)
+{
+    if(path == NULL)
     {
-        DMOD_LOG_ERROR("Failed to allocate memory for mount points\n");
-        return false;
+        return NULL;
     }
 
-    g_open_files = (file_t*)Dmod_Malloc(sizeof(file_t) * max_open_files);
-    if (g_open_files == NULL)
+    if(path[0] == '/')
     {
-        DMOD_LOG_ERROR("Failed to allocate memory for open files\n");
-        Dmod_Free(g_mount_points);
-        g_mount_points = NULL;
-        return false;
+        return duplicate_string(path);
     }
 
-    memset(g_mount_points, 0, sizeof(mount_point_t) * max_mount_points);
-    g_max_mount_points = max_mount_points;
-    g_max_open_files = max_open_files;
+    char* abs_path = NULL;
+    join_path((cwd->path != NULL) ? cwd->path : "", path, NULL, 0, &abs_path);
+    return abs_path;
+}
 
-    g_mutex = Dmod_Mutex_New(true);
-    if (g_mutex == NULL)
+/**
+ * @brief Find free mount point entry
+ * @return Pointer to free mount point entry, or NULL if none available
+ */
+static mount_point_t* find_free_mount_point(void)
+{
+    if(!is_initialized())
     {
-        DMOD_LOG_WARN("We could not initialize mutex - working in critical-sections mode...\n");
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return NULL;
     }
 
-    g_cwd = duplicate_string("/");
-    g_pwd = duplicate_string("/");
-    if (g_cwd == NULL || g_pwd == NULL)
+    for(int i = 0; i < g_max_mount_points; i++)
     {
-        DMOD_LOG_ERROR("Failed to allocate memory for CWD or PWD\n");
-        Dmod_Free(g_mount_points);
-        g_mount_points = NULL;
-        g_max_mount_points = 0;
-        if (g_cwd) Dmod_Free((void*)g_cwd);
-        if (g_pwd) Dmod_Free((void*)g_pwd);
-        g_cwd = NULL;
-        g_pwd = NULL;
-        if(g_mutex != NULL)
+        if(g_mount_points[i].mount_point == NULL)
         {
-            Dmod_Mutex_Delete(g_mutex);
+            return &g_mount_points[i];
         }
-        g_mutex = NULL;
-        return false;
     }
 
-    DMOD_LOG_INFO("== dmvfs ver " DMVFS_VERSION " ==\n");
-    DMOD_LOG_INFO("DMVFS initialized with max mount points: %d\n", max_mount_points);
-    return true;
+    DMOD_LOG_ERROR("No free mount points available\n");
+    return NULL;
 }
 
 /**
- * @brief Reinitialize DMVFS mutex
- * 
- * The function reinitializes the DMVFS mutex by destroying the old mutex
- * and creating a new one. This is useful in scenarios where the mutex
- * needs to be reset or recreated.
- * 
- * @return true on success, false on failure
+ * @brief Find mount point by path
+ * @param mount_point Mount point path
+ * @return Pointer to the mount point entry, or NULL if not found
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, bool, _reinit_mutex, (void))
+static mount_point_t* find_mount_point(const char* mount_point)
 {
-    if (!is_initialized())
+    if(!is_initialized())
     {
-        DMOD_LOG_WARN("DMVFS is not initialized\n");
-        return false;
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return NULL;
     }
 
-    if(g_mutex != NULL)
+    for(int i = 0; i < g_max_mount_points; i++)
     {
-        // Destroy the old mutex
-        Dmod_Mutex_Delete(g_mutex);
+        if(g_mount_points[i].state == MOUNT_STATE_ACTIVE &&
+           strcmp(g_mount_points[i].mount_point, mount_point) == 0)
+        {
+            return &g_mount_points[i];
+        }
     }
 
-    // Create a new mutex
-    g_mutex = Dmod_Mutex_New(true);
-    if (g_mutex == NULL)
+    DMOD_LOG_WARN("Mount point '%s' not found\n", mount_point);
+    return NULL;
+}
+
+/**
+ * @brief Compute the fingerprint of a path
+ *
+ * The fingerprint packs the first 4 characters of the path into a single
+ * integer (characters after the end of the path are 0), so a mount point
+ * can be rejected with one compare before its prefix is compared.
+ *
+ * @param path Path
+ * @return Fingerprint of the path
+ */
+static inline uint32_t path_fingerprint(const char* path)
+{
+    uint32_t fingerprint = 0;
+    for(int i = 0; i < 4 && path[i] != '\0'; i++)
     {
-        return false;
+        fingerprint |= (uint32_t)(unsigned char)path[i] << (8 * i);
     }
-
-    DMOD_LOG_INFO("DMVFS mutex reinitialized successfully\n");
-    return true;
+    return fingerprint;
 }
 
 /**
- * @brief Deinitialize DMVFS
- * 
- * The function deinitializes the DMVFS by freeing allocated resources,
- * including the mount points and the mutex. It ensures that the DMVFS
- * is properly cleaned up and ready for reinitialization if needed.
- * 
- * @return true on success, false on failure
+ * @brief Check if a path is inside of a mount point
+ * @param mp_entry Mount point entry (must be used)
+ * @param path Path to check
+ * @param fingerprint Fingerprint of the path (see path_fingerprint())
+ * @return true if the path starts with the mount point prefix
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, bool, _deinit, (void))
+static inline bool mount_point_matches(const mount_point_t* mp_entry, const char* path, uint32_t fingerprint)
 {
-    if (!is_initialized())
+    if((fingerprint & mp_entry->fingerprint_mask) != mp_entry->fingerprint)
     {
-        DMOD_LOG_WARN("DMVFS is not initialized\n");
         return false;
     }
+    return mp_entry->mount_point_length <= 4 ||
+           strncmp(path + 4, mp_entry->mount_point + 4, mp_entry->mount_point_length - 4) == 0;
+}
 
-    if (!lock_mutex())
+/**
+ * @brief Get mount point for a given path
+ * @param path File path
+ * @return Pointer to the mount point entry, or NULL if not found
+ */
+static mount_point_t* get_mount_point_for_path(const char* path)
+{
+    if(!is_initialized())
     {
-        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
-        return false;
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return NULL;
     }
 
-    // Free all mount points
-    for (int i = 0; i < g_max_mount_points; i++)
+    uint32_t fingerprint = path_fingerprint(path);
+    mount_point_t* found = NULL;
+    for(int i = 0; i < g_max_mount_points; i++)
     {
-        if (g_mount_points[i].mount_point != NULL)
+        if(g_mount_points[i].state == MOUNT_STATE_ACTIVE &&
+           (found == NULL || g_mount_points[i].mount_point_length > found->mount_point_length) &&
+           mount_point_matches(&g_mount_points[i], path, fingerprint))
         {
-            remove_mount_point(g_mount_points[i].mount_point);
+            found = &g_mount_points[i];
         }
     }
 
-    // Free the mount points array
-    Dmod_Free(g_mount_points);
-    Dmod_Free(g_open_files);
-    Dmod_Free(g_cwd);
-    Dmod_Free(g_pwd);
-    g_mount_points = NULL;
-    g_max_mount_points = 0;
-
-    // Destroy the mutex
-    unlock_mutex();
-    if(g_mutex != NULL)
+    if(found == NULL)
     {
-        Dmod_Mutex_Delete(g_mutex);
+        DMOD_LOG_WARN("No mount point found for path '%s'\n", path);
     }
-    g_mutex = NULL;
-
-    DMOD_LOG_INFO("DMVFS deinitialized successfully\n");
-    return true;
+    return found;
 }
 
 /**
- * @brief Get maximum number of mount points
- * 
- * @return Maximum number of mount points
+ * @brief Find mount point for a given path in a snapshot of the mount table
+ * @param table Snapshot of the mount table (can be NULL)
+ * @param path Absolute path
+ * @return Pointer to the mount point entry, or NULL if not found
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _get_max_mount_points, (void))
+static mount_point_t* find_in_mount_table(const mount_table_t* table, const char* path)
 {
-    if(!lock_mutex())
+    if(table == NULL)
     {
-        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
-        return -1;
+        return NULL;
     }
-    int result = g_max_mount_points;
-    unlock_mutex();
-    return result;
-}
 
-/**
- * @brief Get maximum number of open files
- * 
- * @return Maximum number of open files
+    uint32_t fingerprint = path_fingerprint(path);
+    for(int i = 0; i < table->count; i++)
+    {
+        if(mount_point_matches(table->entries[i], path, fingerprint))
+        {
+            return table->entries[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Publish a new snapshot of the mount table
+ *
+ * The function must be called with the mount writer lock taken and the DMVFS
+ * mutex locked. The snapshot of the active mount points is built in the table
+ * that is not published and swapped atomically. The caller has to call
+ * wait_for_mount_readers() before the writer lock is released (the mutex can
+ * be unlocked first), so the old table is not reused while it is read.
+ * The entries are sorted from the longest mount point, so the first match
+ * is the longest prefix of a path.
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _get_max_open_files, (void))
+static void publish_mount_table(void)
 {
-    if(!lock_mutex())
+    mount_table_t* table = (g_mount_table == &g_mount_tables[0]) ? &g_mount_tables[1] : &g_mount_tables[0];
+    table->count = 0;
+    for(int i = 0; i < g_max_mount_points; i++)
     {
-        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
-        return -1;
+        if(g_mount_points[i].state == MOUNT_STATE_ACTIVE)
+        {
+            int position = table->count++;
+            while(position > 0 &&
+                  table->entries[position - 1]->mount_point_length < g_mount_points[i].mount_point_length)
+            {
+                table->entries[position] = table->entries[position - 1];
+                position--;
+            }
+            table->entries[position] = &g_mount_points[i];
+        }
     }
-    int result = g_max_open_files;
-    unlock_mutex();
-    return result;
+    __atomic_store_n(&g_mount_table, table, __ATOMIC_RELEASE);
 }
 
 /**
- * @brief Mount file system
- * 
- * The function mounts a file system by its name at the specified mount point.
- * It initializes the file system using its init function and registers the
- * mount point in the DMVFS.
- * 
- * @param fs_name Name of the file system to mount
- * @param mount_point Mount point path
- * @param config Configuration string for the file system (file system specific)
- * @return true on success, false on failure
+ * @brief Find the working directory entry of a process
+ * @param pid Process ID
+ * @return Pointer to the entry, or NULL if the process uses the global working directory
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, bool, _mount_fs, (const char* fs_name, const char* mount_point, const char* config))
-{   
-    if(!is_initialized())
+static cwd_t* find_process_cwd(int pid)
+{
+    for(int i = 0; i < DMVFS_MAX_PROCESS_CWDS; i++)
     {
-        DMOD_LOG_ERROR("DMVFS is not initialized\n");
-        return false;
+        if(g_process_cwds[i].path != NULL && g_process_cwds[i].pid == pid)
+        {
+            return &g_process_cwds[i];
+        }
     }
+    return NULL;
+}
 
-    if(!lock_mutex())
+/**
+ * @brief Get the working directory used by a process
+ * @param pid Process ID
+ * @return Pointer to the process entry, or to the global working directory
+ */
+static cwd_t* get_cwd(int pid)
+{
+    cwd_t* cwd = find_process_cwd(pid);
+    return (cwd != NULL) ? cwd : &g_cwd;
+}
+
+/**
+ * @brief Get the working directory of the calling process
+ *
+ * The function must be called with the DMVFS mutex locked. Without the
+ * function set by dmvfs_set_getpid() the global working directory is used.
+ *
+ * @return Pointer to the process entry, or to the global working directory
+ */
+static cwd_t* current_cwd(void)
+{
+    dmvfs_getpid_t getpid = g_getpid;
+    return (getpid != NULL) ? get_cwd(getpid()) : &g_cwd;
+}
+
+/**
+ * @brief Get the ID of the calling process
+ *
+ * Files that DMVFS opens on behalf of the caller belong to the caller, so
+ * their I/O is charged to its throttling limits and I/O class.
+ *
+ * @return ID from the function set by dmvfs_set_getpid(), or 0 without it
+ */
+static int current_pid(void)
+{
+    dmvfs_getpid_t getpid = g_getpid;
+    return (getpid != NULL) ? getpid() : 0;
+}
+
+/**
+ * @brief Update the cached mount point of a working directory
+ *
+ * The longest mount point that contains the working directory is cached,
+ * but only if no other mount point is located below the working directory -
+ * otherwise a relative path could lead to it and the full scan is required.
+ *
+ * @param cwd Working directory entry
+ */
+static void refresh_cwd_mount_point(cwd_t* cwd)
+{
+    cwd->mount_point = NULL;
+    cwd->fs_path = NULL;
+    if(cwd->path == NULL)
     {
-        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
-        return false;
+        return;
     }
 
-    Dmod_Context_t* fs_context = find_fs_by_name(fs_name);
-    if(fs_context == NULL)
+    size_t cwd_len = strlen(cwd->path);
+    uint32_t fingerprint = path_fingerprint(cwd->path);
+    mount_point_t* found = NULL;
+    for(int i = 0; i < g_max_mount_points; i++)
     {
-        DMOD_LOG_ERROR("Cannot mount file system '%s': Not found\n", fs_name);
-        unlock_mutex();
-        return false;
+        const char* mount_point = g_mount_points[i].mount_point;
+        if(g_mount_points[i].state != MOUNT_STATE_ACTIVE)
+        {
+            continue;
+        }
+        if(g_mount_points[i].mount_point_length > cwd_len && strncmp(mount_point, cwd->path, cwd_len) == 0)
+        {
+            return;
+        }
+        if((found == NULL || g_mount_points[i].mount_point_length > found->mount_point_length) &&
+           mount_point_matches(&g_mount_points[i], cwd->path, fingerprint))
+        {
+            found = &g_mount_points[i];
+        }
     }
+    cwd->mount_point = found;
+    cwd->fs_path = (found != NULL) ? cwd->path + found->mount_point_length : NULL;
+}
 
-    mount_point_t* mp_entry = add_mount_point(mount_point, fs_context, config);
-    if(mp_entry == NULL)
+/**
+ * @brief Update the cached mount points of all working directories
+ */
+static void refresh_all_cwd_mount_points(void)
+{
+    refresh_cwd_mount_point(&g_cwd);
+    for(int i = 0; i < DMVFS_MAX_PROCESS_CWDS; i++)
     {
-        DMOD_LOG_ERROR("Cannot mount file system '%s'\n", fs_name);
-        unlock_mutex();
-        return false;
+        refresh_cwd_mount_point(&g_process_cwds[i]);
     }
+}
 
-    unlock_mutex();
-    DMOD_LOG_INFO("File system '%s' mounted at '%s' successfully\n", fs_name, mount_point);
-    return true;
+/**
+ * @brief Release a mount point that is not used anymore
+ *
+ * The function must be called with the DMVFS mutex locked, after the mount
+ * point was removed from the file tree and all its references were dropped.
+ * It deinitializes the backend and frees the entry.
+ *
+ * @param mp_entry Mount point entry
+ */
+static void finalize_mount_point(mount_point_t* mp_entry)
+{
+    dmod_dmfsi_deinit_t deinit_func = (dmod_dmfsi_deinit_t)Dmod_GetDifFunction(mp_entry->fs_context, dmod_dmfsi_deinit_sig);
+    if(deinit_func != NULL)
+    {
+        int result = deinit_func(mp_entry->mount_context);
+        if(result != 0)
+        {
+            DMOD_LOG_WARN("Failed to deinitialize mount context for mount point '%s'\n", mp_entry->mount_point);
+        }
+    }
+
+    const char* module_name = Dmod_GetName(mp_entry->fs_context);
+    if(module_name != NULL)
+    {
+        Dmod_EndUsage(module_name);
+    }
+    else
+    {
+        DMOD_LOG_ERROR("Failed to get module name of mount point '%s'\n", mp_entry->mount_point);
+    }
+
+    vfs_free(mp_entry->mount_point);
+    mp_entry->mount_point = NULL;
+    mp_entry->mount_point_length = 0;
+    mp_entry->fingerprint = 0;
+    mp_entry->fingerprint_mask = 0;
+    mp_entry->handles = 0;
+    memset(&mp_entry->ops, 0, sizeof(mp_entry->ops));
+    mp_entry->sched.params.max_active = 0;
+    mp_entry->mount_context = NULL;
+    mp_entry->fs_context = NULL;
+    __atomic_store_n(&mp_entry->state, MOUNT_STATE_UNUSED, __ATOMIC_SEQ_CST);
 }
 
 /**
- * @brief Unmount file system
- * 
- * The function unmounts a file system at the specified mount point.
- * It deinitializes the file system using its deinit function and removes
- * the mount point from the DMVFS.
- * 
- * @param mount_point Mount point path
- * @return true on success, false on failure
+ * @brief Release a lazily unmounted mount point if it is not referenced
+ *
+ * The function must be called with the DMVFS mutex locked.
+ *
+ * @param mp_entry Mount point entry
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, bool, _unmount_fs, (const char* mount_point))
+static void release_detached_mount_point(mount_point_t* mp_entry)
 {
-    if(!is_initialized())
+    if(__atomic_load_n(&mp_entry->state, __ATOMIC_SEQ_CST) == MOUNT_STATE_DETACHED &&
+       mp_entry->handles == 0 &&
+       __atomic_load_n(&mp_entry->in_flight, __ATOMIC_SEQ_CST) == 0)
     {
-        DMOD_LOG_ERROR("DMVFS is not initialized\n");
-        return false;
+        DMOD_LOG_INFO("Releasing lazily unmounted mount point '%s'\n", mp_entry->mount_point);
+        finalize_mount_point(mp_entry);
     }
+}
 
-    if(!lock_mutex())
+/**
+ * @brief Take a gate from the pool
+ *
+ * A gate is a DMOD mutex that its owner keeps locked while the others may
+ * have to wait for it - a scheduled I/O request until io_sched_end(), a pin
+ * of a mount point until unpin_mount_point(). The others block on the gate
+ * instead of polling, so the RTOS can run other tasks (and boost the owner
+ * if the mutex supports priority inheritance). Gates are created on demand
+ * and kept in the pool until dmvfs_deinit().
+ *
+ * @return Gate with one reference, or NULL if no mutex could be created
+ */
+static gate_t* gate_get(void)
+{
+    Dmod_EnterCritical();
+    gate_t* gate = g_gates;
+    if(gate != NULL)
     {
-        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
-        return false;
+        g_gates = gate->next;
     }
+    Dmod_ExitCritical();
 
-    if(!remove_mount_point(mount_point))
+    if(gate == NULL)
+    {
+        gate = (gate_t*)vfs_malloc(sizeof(gate_t));
+        if(gate == NULL)
+        {
+            return NULL;
+        }
+        gate->mutex = Dmod_Mutex_New(false);
+        if(gate->mutex == NULL)
+        {
+            vfs_free(gate);
+            return NULL;
+        }
+    }
+    gate->next = NULL;
+    gate->refs = 1;
+    return gate;
+}
+
+/**
+ * @brief Drop a reference of a gate
+ *
+ * The gate goes back to the pool when its owner and all the requests that
+ * wait on it have dropped their references, so it is never reused while
+ * somebody can still lock it.
+ *
+ * @param gate Gate
+ */
+static void gate_put(gate_t* gate)
+{
+    if(__atomic_sub_fetch(&gate->refs, 1, __ATOMIC_ACQ_REL) == 0)
+    {
+        Dmod_EnterCritical();
+        gate->next = g_gates;
+        g_gates = gate;
+        Dmod_ExitCritical();
+    }
+}
+
+/**
+ * @brief Take an in-flight reference of a mount point
+ *
+ * A pinned mount point is not released until the reference is dropped, so a
+ * backend can be called without the DMVFS mutex. The mount point must be
+ * reachable when it is pinned - either with the mutex locked or from a read
+ * section of the mount table. The pin keeps a locked gate in the list of the
+ * mount point, so an unmount can block on it (see drain_mount_point()).
+ *
+ * @param mp_entry Mount point entry
+ * @param pin Pin to fill (must live until unpin_mount_point())
+ */
+static inline void pin_mount_point(mount_point_t* mp_entry, mount_pin_t* pin)
+{
+    pin->mount_point = mp_entry;
+    // A gate from the pool is not locked by anybody, so this never blocks
+    pin->gate = gate_get();
+    if(pin->gate != NULL)
+    {
+        Dmod_Mutex_Lock(pin->gate->mutex);
+    }
+
+    ticket_lock(&mp_entry->sched.lock);
+    __atomic_fetch_add(&mp_entry->in_flight, 1, __ATOMIC_SEQ_CST);
+    if(pin->gate != NULL)
+    {
+        pin->next = mp_entry->pins;
+        mp_entry->pins = pin;
+    }
+    ticket_unlock(&mp_entry->sched.lock);
+}
+
+/**
+ * @brief Drop an in-flight reference of a mount point
+ *
+ * The function must be called without the DMVFS mutex - when the last
+ * reference of a lazily unmounted mount point is dropped, the mutex is
+ * locked to release it.
+ *
+ * @param pin Pin filled by pin_mount_point()
+ */
+static inline void unpin_mount_point(mount_pin_t* pin)
+{
+    mount_point_t* mp_entry = pin->mount_point;
+    ticket_lock(&mp_entry->sched.lock);
+    if(pin->gate != NULL)
+    {
+        for(mount_pin_t** link = &mp_entry->pins; *link != NULL; link = &(*link)->next)
+        {
+            if(*link == pin)
+            {
+                *link = pin->next;
+                break;
+            }
+        }
+    }
+    uint32_t in_flight = __atomic_sub_fetch(&mp_entry->in_flight, 1, __ATOMIC_SEQ_CST);
+    ticket_unlock(&mp_entry->sched.lock);
+
+    // Wake up an unmount that waits on the gate - it checks the references again
+    if(pin->gate != NULL)
+    {
+        Dmod_Mutex_Unlock(pin->gate->mutex);
+        gate_put(pin->gate);
+        pin->gate = NULL;
+    }
+
+    if(in_flight == 0 && __atomic_load_n(&mp_entry->state, __ATOMIC_SEQ_CST) == MOUNT_STATE_DETACHED)
+    {
+        if(!lock_mutex())
+        {
+            DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+            return;
+        }
+        release_detached_mount_point(mp_entry);
+        unlock_mutex();
+    }
+}
+
+/**
+ * @brief Release the DMVFS mutex before a call of a thread safe backend
+ *
+ * Backends that advertise DMVFS_CAP_THREAD_SAFE are called without the
+ * DMVFS mutex, so calls to them are not serialized with other mounts. The
+ * mount point is pinned for the time of the call instead, so it cannot be
+ * released while the call is running.
+ *
+ * @param mp_entry Mount point of the backend that is going to be called
+ * @param pin Pin to fill if the mutex is released
+ * @return Pin of the mount point if the mutex was released, NULL if it is still locked
+ */
+static inline mount_pin_t* unlock_for_backend(mount_point_t* mp_entry, mount_pin_t* pin)
+{
+    if(mp_entry->ops.caps & DMVFS_CAP_THREAD_SAFE)
+    {
+        pin_mount_point(mp_entry, pin);
+        unlock_mutex();
+        return pin;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Unlock the DMVFS mutex after a backend call
+ * @param pinned Value returned by unlock_for_backend()
+ */
+static inline void unlock_after_backend(mount_pin_t* pinned)
+{
+    if(pinned == NULL)
     {
-        DMOD_LOG_ERROR("Cannot unmount file system at mount point '%s'\n", mount_point);
         unlock_mutex();
+    }
+    else
+    {
+        unpin_mount_point(pinned);
+    }
+}
+
+/**
+ * @brief Check if a file or directory handle can be used
+ *
+ * Handles of a force unmounted file system are invalidated at once by the
+ * state of their mount point - they can only be closed from then on.
+ *
+ * @param file_entry File entry
+ * @return true if the handle is open and its mount point is usable
+ */
+static inline bool is_file_valid(const file_t* file_entry)
+{
+    return file_entry->mount_point != NULL && file_entry->fs_file != NULL &&
+           file_entry->mount_point->state != MOUNT_STATE_CLOSING;
+}
+
+/**
+ * @brief Register an opened file or directory in a file entry
+ *
+ * The function must be called with the DMVFS mutex locked.
+ *
+ * @param file_entry Free file entry
+ * @param mp_entry Mount point of the handle
+ * @param fs_file Handle of the file system
+ * @param pid Process ID of the owner
+ * @param is_dir true for a directory handle
+ */
+static void assign_file_entry(file_t* file_entry, mount_point_t* mp_entry, void* fs_file, int pid, bool is_dir)
+{
+    file_entry->mount_point = mp_entry;
+    file_entry->fs_file = fs_file;
+    file_entry->pid = pid;
+    file_entry->is_dir = is_dir;
+    file_entry->io_class = -1;
+    mp_entry->handles++;
+}
+
+/**
+ * @brief Get a base for the resolution of paths relative to a directory handle
+ * @param dir_entry Directory handle
+ * @param base Pointer to store the base (valid while the handle is open)
+ * @return true on success, false if the handle is not an open directory
+ */
+static bool get_dir_base(const file_t* dir_entry, cwd_t* base)
+{
+    if(!is_file_valid(dir_entry) || !dir_entry->is_dir || dir_entry->fs_path == NULL)
+    {
         return false;
     }
 
-    unlock_mutex();
-    DMOD_LOG_INFO("File system at mount point '%s' unmounted successfully\n", mount_point);
+    base->path = NULL;
+    base->mount_point = dir_entry->mount_point;
+    base->fs_path = dir_entry->fs_path;
+    base->pid = dir_entry->pid;
     return true;
 }
 
 /**
- * @brief Open a file in the DMVFS
- * 
- * This function opens a file at the specified path with the given mode and attributes.
- * It resolves the mount point for the file, invokes the file system's open function,
- * and registers the file in the DMVFS open file table.
- * 
- * @param fp Pointer to store the file handle
- * @param path Path to the file to open
- * @param mode File open mode (e.g., read, write)
- * @param attr File attributes
- * @param pid Process ID of the caller
- * 
- * @return 0 on success, -1 on failure
+ * @brief Take a buffer from the bounce buffer pool
+ * @return Aligned buffer of g_bounce.size bytes, or NULL if the pool is empty
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _fopen, (void** fp, const char* path, int mode, int attr, int pid))
+static void* bounce_take(void)
+{
+    uint32_t mask = __atomic_load_n(&g_bounce.free_mask, __ATOMIC_ACQUIRE);
+    while(mask != 0)
+    {
+        uint32_t index = (uint32_t)__builtin_ctz(mask);
+        if(__atomic_compare_exchange_n(&g_bounce.free_mask, &mask, mask & ~(1u << index), true,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            return g_bounce.buffers + index * g_bounce.size;
+        }
+    }
+    __atomic_fetch_add(&g_bounce.stats.misses, 1, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+/**
+ * @brief Give a buffer back to the bounce buffer pool
+ * @param buffer Buffer returned by bounce_take()
+ */
+static void bounce_give(void* buffer)
+{
+    uint32_t index = (uint32_t)(((uint8_t*)buffer - g_bounce.buffers) / g_bounce.size);
+    __atomic_fetch_or(&g_bounce.free_mask, 1u << index, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Check if a transfer has to be staged in a bounce buffer
+ *
+ * Transfers are staged only for backends that advertise DMVFS_CAP_ALIGNED_IO,
+ * when the buffer of the caller is not aligned and the transfer is large
+ * enough for the copy to be cheaper than the unaligned access in the backend.
+ *
+ * @param mp_entry Mount point of the transfer
+ * @param buffer Buffer of the caller
+ * @param size Size of the transfer
+ * @return true if the transfer should go through the bounce buffer pool
+ */
+static inline bool needs_bounce(const mount_point_t* mp_entry, const void* buffer, size_t size)
+{
+    uint32_t alignment = mp_entry->ops.alignment;
+    return (mp_entry->ops.caps & DMVFS_CAP_ALIGNED_IO) && size >= DMVFS_BOUNCE_MIN_TRANSFER &&
+           alignment != 0 && ((uintptr_t)buffer & (alignment - 1)) != 0 &&
+           g_bounce.count != 0 && alignment <= g_bounce.alignment;
+}
+
+/**
+ * @brief Read from a file in the backend, staging unaligned transfers
+ * @param file_entry File entry
+ * @param fread_func Read function of the backend
+ * @param buffer Buffer of the caller
+ * @param size Number of bytes to read
+ * @param read_bytes Pointer to store the number of bytes read
+ * @return Result of the backend
+ */
+static int backend_read(file_t* file_entry, dmod_dmfsi_fread_t fread_func, void* buffer, size_t size, size_t* read_bytes)
+{
+    mount_point_t* mp_entry = file_entry->mount_point;
+    uint8_t* bounce = needs_bounce(mp_entry, buffer, size) ? bounce_take() : NULL;
+    if(bounce == NULL)
+    {
+        return fread_func(mp_entry->mount_context, file_entry->fs_file, buffer, size, read_bytes);
+    }
+
+    int result = 0;
+    size_t total = 0;
+    while(total < size)
+    {
+        size_t chunk = (size - total < g_bounce.size) ? size - total : g_bounce.size;
+        size_t chunk_read = 0;
+        result = fread_func(mp_entry->mount_context, file_entry->fs_file, bounce, chunk, &chunk_read);
+        memcpy((uint8_t*)buffer + total, bounce, chunk_read);
+        total += chunk_read;
+        if(result != 0 || chunk_read < chunk)
+        {
+            break;
+        }
+    }
+    bounce_give(bounce);
+
+    __atomic_fetch_add(&g_bounce.stats.staged, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&g_bounce.stats.staged_bytes, total, __ATOMIC_RELAXED);
+    *read_bytes = total;
+    return result;
+}
+
+/**
+ * @brief Write to a file in the backend, staging unaligned transfers
+ * @param file_entry File entry
+ * @param fwrite_func Write function of the backend
+ * @param buffer Buffer of the caller
+ * @param size Number of bytes to write
+ * @param written_bytes Pointer to store the number of bytes written
+ * @return Result of the backend
+ */
+static int backend_write(file_t* file_entry, dmod_dmfsi_fwrite_t fwrite_func, const void* buffer, size_t size, size_t* written_bytes)
+{
+    mount_point_t* mp_entry = file_entry->mount_point;
+    uint8_t* bounce = needs_bounce(mp_entry, buffer, size) ? bounce_take() : NULL;
+    if(bounce == NULL)
+    {
+        return fwrite_func(mp_entry->mount_context, file_entry->fs_file, buffer, size, written_bytes);
+    }
+
+    int result = 0;
+    size_t total = 0;
+    while(total < size)
+    {
+        size_t chunk = (size - total < g_bounce.size) ? size - total : g_bounce.size;
+        size_t chunk_written = 0;
+        memcpy(bounce, (const uint8_t*)buffer + total, chunk);
+        result = fwrite_func(mp_entry->mount_context, file_entry->fs_file, bounce, chunk, &chunk_written);
+        total += chunk_written;
+        if(result != 0 || chunk_written < chunk)
+        {
+            break;
+        }
+    }
+    bounce_give(bounce);
+
+    __atomic_fetch_add(&g_bounce.stats.staged, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&g_bounce.stats.staged_bytes, total, __ATOMIC_RELAXED);
+    *written_bytes = total;
+    return result;
+}
+
+/**
+ * @brief Count a backend write in the write coalescing statistics
+ * @param mp_entry Mount point entry
+ * @param offset File offset of the write
+ * @param size Number of written bytes
+ */
+static void coalesce_account(mount_point_t* mp_entry, long offset, size_t size)
+{
+    uint32_t program_size = mp_entry->coalesce.program_size;
+    if(program_size == 0 || size == 0 || offset < 0)
+    {
+        return;
+    }
+    uint64_t first = (uint64_t)offset / program_size;
+    uint64_t last = ((uint64_t)offset + size - 1) / program_size;
+    dmvfs_coalesce_stats_t* stats = &mp_entry->coalesce_stats;
+    __atomic_fetch_add(&stats->backend_writes, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->backend_bytes, size, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->programmed_bytes, (last - first + 1) * program_size, __ATOMIC_RELAXED);
+    if((uint64_t)offset % program_size == 0 && ((uint64_t)offset + size) % program_size == 0)
+    {
+        __atomic_fetch_add(&stats->aligned_writes, 1, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief Write data of a file directly to the backend
+ * @param file_entry File entry
+ * @param fwrite_func Write function of the backend
+ * @param offset File offset of the data (for the statistics)
+ * @param data Data to write
+ * @param size Size of the data
+ * @return 0 on success, -1 on failure
+ */
+static int write_through(file_t* file_entry, dmod_dmfsi_fwrite_t fwrite_func, long offset, const void* data, size_t size)
+{
+    size_t written = 0;
+    int result = backend_write(file_entry, fwrite_func, data, size, &written);
+    coalesce_account(file_entry->mount_point, offset, written);
+    return (result == 0 && written == size) ? 0 : -1;
+}
+
+/**
+ * @brief Write the content of the write buffer of a file to the backend
+ *
+ * Only the data that reached the backend leaves the buffer, so a failed
+ * write keeps the rest buffered at the right file offset and the next flush
+ * retries it.
+ *
+ * @param file_entry File entry
+ * @param fwrite_func Write function of the backend
+ * @return 0 on success, -1 on failure
+ */
+static int write_buffered_data(file_t* file_entry, dmod_dmfsi_fwrite_t fwrite_func)
+{
+    uint32_t size = file_entry->write_buffered;
+    size_t written = 0;
+    int result = backend_write(file_entry, fwrite_func, file_entry->write_buffer, size, &written);
+    if(written > size)
+    {
+        written = size;
+    }
+    coalesce_account(file_entry->mount_point, file_entry->write_offset, written);
+    if(written != 0 && written < size)
+    {
+        memmove(file_entry->write_buffer, file_entry->write_buffer + written, size - written);
+    }
+    file_entry->write_buffered = size - (uint32_t)written;
+    file_entry->write_offset += (long)written;
+    return (result == 0 && written == size) ? 0 : -1;
+}
+
+/**
+ * @brief Write the buffered data of a file to the backend
+ *
+ * The function must be called before any other operation of the handle
+ * reaches the backend, so the buffered writes are not reordered with it.
+ * On failure the data that was not written stays in the buffer.
+ *
+ * @param file_entry File entry
+ * @return 0 on success (or if nothing is buffered), -1 on failure
+ */
+static int flush_write_buffer(file_t* file_entry)
+{
+    if(file_entry->write_buffered == 0)
+    {
+        return 0;
+    }
+
+    dmod_dmfsi_fwrite_t fwrite_func = (dmod_dmfsi_fwrite_t)Dmod_GetDifFunction(
+        file_entry->mount_point->fs_context, dmod_dmfsi_fwrite_sig);
+    if(fwrite_func == NULL)
+    {
+        return -1;
+    }
+    __atomic_fetch_add(&file_entry->mount_point->coalesce_stats.partial_flushes, 1, __ATOMIC_RELAXED);
+    return write_buffered_data(file_entry, fwrite_func);
+}
+
+/**
+ * @brief Release the write buffer of a file (buffered data is dropped)
+ * @param file_entry File entry
+ */
+static void drop_write_buffer(file_t* file_entry)
+{
+    if(file_entry->write_buffer != NULL)
+    {
+        vfs_free(file_entry->write_buffer);
+        file_entry->write_buffer = NULL;
+    }
+    file_entry->write_buffer_size = 0;
+    file_entry->write_buffered = 0;
+}
+
+/**
+ * @brief Write data through the write coalescing buffer of a file
+ *
+ * Writes are collected in a buffer that ends at the next block boundary of
+ * the file (erase block, or program block if the erase size is not set) and
+ * reach the backend only when the block is complete, so the flash sees
+ * aligned writes. Writes that cover whole blocks from a block boundary skip
+ * the buffer.
+ *
+ * @param file_entry File entry
+ * @param fwrite_func Write function of the backend
+ * @param data Data to write
+ * @param size Size of the data
+ * @return 0 on success, -1 on failure
+ */
+static int coalesce_write(file_t* file_entry, dmod_dmfsi_fwrite_t fwrite_func, const void* data, size_t size)
+{
+    mount_point_t* mp_entry = file_entry->mount_point;
+    uint32_t block = (mp_entry->coalesce.erase_size != 0) ? mp_entry->coalesce.erase_size : mp_entry->coalesce.program_size;
+    __atomic_fetch_add(&mp_entry->coalesce_stats.writes, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&mp_entry->coalesce_stats.bytes, size, __ATOMIC_RELAXED);
+
+    if(file_entry->write_buffer_size != block)
+    {
+        if(flush_write_buffer(file_entry) != 0)
+        {
+            return -1;
+        }
+        drop_write_buffer(file_entry);
+        file_entry->write_buffer = vfs_malloc(block);
+        file_entry->write_buffer_size = (file_entry->write_buffer != NULL) ? block : 0;
+    }
+
+    if(file_entry->write_buffered == 0)
+    {
+        dmod_dmfsi_tell_t tell_func = (dmod_dmfsi_tell_t)Dmod_GetDifFunction(mp_entry->fs_context, dmod_dmfsi_tell_sig);
+        file_entry->write_offset = (tell_func != NULL) ? tell_func(mp_entry->mount_context, file_entry->fs_file) : -1;
+    }
+    if(file_entry->write_buffer == NULL || file_entry->write_offset < 0)
+    {
+        // The buffer or the file position is not available - nothing to align to
+        return write_through(file_entry, fwrite_func, -1, data, size);
+    }
+
+    const uint8_t* source = (const uint8_t*)data;
+    while(size > 0)
+    {
+        uint64_t end = (uint64_t)file_entry->write_offset + file_entry->write_buffered;
+        if(file_entry->write_buffered != 0 && end % block == 0)
+        {
+            // A complete block that failed to reach the backend before
+            if(write_buffered_data(file_entry, fwrite_func) != 0)
+            {
+                return -1;
+            }
+            continue;
+        }
+        if(file_entry->write_buffered == 0 && end % block == 0 && size >= block)
+        {
+            size_t length = size - size % block;
+            if(write_through(file_entry, fwrite_func, file_entry->write_offset, source, length) != 0)
+            {
+                return -1;
+            }
+            file_entry->write_offset += (long)length;
+            source += length;
+            size -= length;
+            continue;
+        }
+
+        size_t room = block - (size_t)(end % block);
+        size_t length = (size < room) ? size : room;
+        memcpy(file_entry->write_buffer + file_entry->write_buffered, source, length);
+        file_entry->write_buffered += (uint32_t)length;
+        source += length;
+        size -= length;
+        if(length == room && write_buffered_data(file_entry, fwrite_func) != 0)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Release a file entry
+ *
+ * The function must be called with the DMVFS mutex locked. When the last
+ * handle of a lazily unmounted file system is released, the mount point is
+ * released as well.
+ *
+ * @param file_entry File entry to release
+ */
+static void release_file_entry(file_t* file_entry)
+{
+    mount_point_t* mp_entry = file_entry->mount_point;
+    drop_write_buffer(file_entry);
+    file_entry->mount_point = NULL;
+    file_entry->fs_file = NULL;
+    file_entry->pid = 0;
+    file_entry->is_dir = false;
+    file_entry->revoked = false;
+    file_entry->mode = 0;
+    vfs_free(file_entry->fs_path);
+    file_entry->fs_path = NULL;
+    if(mp_entry != NULL)
+    {
+        mp_entry->handles--;
+        release_detached_mount_point(mp_entry);
+    }
+}
+
+/**
+ * @brief Get the size of a token bucket
+ * @param rate Tokens per second
+ * @param burst Size of the bucket (0 for one second of tokens)
+ * @return Capacity of the bucket (scaled by DMVFS_TOKEN_SCALE)
+ */
+static inline int64_t token_bucket_capacity(uint32_t rate, uint32_t burst)
+{
+    return (int64_t)((burst != 0) ? burst : rate) * DMVFS_TOKEN_SCALE;
+}
+
+/**
+ * @brief Set the limits of a token bucket and fill it up
+ * @param bucket Token bucket
+ * @param limits New limits (NULL to remove the limits)
+ */
+static void token_bucket_setup(token_bucket_t* bucket, const dmvfs_throttle_t* limits)
+{
+    memset(bucket, 0, sizeof(*bucket));
+    if(limits != NULL)
+    {
+        bucket->limits = *limits;
+    }
+    bucket->bytes = token_bucket_capacity(bucket->limits.bytes_per_sec, bucket->limits.burst_bytes);
+    bucket->ops = token_bucket_capacity(bucket->limits.ops_per_sec, bucket->limits.burst_ops);
+    bucket->updated = (g_clock != NULL) ? g_clock() : 0;
+}
+
+/**
+ * @brief Add the tokens earned in the elapsed time
+ * @param tokens Tokens of the bucket (scaled by DMVFS_TOKEN_SCALE)
+ * @param rate Tokens per second
+ * @param burst Size of the bucket (0 for one second of tokens)
+ * @param elapsed Elapsed time in microseconds
+ */
+static void token_bucket_fill(int64_t* tokens, uint32_t rate, uint32_t burst, uint64_t elapsed)
+{
+    if(rate == 0)
+    {
+        return;
+    }
+    int64_t capacity = token_bucket_capacity(rate, burst);
+    if(*tokens >= capacity)
+    {
+        return;
+    }
+    uint64_t room = (uint64_t)(capacity - *tokens);
+    *tokens = (elapsed >= room / rate + 1) ? capacity : *tokens + (int64_t)(elapsed * rate);
+}
+
+/**
+ * @brief Get the time until a bucket has enough tokens for a request
+ *
+ * A request larger than the bucket needs only a full bucket - it leaves the
+ * bucket in debt, which delays the following requests instead.
+ *
+ * @param tokens Tokens of the bucket (scaled by DMVFS_TOKEN_SCALE)
+ * @param cost Tokens needed by the request (scaled by DMVFS_TOKEN_SCALE)
+ * @param rate Tokens per second
+ * @param burst Size of the bucket (0 for one second of tokens)
+ * @return Time to wait in microseconds, 0 if the request can go now
+ */
+static uint64_t token_bucket_wait(int64_t tokens, int64_t cost, uint32_t rate, uint32_t burst)
+{
+    if(rate == 0)
+    {
+        return 0;
+    }
+    int64_t capacity = token_bucket_capacity(rate, burst);
+    int64_t needed = ((cost < capacity) ? cost : capacity) - tokens;
+    return (needed <= 0) ? 0 : (uint64_t)needed / rate + 1;
+}
+
+/**
+ * @brief Take the tokens of a read or write from the buckets of its file
+ *
+ * The function must be called with the DMVFS mutex locked. A request goes
+ * through when the buckets of the process and of the mount point have the
+ * tokens it needs, and then takes them from both.
+ *
+ * @param file_entry File entry of the request
+ * @param size Size of the request in bytes
+ * @return 0 if the tokens were taken, otherwise time to wait in microseconds
+ */
+static uint64_t throttle_take(const file_t* file_entry, size_t size)
+{
+    token_bucket_t* buckets[2] = { &file_entry->mount_point->throttle, NULL };
+    for(int i = 0; i < DMVFS_MAX_THROTTLED_PIDS; i++)
+    {
+        if(g_pid_throttles[i].used && g_pid_throttles[i].pid == file_entry->pid)
+        {
+            buckets[1] = &g_pid_throttles[i].bucket;
+            break;
+        }
+    }
+
+    int64_t cost = (int64_t)((size > UINT32_MAX) ? UINT32_MAX : size) * DMVFS_TOKEN_SCALE;
+    uint64_t now = g_clock();
+    uint64_t wait = 0;
+    for(int i = 0; i < 2; i++)
+    {
+        token_bucket_t* bucket = buckets[i];
+        if(bucket == NULL)
+        {
+            continue;
+        }
+        uint64_t elapsed = now - bucket->updated;
+        bucket->updated = now;
+        token_bucket_fill(&bucket->bytes, bucket->limits.bytes_per_sec, bucket->limits.burst_bytes, elapsed);
+        token_bucket_fill(&bucket->ops, bucket->limits.ops_per_sec, bucket->limits.burst_ops, elapsed);
+        uint64_t bytes_wait = token_bucket_wait(bucket->bytes, cost, bucket->limits.bytes_per_sec, bucket->limits.burst_bytes);
+        uint64_t ops_wait = token_bucket_wait(bucket->ops, DMVFS_TOKEN_SCALE, bucket->limits.ops_per_sec, bucket->limits.burst_ops);
+        wait = (bytes_wait > wait) ? bytes_wait : wait;
+        wait = (ops_wait > wait) ? ops_wait : wait;
+    }
+    if(wait != 0)
+    {
+        return wait;
+    }
+
+    for(int i = 0; i < 2; i++)
+    {
+        token_bucket_t* bucket = buckets[i];
+        if(bucket == NULL)
+        {
+            continue;
+        }
+        if(bucket->limits.bytes_per_sec != 0)
+        {
+            bucket->bytes -= cost;
+        }
+        if(bucket->limits.ops_per_sec != 0)
+        {
+            bucket->ops -= DMVFS_TOKEN_SCALE;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Delay a read or write until the throttling limits allow it
+ *
+ * The function must be called with the DMVFS mutex locked. The caller sleeps
+ * with the function set by dmvfs_set_sleep() and the mutex unlocked, so the
+ * other processes are not held off. Without a sleep function the request
+ * fails at once with DMVFS_ERR_AGAIN - DMVFS never polls the clock. Limits
+ * are enforced only if a clock is set.
+ *
+ * @param file_entry File entry of the request
+ * @param size Size of the request in bytes
+ * @return 0 with the mutex locked if the request can go, DMVFS_ERR_AGAIN or
+ *         -1 (the handle was closed in the meantime) with the mutex unlocked
+ */
+static int throttle_io(file_t* file_entry, size_t size)
+{
+    if(g_clock == NULL)
+    {
+        return 0;
+    }
+
+    for(;;)
+    {
+        uint64_t wait = throttle_take(file_entry, size);
+        if(wait == 0)
+        {
+            return 0;
+        }
+
+        dmvfs_sleep_t sleep = g_sleep;
+        unlock_mutex();
+        if(sleep == NULL)
+        {
+            return DMVFS_ERR_AGAIN;
+        }
+        sleep(wait);
+        if(!lock_mutex())
+        {
+            DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+            return -1;
+        }
+        if(!is_file_valid(file_entry))
+        {
+            unlock_mutex();
+            return -1;
+        }
+    }
+}
+
+/**
+ * @brief Get the I/O class of a request on a file
+ *
+ * The function must be called with the DMVFS mutex locked. The class of the
+ * handle is used if it is set, then the class of the process that owns it.
+ *
+ * @param file_entry File entry
+ * @return I/O class (DMVFS_IO_CLASS_*)
+ */
+static int get_io_class(const file_t* file_entry)
+{
+    if(file_entry->io_class >= 0)
+    {
+        return file_entry->io_class;
+    }
+    for(int i = 0; i < DMVFS_MAX_IO_CLASS_PIDS; i++)
+    {
+        if(g_io_classes[i].used && g_io_classes[i].pid == file_entry->pid)
+        {
+            return g_io_classes[i].io_class;
+        }
+    }
+    return DMVFS_IO_CLASS_BE;
+}
+
+/**
+ * @brief Check if a queued I/O request should be dispatched before another one
+ *
+ * Requests that missed their deadline go first (the earliest deadline wins),
+ * so lower classes are not starved. Otherwise the class decides, then the
+ * deadline and the arrival order.
+ *
+ * @param a Candidate request
+ * @param b Current best request
+ * @param now Current clock value
+ * @return true if a is more urgent than b
+ */
+static bool io_request_before(const io_request_t* a, const io_request_t* b, uint64_t now)
+{
+    bool a_expired = a->deadline <= now;
+    bool b_expired = b->deadline <= now;
+    if(a_expired != b_expired)
+    {
+        return a_expired;
+    }
+    if(!a_expired && a->io_class != b->io_class)
+    {
+        return a->io_class < b->io_class;
+    }
+    if(a->deadline != b->deadline)
+    {
+        return a->deadline < b->deadline;
+    }
+    return (int32_t)(a->sequence - b->sequence) < 0;
+}
+
+/**
+ * @brief Finish a request admitted by io_sched_begin()
+ *
+ * The dispatch slot of the request is passed to the most urgent request in
+ * the queue and the in-flight reference of the mount point is dropped. The
+ * function must be called without the DMVFS mutex.
+ *
+ * @param request Request passed to io_sched_begin()
+ */
+static void io_sched_end(io_request_t* request)
+{
+    mount_point_t* mp_entry = request->mount_point;
+    if(mp_entry == NULL)
+    {
+        return;
+    }
+    request->mount_point = NULL;
+
+    io_sched_t* sched = &mp_entry->sched;
+    uint64_t now = (g_clock != NULL) ? g_clock() : 0;
+    ticket_lock(&sched->lock);
+    for(io_request_t** link = &sched->running; *link != NULL; link = &(*link)->next)
+    {
+        if(*link == request)
+        {
+            *link = request->next;
+            break;
+        }
+    }
+
+    io_request_t** best = NULL;
+    for(io_request_t** link = &sched->queue; *link != NULL; link = &(*link)->next)
+    {
+        if(best == NULL || io_request_before(*link, *best, now))
+        {
+            best = link;
+        }
+    }
+    if(best == NULL)
+    {
+        sched->active--;
+    }
+    else
+    {
+        io_request_t* next = *best;
+        *best = next->next;
+        sched->stats.queue_depth--;
+        uint64_t wait = (now > next->enqueued) ? now - next->enqueued : 0;
+        sched->stats.total_wait += wait;
+        if(wait > sched->stats.max_wait)
+        {
+            sched->stats.max_wait = wait;
+        }
+        if(next->deadline < now)
+        {
+            sched->stats.deadline_misses++;
+        }
+        next->granted = true;
+        next->next = sched->running;
+        sched->running = next;
+    }
+    ticket_unlock(&sched->lock);
+
+    // Wake up the requests waiting on the gate - they check if they were dispatched
+    if(request->gate != NULL)
+    {
+        Dmod_Mutex_Unlock(request->gate->mutex);
+        gate_put(request->gate);
+        request->gate = NULL;
+    }
+    unpin_mount_point(&request->pin);
+}
+
+/**
+ * @brief Wait until a queued request is dispatched
+ *
+ * The function must be called without the DMVFS mutex. A DMOD mutex can only
+ * be unlocked by its owner, so the request cannot block on something the
+ * granter releases. When several requests are dispatched, any of them can
+ * grant the slot, so the request checks again after each spin_wait() backoff
+ * if a sleep function is set. Otherwise (or when a single request is
+ * dispatched) it blocks on the gate of the oldest dispatched request, which
+ * is unlocked when that request ends, and checks again. When no dispatched
+ * request has a gate the request is removed from the queue - the function
+ * never spins without sleeping.
+ *
+ * @param sched I/O scheduler of the mount point
+ * @param request Queued request
+ * @return true when the request was dispatched, false if it was removed
+ */
+static bool io_sched_wait(io_sched_t* sched, io_request_t* request)
+{
+    uint32_t spins = 0;
+    ticket_lock(&sched->lock);
+    while(!request->granted)
+    {
+        gate_t* gate = NULL;
+        uint32_t dispatched = 0;
+        for(io_request_t* running = sched->running; running != NULL; running = running->next)
+        {
+            dispatched++;
+            if(running->gate != NULL)
+            {
+                gate = running->gate;
+            }
+        }
+
+        if(dispatched > 1 && g_sleep != NULL)
+        {
+            ticket_unlock(&sched->lock);
+            spin_wait(&spins);
+            ticket_lock(&sched->lock);
+            continue;
+        }
+
+        if(gate == NULL)
+        {
+            for(io_request_t** link = &sched->queue; *link != NULL; link = &(*link)->next)
+            {
+                if(*link == request)
+                {
+                    *link = request->next;
+                    break;
+                }
+            }
+            sched->stats.queue_depth--;
+            ticket_unlock(&sched->lock);
+            return false;
+        }
+
+        __atomic_add_fetch(&gate->refs, 1, __ATOMIC_ACQ_REL);
+        ticket_unlock(&sched->lock);
+        Dmod_Mutex_Lock(gate->mutex);
+        Dmod_Mutex_Unlock(gate->mutex);
+        gate_put(gate);
+        ticket_lock(&sched->lock);
+    }
+    ticket_unlock(&sched->lock);
+    return true;
+}
+
+/**
+ * @brief Wait until the I/O scheduler of the mount point admits a request
+ *
+ * The function must be called with the DMVFS mutex locked. When the mount
+ * point has free dispatch slots and nobody is waiting the request goes
+ * through at once, otherwise it is queued and the caller waits with the
+ * mutex unlocked until io_sched_end() of another request dispatches it
+ * (see io_sched_wait()). The request keeps the mount point pinned until
+ * io_sched_end(), so an unmount drains the queued and the dispatched
+ * requests first.
+ *
+ * @param file_entry File entry of the request
+ * @param request Request to fill (must live until io_sched_end())
+ * @return true with the mutex locked if the request can be passed to the
+ *         backend, false with the mutex unlocked if the handle was closed
+ *         in the meantime or the request could not wait without polling
+ */
+static bool io_sched_begin(file_t* file_entry, io_request_t* request)
+{
+    mount_point_t* mp_entry = file_entry->mount_point;
+    io_sched_t* sched = &mp_entry->sched;
+
+    request->mount_point = NULL;
+    request->gate = NULL;
+    if(sched->params.max_active == 0)
+    {
+        return true;
+    }
+
+    request->io_class = get_io_class(file_entry);
+    request->enqueued = (g_clock != NULL) ? g_clock() : 0;
+    request->deadline = UINT64_MAX;
+    if(g_clock != NULL && sched->params.deadline[request->io_class] != 0)
+    {
+        request->deadline = request->enqueued + sched->params.deadline[request->io_class];
+    }
+    request->granted = false;
+
+    // A gate from the pool is not locked by anybody, so this never blocks
+    request->gate = gate_get();
+    if(request->gate != NULL)
+    {
+        Dmod_Mutex_Lock(request->gate->mutex);
+    }
+    request->mount_point = mp_entry;
+    pin_mount_point(mp_entry, &request->pin);
+
+    ticket_lock(&sched->lock);
+    request->sequence = sched->sequence++;
+    sched->stats.requests++;
+    if(sched->active < sched->params.max_active && sched->queue == NULL)
+    {
+        sched->active++;
+        request->next = sched->running;
+        sched->running = request;
+        ticket_unlock(&sched->lock);
+        return true;
+    }
+    request->next = sched->queue;
+    sched->queue = request;
+    sched->stats.delayed++;
+    sched->stats.queue_depth++;
+    if(sched->stats.queue_depth > sched->stats.max_queue_depth)
+    {
+        sched->stats.max_queue_depth = sched->stats.queue_depth;
+    }
+    ticket_unlock(&sched->lock);
+
+    unlock_mutex();
+    if(!io_sched_wait(sched, request))
+    {
+        DMOD_LOG_ERROR("No dispatched request with a gate on '%s' - request not queued\n", mp_entry->mount_point);
+        if(request->gate != NULL)
+        {
+            Dmod_Mutex_Unlock(request->gate->mutex);
+            gate_put(request->gate);
+            request->gate = NULL;
+        }
+        request->mount_point = NULL;
+        unpin_mount_point(&request->pin);
+        return false;
+    }
+    if(!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        io_sched_end(request);
+        return false;
+    }
+    if(!is_file_valid(file_entry))
+    {
+        unlock_mutex();
+        io_sched_end(request);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Release resources of a resolved path
+ * @param resolved Resolved path
+ */
+static void release_path(resolved_path_t* resolved)
+{
+    if(resolved->allocated != NULL)
+    {
+        vfs_free(resolved->allocated);
+        resolved->allocated = NULL;
+    }
+    if(resolved->locked)
+    {
+        resolved->locked = false;
+        unlock_mutex();
+    }
+    if(resolved->pinned)
+    {
+        resolved->pinned = false;
+        unpin_mount_point(&resolved->pin);
+    }
+}
+
+/**
+ * @brief Admit a request of an operation that has no file entry
+ *
+ * Whole-file operations open their files directly in the backend, without an
+ * entry of the open file table. Their reads and writes are charged to the
+ * calling process and to the mount point under the same throttling limits
+ * and I/O scheduler as dmvfs_fread() and dmvfs_fwrite(). Both can unlock the
+ * DMVFS mutex while they wait, so the mount point of the resolved path stays
+ * pinned until release_path().
+ *
+ * @param resolved Resolved path of the request (from acquire_path())
+ * @param size Size of the request in bytes
+ * @param request Request to fill, to finish with finish_direct_io() on success
+ * @return 0 if the request can be passed to the backend, DMVFS_ERR_AGAIN if
+ *         the throttling limits did not admit it and no sleep function is
+ *         set, -1 on failure
+ */
+static int admit_direct_io(resolved_path_t* resolved, size_t size, io_request_t* request)
+{
+    if(!resolved->locked && !lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return -1;
+    }
+    if(!resolved->pinned)
+    {
+        pin_mount_point(resolved->mount_point, &resolved->pin);
+        resolved->pinned = true;
+    }
+
+    file_t file_entry = {0};
+    file_entry.mount_point = resolved->mount_point;
+    // Only checked to be set by is_file_valid() - the mount point decides
+    file_entry.fs_file = resolved;
+    file_entry.pid = current_pid();
+    file_entry.io_class = -1;
+
+    int result = throttle_io(&file_entry, size);
+    if(result == 0 && !io_sched_begin(&file_entry, request))
+    {
+        result = -1;
+    }
+    if(result != 0)
+    {
+        DMOD_LOG_ERROR("Request was not admitted by the throttling limits or the I/O scheduler\n");
+        // Both return with the mutex unlocked on failure
+        if(resolved->locked && !lock_mutex())
+        {
+            DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+            resolved->locked = false;
+        }
+        return result;
+    }
+    if(!resolved->locked)
+    {
+        unlock_mutex();
+    }
+    return 0;
+}
+
+/**
+ * @brief Finish a request admitted by admit_direct_io()
+ * @param resolved Resolved path passed to admit_direct_io()
+ * @param request Request filled by admit_direct_io()
+ */
+static void finish_direct_io(resolved_path_t* resolved, io_request_t* request)
+{
+    if(!resolved->locked || request->mount_point == NULL)
+    {
+        io_sched_end(request);
+        return;
+    }
+
+    // io_sched_end() must be called without the mutex
+    unlock_mutex();
+    io_sched_end(request);
+    if(!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        resolved->locked = false;
+    }
+}
+
+/**
+ * @brief Resolve a path to a mount point and a path inside of its file system
+ *
+ * Absolute paths are not copied at all. Relative paths are built in the local
+ * buffer of the resolved path (the heap is used only for paths longer than
+ * DMVFS_PATH_MAX) - when the mount point of the working directory is cached,
+ * the path is joined directly with the part of the working directory that is
+ * inside of the file system, so the mount table is not scanned.
+ *
+ * @param path Absolute or relative path
+ * @param cwd Working directory used for relative paths
+ * @param resolved Pointer to store the result (release it with release_path())
+ * @return true on success, false on failure
+ */
+static bool resolve_path(const char* path, const cwd_t* cwd, resolved_path_t* resolved)
+{
+    resolved->mount_point = NULL;
+    resolved->fs_path = NULL;
+    resolved->allocated = NULL;
+    resolved->locked = false;
+    resolved->pinned = false;
+
+    const char* abs_path = path;
+    if(path[0] != '/')
+    {
+        if(cwd->mount_point != NULL)
+        {
+            resolved->fs_path = join_path(cwd->fs_path, path, resolved->buffer, sizeof(resolved->buffer), &resolved->allocated);
+            resolved->mount_point = cwd->mount_point;
+            return (resolved->fs_path != NULL);
+        }
+
+        abs_path = join_path((cwd->path != NULL) ? cwd->path : "", path, resolved->buffer, sizeof(resolved->buffer), &resolved->allocated);
+        if(abs_path == NULL)
+        {
+            return false;
+        }
+    }
+
+    mount_point_t* mp_entry = get_mount_point_for_path(abs_path);
+    if(mp_entry == NULL)
+    {
+        release_path(resolved);
+        return false;
+    }
+
+    resolved->mount_point = mp_entry;
+    resolved->fs_path = abs_path + mp_entry->mount_point_length;
+    if(resolved->fs_path[0] == '\0')
+    {
+        // the path of the mount point itself is the root of its file system
+        resolved->fs_path = "/";
+    }
+    return true;
+}
+
+/**
+ * @brief Resolve a path for a path based operation
+ *
+ * Absolute paths are resolved without the DMVFS mutex, from the published
+ * snapshot of the mount table. For a thread safe backend the mount point is
+ * then pinned for the time of the operation, otherwise the mutex is locked
+ * and the mount point is checked again before it is used. Relative paths
+ * need the working directory, so they are resolved with the mutex locked.
+ *
+ * @param path Absolute or relative path
+ * @param resolved Pointer to store the result (release it with release_path(),
+ *                 which also unlocks the mutex or unpins the mount point)
+ * @return true on success, false on failure
+ */
+static bool acquire_path(const char* path, resolved_path_t* resolved)
+{
+    if(path[0] == '/')
+    {
+        int reader = mount_read_begin();
+        mount_point_t* mp_entry = find_in_mount_table(__atomic_load_n(&g_mount_table, __ATOMIC_ACQUIRE), path);
+        if(mp_entry == NULL)
+        {
+            mount_read_end(reader);
+            return false;
+        }
+
+        resolved->mount_point = mp_entry;
+        resolved->fs_path = path + mp_entry->mount_point_length;
+        if(resolved->fs_path[0] == '\0')
+        {
+            // the path of the mount point itself is the root of its file system
+            resolved->fs_path = "/";
+        }
+        resolved->allocated = NULL;
+        resolved->locked = false;
+        resolved->pinned = false;
+        if(mp_entry->ops.caps & DMVFS_CAP_THREAD_SAFE)
+        {
+            pin_mount_point(mp_entry, &resolved->pin);
+            mount_read_end(reader);
+            resolved->pinned = true;
+            return true;
+        }
+
+        uint32_t generation = mp_entry->generation;
+        mount_read_end(reader);
+        if(!lock_mutex())
+        {
+            DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+            return false;
+        }
+        if(mp_entry->state == MOUNT_STATE_ACTIVE && mp_entry->generation == generation)
+        {
+            resolved->locked = true;
+            return true;
+        }
+        // The mount point was removed in the meantime - resolve the path again
+    }
+    else if(!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return false;
+    }
+
+    if(!resolve_path(path, current_cwd(), resolved))
+    {
+        unlock_mutex();
+        return false;
+    }
+
+    if(resolved->mount_point->ops.caps & DMVFS_CAP_THREAD_SAFE)
+    {
+        pin_mount_point(resolved->mount_point, &resolved->pin);
+        resolved->pinned = true;
+        unlock_mutex();
+    }
+    else
+    {
+        resolved->locked = true;
+    }
+    return true;
+}
+
+/**
+ * @brief Find free file entry
+ * @return Pointer to free file entry, or NULL if none available
+ */
+static file_t* find_free_file_entry(void)
+{
+    if(!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return NULL;
+    }
+
+    for(int i = 0; i < g_max_open_files; i++)
+    {
+        if(g_open_files[i].mount_point == NULL && !g_open_files[i].revoked)
+        {
+            return &g_open_files[i];
+        }
+    }
+
+    DMOD_LOG_ERROR("No free file entries available\n");
+    return NULL;
+}
+
+/**
+ * @brief Close all files and directories of a given mount point
+ *
+ * The function must be called with the DMVFS mutex locked and without any
+ * backend call in flight on the mount point. The file entries are marked as
+ * revoked rather than freed, so they are not reused while the owners still
+ * hold them - they are freed when the owners close them.
+ *
+ * @param mp_entry Pointer to the mount point entry
+ * @return true on success, false if some handles failed to close
+ */
+static bool close_all_file_of_mount_point(mount_point_t* mp_entry)
+{
+    if(!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return false;
+    }
+
+    dmod_dmfsi_fclose_t fclose_func = (dmod_dmfsi_fclose_t)Dmod_GetDifFunction(mp_entry->fs_context, dmod_dmfsi_fclose_sig);
+    dmod_dmfsi_closedir_t closedir_func = (dmod_dmfsi_closedir_t)Dmod_GetDifFunction(mp_entry->fs_context, dmod_dmfsi_closedir_sig);
+    bool success = true;
+
+    for(int i = 0; i < g_max_open_files; i++)
+    {
+        file_t* file_entry = &g_open_files[i];
+        if(file_entry->mount_point != mp_entry)
+        {
+            continue;
+        }
+
+        int result = flush_write_buffer(file_entry);
+        drop_write_buffer(file_entry);
+        if(file_entry->is_dir && closedir_func != NULL)
+        {
+            result = closedir_func(mp_entry->mount_context, file_entry->fs_file);
+        }
+        else if(!file_entry->is_dir && fclose_func != NULL && fclose_func(mp_entry->mount_context, file_entry->fs_file) != 0)
+        {
+            result = -1;
+        }
+        if(result != 0)
+        {
+            DMOD_LOG_ERROR("Failed to close handle in mount point '%s'\n", mp_entry->mount_point);
+            success = false;
+        }
+
+        file_entry->mount_point = NULL;
+        file_entry->fs_file = NULL;
+        file_entry->revoked = true;
+    }
+    mp_entry->handles = 0;
+
+    return success;
+}
+
+/**
+ * @brief Check if a file is opened only for reading
+ * @param mode Open mode (DMFSI_O_* flags)
+ * @return true if the mode does not allow to modify the file
+ */
+static inline bool is_read_only_mode(int mode)
+{
+    return (mode & (DMFSI_O_WRONLY | DMFSI_O_RDWR | DMFSI_O_CREAT | DMFSI_O_TRUNC | DMFSI_O_APPEND)) == 0;
+}
+
+/**
+ * @brief Close a backend handle that was removed from the handle cache
+ * @param entry Copy of the removed cache entry
+ */
+static void close_cached_handle(cached_handle_t* entry)
+{
+    dmod_dmfsi_fclose_t fclose_func = (dmod_dmfsi_fclose_t)Dmod_GetDifFunction(
+        entry->mount_point->fs_context, dmod_dmfsi_fclose_sig);
+    if(fclose_func != NULL && fclose_func(entry->mount_point->mount_context, entry->fs_file) != 0)
+    {
+        DMOD_LOG_ERROR("Failed to close cached handle of '%s'\n", entry->path);
+    }
+    vfs_free(entry->path);
+}
+
+/**
+ * @brief Get a normalized copy of a path
+ *
+ * Repeated '/' are merged and "." and ".." components are resolved (".."
+ * never goes above the root), so all spellings of a path ("/a/./b//../c"
+ * and "/a/c") give the same string. It is used as the key of the handle
+ * cache and to check if two paths lead to the same file.
+ *
+ * @param path Path to normalize
+ * @return Normalized copy of the path (to free with vfs_free()), or NULL on failure
+ */
+static char* normalized_path(const char* path)
+{
+    char* key = duplicate_string(path);
+    if(key == NULL)
+    {
+        return NULL;
+    }
+
+    const char* in = key;
+    char* out = key;
+    if(*in == '/')
+    {
+        out++;
+    }
+    char* root = out;
+    while(*in != '\0')
+    {
+        while(*in == '/')
+        {
+            in++;
+        }
+        const char* end = in;
+        while(*end != '\0' && *end != '/')
+        {
+            end++;
+        }
+        size_t length = (size_t)(end - in);
+        if(length == 2 && in[0] == '.' && in[1] == '.')
+        {
+            while(out > root && out[-1] != '/')
+            {
+                out--;
+            }
+            if(out > root)
+            {
+                out--;
+            }
+        }
+        else if(length != 0 && !(length == 1 && in[0] == '.'))
+        {
+            if(out > root)
+            {
+                *out++ = '/';
+            }
+            memmove(out, in, length);
+            out += length;
+        }
+        in = end;
+    }
+    *out = '\0';
+    return key;
+}
+
+/**
+ * @brief Check if a normalized path is a key or lies below it
+ * @param path Normalized path
+ * @param key Normalized path of a file or a directory
+ * @return true if path is key or a path inside of the key directory
+ */
+static bool is_path_within(const char* path, const char* key)
+{
+    size_t length = strlen(key);
+    if(strncmp(path, key, length) != 0)
+    {
+        return false;
+    }
+    return path[length] == '\0' || path[length] == '/' || (length > 0 && key[length - 1] == '/');
+}
+
+/**
+ * @brief Close cached handles of a path or of a whole mount point
+ *
+ * Called before the path is modified, so a handle opened before the change
+ * is never handed out again. Handles of paths below the path are closed as
+ * well, so removing or renaming a directory drops the handles of its files.
+ * The caller must be allowed to call the backend (DMVFS mutex locked or the
+ * mount point pinned).
+ *
+ * @param mp_entry Mount point, or NULL for all mount points
+ * @param fs_path Path inside of the file system, or NULL for every path
+ */
+static void handle_cache_invalidate(mount_point_t* mp_entry, const char* fs_path)
+{
+    cached_handle_t removed[DMVFS_HANDLE_CACHE_SIZE];
+    int count = 0;
+
+    // Without the key every path of the mount point is invalidated
+    char* key = (fs_path != NULL) ? normalized_path(fs_path) : NULL;
+
+    ticket_lock(&g_handle_cache_lock);
+    for(int i = 0; i < DMVFS_HANDLE_CACHE_SIZE; i++)
+    {
+        cached_handle_t* entry = &g_handle_cache[i];
+        if(entry->mount_point != NULL && (mp_entry == NULL || entry->mount_point == mp_entry) &&
+           (key == NULL || is_path_within(entry->path, key)))
+        {
+            removed[count++] = *entry;
+            entry->mount_point = NULL;
+        }
+    }
+    g_handle_cache_stats.invalidations += count;
+    ticket_unlock(&g_handle_cache_lock);
+
+    vfs_free(key);
+
+    for(int i = 0; i < count; i++)
+    {
+        close_cached_handle(&removed[i]);
+    }
+}
+
+/**
+ * @brief Take a cached handle of a path
+ *
+ * The handle is revalidated by the size and the modification time of the
+ * file, which catch a file that was replaced without DMVFS, and by rewinding
+ * it - a handle that fails any of the checks is closed and the next one is
+ * tried. A file replaced outside of DMVFS with the same size within the
+ * resolution of the modification time cannot be detected.
+ *
+ * @param mp_entry Mount point of the path
+ * @param fs_path Path inside of the file system
+ * @param mode Open mode
+ * @param path Pointer to store the path of the cache entry (owned by the caller)
+ * @return Backend handle, or NULL if none is cached
+ */
+static void* handle_cache_reuse(mount_point_t* mp_entry, const char* fs_path, int mode, char** path)
+{
+    char* key = normalized_path(fs_path);
+    if(key == NULL)
+    {
+        return NULL;
+    }
+
+    dmod_dmfsi_lseek_t lseek_func = (dmod_dmfsi_lseek_t)Dmod_GetDifFunction(mp_entry->fs_context, dmod_dmfsi_lseek_sig);
+    dmod_dmfsi_stat_t stat_func = (dmod_dmfsi_stat_t)Dmod_GetDifFunction(mp_entry->fs_context, dmod_dmfsi_stat_sig);
+    dmfsi_stat_t stat = {0};
+    bool checked = false;
+    bool current = false;
+    for(;;)
+    {
+        cached_handle_t entry = { NULL, NULL, NULL, 0, 0, 0, 0 };
+
+        ticket_lock(&g_handle_cache_lock);
+        cached_handle_t* found = NULL;
+        for(int i = 0; i < g_handle_cache_limit; i++)
+        {
+            cached_handle_t* candidate = &g_handle_cache[i];
+            if(candidate->mount_point == mp_entry && candidate->mode == mode && strcmp(candidate->path, key) == 0 &&
+               (found == NULL || candidate->used > found->used))
+            {
+                found = candidate;
+            }
+        }
+        if(found != NULL)
+        {
+            entry = *found;
+            found->mount_point = NULL;
+        }
+        else
+        {
+            g_handle_cache_stats.misses++;
+        }
+        ticket_unlock(&g_handle_cache_lock);
+
+        if(entry.mount_point == NULL)
+        {
+            vfs_free(key);
+            return NULL;
+        }
+
+        if(!checked)
+        {
+            // Stat only once there is a handle to check, so a miss costs no backend call
+            current = stat_func != NULL && stat_func(mp_entry->mount_context, key, &stat) == 0;
+            checked = true;
+        }
+        if(current && entry.size == stat.size && entry.mtime == stat.mtime &&
+           lseek_func != NULL && lseek_func(mp_entry->mount_context, entry.fs_file, 0, DMFSI_SEEK_SET) >= 0)
+        {
+            __atomic_fetch_add(&g_handle_cache_stats.hits, 1, __ATOMIC_RELAXED);
+            vfs_free(key);
+            *path = entry.path;
+            return entry.fs_file;
+        }
+
+        __atomic_fetch_add(&g_handle_cache_stats.stale, 1, __ATOMIC_RELAXED);
+        close_cached_handle(&entry);
+    }
+}
+
+/**
+ * @brief Keep the backend handle of a closed file in the handle cache
+ *
+ * The least recently used entry is closed when the cache is full. The size
+ * and the modification time of the file are kept to revalidate the handle,
+ * so a file that cannot be stat'ed is not cached. Must be called with the
+ * DMVFS mutex locked.
+ *
+ * @param file_entry File entry that is being closed
+ * @return true if the handle was cached, false if it has to be closed
+ */
+static bool handle_cache_keep(file_t* file_entry)
+{
+    if(file_entry->fs_path == NULL || !is_read_only_mode(file_entry->mode) ||
+       file_entry->mount_point->state != MOUNT_STATE_ACTIVE)
+    {
+        return false;
+    }
+
+    mount_point_t* mp_entry = file_entry->mount_point;
+    dmod_dmfsi_stat_t stat_func = (dmod_dmfsi_stat_t)Dmod_GetDifFunction(mp_entry->fs_context, dmod_dmfsi_stat_sig);
+    dmfsi_stat_t stat = {0};
+    if(stat_func == NULL || stat_func(mp_entry->mount_context, file_entry->fs_path, &stat) != 0)
+    {
+        return false;
+    }
+
+    cached_handle_t evicted = { NULL, NULL, NULL, 0, 0, 0, 0 };
+
+    ticket_lock(&g_handle_cache_lock);
+    cached_handle_t* slot = NULL;
+    for(int i = 0; i < g_handle_cache_limit; i++)
+    {
+        cached_handle_t* entry = &g_handle_cache[i];
+        if(entry->mount_point == NULL)
+        {
+            slot = entry;
+            break;
+        }
+        if(slot == NULL || entry->used < slot->used)
+        {
+            slot = entry;
+        }
+    }
+    if(slot != NULL)
+    {
+        if(slot->mount_point != NULL)
+        {
+            evicted = *slot;
+            g_handle_cache_stats.evictions++;
+        }
+        slot->mount_point = file_entry->mount_point;
+        slot->fs_file = file_entry->fs_file;
+        slot->path = file_entry->fs_path;
+        slot->mode = file_entry->mode;
+        slot->used = ++g_handle_cache_tick;
+        slot->size = stat.size;
+        slot->mtime = stat.mtime;
+        file_entry->fs_path = NULL;
+    }
+    ticket_unlock(&g_handle_cache_lock);
+
+    if(evicted.mount_point != NULL)
+    {
+        close_cached_handle(&evicted);
+    }
+    return (slot != NULL);
+}
+
+/**
+ * @brief Compute the hash of a file system name (FNV-1a)
+ * @param name Name of the file system
+ * @return Hash of the name
+ */
+static uint32_t fs_name_hash(const char* name)
+{
+    uint32_t hash = 2166136261u;
+    while(*name != '\0')
+    {
+        hash = (hash ^ (uint8_t)*name++) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Rebuild the registry of file system modules
+ *
+ * The function must be called with the DMVFS mutex locked. It walks the DMOD
+ * list of modules that implement the DMFSI interface once and stores them in
+ * an open addressing table indexed by the hash of the module name.
+ *
+ * @return Number of registered file systems
+ */
+static int refresh_fs_registry(void)
+{
+    memset(g_fs_registry, 0, sizeof(g_fs_registry));
+    g_fs_registry_valid = true;
+
+    int count = 0;
+    Dmod_Context_t* fs_context = Dmod_GetNextDifModule(dmod_dmfsi_fopen_sig, NULL);
+    while(fs_context != NULL)
+    {
+        if(fs_context->Header != NULL)
+        {
+            if(count >= DMVFS_FS_REGISTRY_SIZE - 1)
+            {
+                DMOD_LOG_WARN("File system registry is full - '%s' is not registered\n", fs_context->Header->Name);
+                break;
+            }
+            uint32_t hash = fs_name_hash(fs_context->Header->Name);
+            uint32_t index = hash % DMVFS_FS_REGISTRY_SIZE;
+            while(g_fs_registry[index].fs_context != NULL)
+            {
+                index = (index + 1) % DMVFS_FS_REGISTRY_SIZE;
+            }
+            g_fs_registry[index].hash = hash;
+            g_fs_registry[index].fs_context = fs_context;
+            count++;
+        }
+        fs_context = Dmod_GetNextDifModule(dmod_dmfsi_fopen_sig, fs_context);
+    }
+    return count;
+}
+
+/**
+ * @brief Look up file system in the registry
+ * @param fs_name Name of the file system
+ * @param hash Hash of the name
+ * @return Pointer to the file system context, or NULL if not registered
+ */
+static Dmod_Context_t* lookup_fs_registry(const char* fs_name, uint32_t hash)
+{
+    uint32_t index = hash % DMVFS_FS_REGISTRY_SIZE;
+    while(g_fs_registry[index].fs_context != NULL)
+    {
+        Dmod_Context_t* fs_context = g_fs_registry[index].fs_context;
+        if(g_fs_registry[index].hash == hash && strcmp(fs_context->Header->Name, fs_name) == 0)
+        {
+            return fs_context;
+        }
+        index = (index + 1) % DMVFS_FS_REGISTRY_SIZE;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Find file system by name
+ *
+ * The function must be called with the DMVFS mutex locked. The registry is
+ * rebuilt when the file system is not found in it, so modules loaded after
+ * the last refresh are still found.
+ *
+ * @param fs_name Name of the file system
+ * @return Pointer to the file system context, or NULL if not found
+ */
+static Dmod_Context_t* find_fs_by_name(const char* fs_name)
+{
+    if(!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return NULL;
+    }
+
+    uint32_t hash = fs_name_hash(fs_name);
+    Dmod_Context_t* fs_context = g_fs_registry_valid ? lookup_fs_registry(fs_name, hash) : NULL;
+    if(fs_context == NULL)
+    {
+        refresh_fs_registry();
+        fs_context = lookup_fs_registry(fs_name, hash);
+    }
+
+    if(fs_context == NULL)
+    {
+        DMOD_LOG_WARN("File system '%s' not found\n", fs_name);
+        return NULL;
+    }
+
+    DMOD_LOG_VERBOSE("File system '%s' found\n", fs_name);
+    return fs_context;
+}
+
+/**
+ * @brief Add mount point
+ * @param mount_point Mount point path
+ * @param fs_context File system context
+ * @param config Configuration string for the file system (file system specific)
+ * @return Pointer to the mount point entry, or NULL on failure
+ */
+static mount_point_t* add_mount_point(const char* mount_point, Dmod_Context_t* fs_context, const char* config)
+{
+    if(!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return NULL;
+    }
+
+    if(fs_context == NULL)
+    {
+        DMOD_LOG_ERROR("Cannot add mount point '%s': Invalid file system context\n", mount_point);
+        return NULL;
+    }
+
+    const char* module_name = Dmod_GetName(fs_context);
+    if(module_name == NULL)
+    {
+        DMOD_LOG_ERROR("Cannot add mount point '%s': Failed to get module name\n", mount_point);
+        return NULL;
+    }
+
+    Dmod_BeginUsage(module_name);
+
+    mount_point_t* free_entry = find_free_mount_point();
+    if(free_entry == NULL)
+    {
+        return NULL;
+    }
+
+    dmod_dmfsi_init_t init_func = (dmod_dmfsi_init_t)Dmod_GetDifFunction(fs_context, dmod_dmfsi_init_sig);
+    if(init_func != NULL)
+    {
+        free_entry->mount_context = init_func(config);
+        if(free_entry->mount_context == NULL)
+        {
+            DMOD_LOG_ERROR("Failed to initialize mount context for mount point '%s'\n", mount_point);
+            return NULL;
+        }
+    }
+
+    size_t length = strlen(mount_point);
+    free_entry->mount_point = vfs_malloc(length + 1);
+    if(free_entry->mount_point == NULL)
+    {
+        DMOD_LOG_ERROR("Failed to allocate memory for mount point\n");
+        return NULL;
+    }
+
+
+    memcpy(free_entry->mount_point, mount_point, length + 1);
+    free_entry->mount_point_length = length;
+    free_entry->fingerprint = path_fingerprint(mount_point);
+    free_entry->fingerprint_mask = (length >= 4) ? 0xFFFFFFFFu : ((1u << (8 * length)) - 1u);
+    free_entry->fs_context = fs_context;
+    free_entry->handles = 0;
+    free_entry->in_flight = 0;
+    free_entry->pins = NULL;
+    void* sched_mutex = free_entry->sched.lock.mutex;
+    memset(&free_entry->sched, 0, sizeof(free_entry->sched));
+    free_entry->sched.lock.mutex = sched_mutex;
+    memset(&free_entry->throttle, 0, sizeof(free_entry->throttle));
+    memset(&free_entry->coalesce, 0, sizeof(free_entry->coalesce));
+    memset(&free_entry->coalesce_stats, 0, sizeof(free_entry->coalesce_stats));
+    __atomic_store_n(&free_entry->state, MOUNT_STATE_ACTIVE, __ATOMIC_SEQ_CST);
+    return free_entry;
+    return NULL;
+}
+
+/**
+ * @brief Wait until the operations in flight on a mount point are done
+ *
+ * The function must be called without the DMVFS mutex, after the mount point
+ * was detached, so no new operation can pin it. It blocks on the gate of a
+ * pin, which is unlocked when the pin is dropped, and checks again. Pins
+ * without a gate (the pool could not create a mutex) are waited for with
+ * spin_wait().
+ *
+ * @param mp_entry Mount point entry
+ */
+static void drain_mount_point(mount_point_t* mp_entry)
+{
+    uint32_t spins = 0;
+    ticket_lock(&mp_entry->sched.lock);
+    while(__atomic_load_n(&mp_entry->in_flight, __ATOMIC_SEQ_CST) != 0)
+    {
+        gate_t* gate = (mp_entry->pins != NULL) ? mp_entry->pins->gate : NULL;
+        if(gate != NULL)
+        {
+            __atomic_add_fetch(&gate->refs, 1, __ATOMIC_ACQ_REL);
+        }
+        ticket_unlock(&mp_entry->sched.lock);
+
+        if(gate != NULL)
+        {
+            Dmod_Mutex_Lock(gate->mutex);
+            Dmod_Mutex_Unlock(gate->mutex);
+            gate_put(gate);
+        }
+        else
+        {
+            spin_wait(&spins);
+        }
+        ticket_lock(&mp_entry->sched.lock);
+    }
+    ticket_unlock(&mp_entry->sched.lock);
+}
+
+/**
+ * @brief Make a detached mount point active again
+ *
+ * Used when an unmount cannot be completed, so the mount point is not left
+ * detached forever. The function must be called without the mount writer
+ * lock and without the DMVFS mutex.
+ *
+ * @param mp_entry Mount point entry
+ */
+static void restore_mount_point(mount_point_t* mp_entry)
+{
+    ticket_lock(&g_mount_writer_lock);
+    __atomic_store_n(&mp_entry->state, MOUNT_STATE_ACTIVE, __ATOMIC_SEQ_CST);
+    if(lock_mutex())
+    {
+        publish_mount_table();
+        refresh_all_cwd_mount_points();
+        wait_for_mount_readers();
+        unlock_mutex();
+    }
+    else
+    {
+        // it is published again with the next change of the mount table
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+    }
+    ticket_unlock(&g_mount_writer_lock);
+}
+
+/**
+ * @brief Remove mount point
+ *
+ * The mount point is detached from the file tree first, so no new operation
+ * can reach it, and then the operations that are still running on it are
+ * drained. Neither the DMVFS mutex nor the mount writer lock is held while
+ * the function waits for them, so the other mounts and unmounts go on.
+ *
+ * @param mount_point Mount point path
+ * @param flags Combination of DMVFS_UNMOUNT_* flags
+ * @return true on success, false on failure
+ */
+static bool remove_mount_point(const char* mount_point, int flags)
+{
+    if(!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return false;
+    }
+
+    ticket_lock(&g_mount_writer_lock);
+    if(!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        ticket_unlock(&g_mount_writer_lock);
+        return false;
+    }
+
+    mount_point_t* mp_entry = find_mount_point(mount_point);
+    if(mp_entry == NULL)
+    {
+        DMOD_LOG_ERROR("Mount point '%s' not found\n", mount_point);
+        unlock_mutex();
+        ticket_unlock(&g_mount_writer_lock);
+        return false;
+    }
+
+    bool force = (flags & DMVFS_UNMOUNT_FORCE) != 0;
+    bool lazy = !force && (flags & DMVFS_UNMOUNT_LAZY) != 0;
+    if(mp_entry->handles > 0 && !force && !lazy)
+    {
+        DMOD_LOG_ERROR("Mount point '%s' is busy: %d handles are open\n", mount_point, mp_entry->handles);
+        unlock_mutex();
+        ticket_unlock(&g_mount_writer_lock);
+        return false;
+    }
+
+    // Detach the mount point, so it cannot be reached by new operations
+    mp_entry->generation++;
+    __atomic_store_n(&mp_entry->state, force ? MOUNT_STATE_CLOSING : MOUNT_STATE_DETACHING, __ATOMIC_SEQ_CST);
+    publish_mount_table();
+    refresh_all_cwd_mount_points();
+    handle_cache_invalidate(mp_entry, NULL);
+
+    // After this no reader of the old table can pin the mount point anymore
+    wait_for_mount_readers();
+    ticket_unlock(&g_mount_writer_lock);
+
+    if(lazy)
+    {
+        __atomic_store_n(&mp_entry->state, MOUNT_STATE_DETACHED, __ATOMIC_SEQ_CST);
+        release_detached_mount_point(mp_entry);
+        unlock_mutex();
+        return true;
+    }
+    unlock_mutex();
+
+    // Drain the operations in flight - new ones cannot pin the mount point
+    for(;;)
+    {
+        drain_mount_point(mp_entry);
+        if(!lock_mutex())
+        {
+            DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+            restore_mount_point(mp_entry);
+            return false;
+        }
+        if(__atomic_load_n(&mp_entry->in_flight, __ATOMIC_SEQ_CST) == 0)
+        {
+            break;
+        }
+        unlock_mutex();
+    }
+
+    if(mp_entry->handles > 0 && !close_all_file_of_mount_point(mp_entry))
+    {
+        DMOD_LOG_WARN("Some handles of mount point '%s' failed to close\n", mount_point);
+    }
+    finalize_mount_point(mp_entry);
+    unlock_mutex();
+    return true;
+}
+
+/**
+ * @brief Set the memory arena used by DMVFS
+ *
+ * When an arena is set, every internal allocation of DMVFS (tables, paths,
+ * mount point names, trace buffers) is served from it instead of the heap,
+ * so the general allocator is never used after boot. Blocks are rounded up
+ * to power of 2 size classes and reused after they are released, which keeps
+ * allocations constant-time. The arena must be set before dmvfs_init() and
+ * must stay valid until dmvfs_deinit(). Building with DMVFS_STATIC_ARENA_SIZE
+ * defined provides a static arena of that size that is used by default.
+ *
+ * @param arena Memory for the arena, or NULL to go back to the heap
+ * @param size Size of the arena in bytes
+ * @return true on success, false on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, bool, _set_arena, (void* arena, size_t size))
+{
+    if (is_initialized())
+    {
+        DMOD_LOG_ERROR("Cannot change the arena while DMVFS is initialized\n");
+        return false;
+    }
+
+    if (arena != NULL && size < DMVFS_SLAB_PAGE_SIZE)
+    {
+        DMOD_LOG_ERROR("Arena of %zu bytes is too small\n", size);
+        return false;
+    }
+
+    allocator_setup(arena, size);
+    return true;
+}
+
+/**
+ * @brief Get statistics of the DMVFS internal allocator
+ *
+ * Small internal blocks (paths, names, per handle structures) are kept in
+ * slab pages with power of 2 size classes, so the statistics show how much
+ * memory DMVFS uses for its bookkeeping and how much of the arena is left.
+ *
+ * @param stats Pointer to store the statistics
+ * @return true on success, false on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, bool, _get_alloc_stats, (dmvfs_alloc_stats_t* stats))
+{
+    if (stats == NULL)
+    {
+        DMOD_LOG_ERROR("Invalid arguments to _get_alloc_stats\n");
+        return false;
+    }
+
+    Dmod_EnterCritical();
+    *stats = g_allocator.stats;
+    Dmod_ExitCritical();
+    return true;
+}
+
+/**
+ * @brief Give the internal ticket locks their DMOD mutexes
+ *
+ * Locks that already have a mutex keep it, so the function can be called
+ * again when the mutexes could not be created before.
+ */
+static void init_ticket_locks(void)
+{
+    ticket_lock_init(&g_mount_writer_lock);
+    ticket_lock_init(&g_handle_cache_lock);
+    for(int i = 0; i < g_max_mount_points; i++)
+    {
+        ticket_lock_init(&g_mount_points[i].sched.lock);
+    }
+}
+
+/**
+ * @brief Delete the DMOD mutexes of the internal ticket locks
+ */
+static void deinit_ticket_locks(void)
+{
+    ticket_lock_deinit(&g_mount_writer_lock);
+    ticket_lock_deinit(&g_handle_cache_lock);
+    for(int i = 0; i < g_max_mount_points; i++)
+    {
+        ticket_lock_deinit(&g_mount_points[i].sched.lock);
+    }
+}
+
+/**
+ * @brief Initialize DMVFS
+ * 
+ * The function initializes the DMVFS with a specified maximum number of mount points.
+ * It allocates memory for the mount points and creates a mutex for thread safety.
+ * @param max_mount_points Maximum number of mount points
+ * 
+ * @return true on success, false on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, bool, _init, (int max_mount_points, int max_open_files))
+{
+    if (is_initialized())
+    {
+        DMOD_LOG_WARN("DMVFS is already initialized\n");
+        return false;
+    }
+
+    if (max_mount_points <= 0)
+    {
+        DMOD_LOG_ERROR("Invalid maximum mount points: %d\n", max_mount_points);
+        return false;
+    }
+
+#ifdef DMVFS_STATIC_ARENA_SIZE
+    if (g_allocator.base == NULL)
+    {
+        allocator_setup(g_static_arena, sizeof(g_static_arena));
+    }
+#endif
+
+    g_mount_points = (mount_point_t*)vfs_malloc(sizeof(mount_point_t) * max_mount_points);
+    if (g_mount_points == NULL)
+    {
+        DMOD_LOG_ERROR("Failed to allocate memory for mount points\n");
+        return false;
+    }
+
+    g_open_files = (file_t*)vfs_malloc(sizeof(file_t) * max_open_files);
+    if (g_open_files == NULL)
+    {
+        DMOD_LOG_ERROR("Failed to allocate memory for open files\n");
+        vfs_free(g_mount_points);
+        g_mount_points = NULL;
+        return false;
+    }
+
+    mount_point_t** table_entries = (mount_point_t**)vfs_malloc(sizeof(mount_point_t*) * max_mount_points * 2);
+    if (table_entries == NULL)
+    {
+        DMOD_LOG_ERROR("Failed to allocate memory for mount table\n");
+        vfs_free(g_open_files);
+        vfs_free(g_mount_points);
+        g_open_files = NULL;
+        g_mount_points = NULL;
+        return false;
+    }
+    g_mount_tables[0].entries = table_entries;
+    g_mount_tables[0].count = 0;
+    g_mount_tables[1].entries = table_entries + max_mount_points;
+    g_mount_tables[1].count = 0;
+    __atomic_store_n(&g_mount_table, &g_mount_tables[0], __ATOMIC_RELEASE);
+
+    memset(g_mount_points, 0, sizeof(mount_point_t) * max_mount_points);
+    memset(g_open_files, 0, sizeof(file_t) * max_open_files);
+    g_max_mount_points = max_mount_points;
+    g_max_open_files = max_open_files;
+
+    g_mutex = Dmod_Mutex_New(true);
+    if (g_mutex == NULL)
+    {
+        DMOD_LOG_WARN("We could not initialize mutex - working in ticket lock mode...\n");
+    }
+    init_ticket_locks();
+
+    memset(g_process_cwds, 0, sizeof(g_process_cwds));
+    g_cwd.path = duplicate_string("/");
+    g_cwd.mount_point = NULL;
+    g_pwd = duplicate_string("/");
+    if (g_cwd.path == NULL || g_pwd == NULL)
+    {
+        DMOD_LOG_ERROR("Failed to allocate memory for CWD or PWD\n");
+        deinit_ticket_locks();
+        __atomic_store_n(&g_mount_table, NULL, __ATOMIC_RELEASE);
+        vfs_free(table_entries);
+        vfs_free(g_open_files);
+        vfs_free(g_mount_points);
+        g_open_files = NULL;
+        g_mount_points = NULL;
+        g_max_mount_points = 0;
+        if (g_cwd.path) vfs_free((void*)g_cwd.path);
+        if (g_pwd) vfs_free((void*)g_pwd);
+        g_cwd.path = NULL;
+        g_pwd = NULL;
+        if(g_mutex != NULL)
+        {
+            Dmod_Mutex_Delete(g_mutex);
+        }
+        g_mutex = NULL;
+        return false;
+    }
+
+    DMOD_LOG_INFO("== dmvfs ver " DMVFS_VERSION " ==\n");
+    DMOD_LOG_INFO("DMVFS initialized with max mount points: %d\n", max_mount_points);
+    return true;
+}
+
+/**
+ * @brief Reinitialize DMVFS mutex
+ * 
+ * The function reinitializes the DMVFS mutex by destroying the old mutex
+ * and creating a new one. This is useful in scenarios where the mutex
+ * needs to be reset or recreated. The mutex is created only once in
+ * dmvfs_init() - when that fails (e.g. the scheduler is not started yet)
+ * DMVFS uses a ticket lock until this function is called. It must not be
+ * called while other threads use DMVFS.
+ * 
+ * @return true on success, false on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, bool, _reinit_mutex, (void))
+{
+    if (!is_initialized())
+    {
+        DMOD_LOG_WARN("DMVFS is not initialized\n");
+        return false;
+    }
+
+    if(g_mutex != NULL)
+    {
+        // Destroy the old mutex
+        Dmod_Mutex_Delete(g_mutex);
+    }
+
+    // Create a new mutex
+    g_mutex = Dmod_Mutex_New(true);
+    if (g_mutex == NULL)
+    {
+        return false;
+    }
+    init_ticket_locks();
+
+    DMOD_LOG_INFO("DMVFS mutex reinitialized successfully\n");
+    return true;
+}
+
+/**
+ * @brief Deinitialize DMVFS
+ * 
+ * The function deinitializes the DMVFS by freeing allocated resources,
+ * including the mount points and the mutex. It ensures that the DMVFS
+ * is properly cleaned up and ready for reinitialization if needed.
+ * 
+ * @return true on success, false on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, bool, _deinit, (void))
+{
+    if (!is_initialized())
+    {
+        DMOD_LOG_WARN("DMVFS is not initialized\n");
+        return false;
+    }
+
+    if (!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return false;
+    }
+
+    // Free all mount points, including the lazily unmounted ones
+    __atomic_store_n(&g_mount_table, NULL, __ATOMIC_RELEASE);
+    wait_for_mount_readers();
+    handle_cache_invalidate(NULL, NULL);
+    g_handle_cache_limit = 0;
+    memset(&g_handle_cache_stats, 0, sizeof(g_handle_cache_stats));
+    for (int i = 0; i < g_max_mount_points; i++)
+    {
+        if (g_mount_points[i].state != MOUNT_STATE_UNUSED)
+        {
+            close_all_file_of_mount_point(&g_mount_points[i]);
+            finalize_mount_point(&g_mount_points[i]);
+        }
+    }
+
+    // Free the mount points array
+    deinit_ticket_locks();
+    vfs_free(g_mount_tables[0].entries);
+    memset(g_mount_tables, 0, sizeof(g_mount_tables));
+    vfs_free(g_mount_points);
+    vfs_free(g_open_files);
+    vfs_free(g_cwd.path);
+    vfs_free(g_pwd);
+    g_cwd.path = NULL;
+    g_cwd.mount_point = NULL;
+    for (int i = 0; i < DMVFS_MAX_PROCESS_CWDS; i++)
+    {
+        if (g_process_cwds[i].path != NULL)
+        {
+            vfs_free(g_process_cwds[i].path);
+        }
+    }
+    memset(g_process_cwds, 0, sizeof(g_process_cwds));
+    memset(g_io_classes, 0, sizeof(g_io_classes));
+    memset(g_pid_throttles, 0, sizeof(g_pid_throttles));
+    g_mount_points = NULL;
+    g_max_mount_points = 0;
+    g_fs_registry_valid = false;
+
+    // Free the trace rings
+    __atomic_store_n(&g_trace_enabled, false, __ATOMIC_RELEASE);
+    __atomic_store_n(&g_trace_ring, NULL, __ATOMIC_RELEASE);
+    while (g_trace_rings != NULL)
+    {
+        trace_ring_t* next = g_trace_rings->next;
+        vfs_free(g_trace_rings);
+        g_trace_rings = next;
+    }
+
+    // Free the gates of the I/O schedulers
+    while (g_gates != NULL)
+    {
+        gate_t* next = g_gates->next;
+        Dmod_Mutex_Delete(g_gates->mutex);
+        vfs_free(g_gates);
+        g_gates = next;
+    }
+
+    // Free the bounce buffer pool
+    vfs_free(g_bounce.memory);
+    memset(&g_bounce, 0, sizeof(g_bounce));
+
+    // Everything is released, so the slab pages can be dropped as well
+    allocator_reset();
+
+    // Destroy the mutex
+    unlock_mutex();
+    if(g_mutex != NULL)
+    {
+        Dmod_Mutex_Delete(g_mutex);
+    }
+    g_mutex = NULL;
+
+    DMOD_LOG_INFO("DMVFS deinitialized successfully\n");
+    return true;
+}
+
+/**
+ * @brief Get maximum number of mount points
+ * 
+ * @return Maximum number of mount points
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _get_max_mount_points, (void))
+{
+    if(!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return -1;
+    }
+    int result = g_max_mount_points;
+    unlock_mutex();
+    return result;
+}
+
+/**
+ * @brief Get maximum number of open files
+ * 
+ * @return Maximum number of open files
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _get_max_open_files, (void))
+{
+    if(!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return -1;
+    }
+    int result = g_max_open_files;
+    unlock_mutex();
+    return result;
+}
+
+/**
+ * @brief Mount file system
+ * 
+ * The function mounts a file system by its name at the specified mount point.
+ * It initializes the file system using its init function and registers the
+ * mount point in the DMVFS.
+ * 
+ * @param fs_name Name of the file system to mount
+ * @param mount_point Mount point path
+ * @param config Configuration string for the file system (file system specific)
+ * @return true on success, false on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, bool, _mount_fs, (const char* fs_name, const char* mount_point, const char* config))
+{   
+    if(!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return false;
+    }
+
+    ticket_lock(&g_mount_writer_lock);
+    if(!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        ticket_unlock(&g_mount_writer_lock);
+        return false;
+    }
+
+    Dmod_Context_t* fs_context = find_fs_by_name(fs_name);
+    if(fs_context == NULL)
+    {
+        DMOD_LOG_ERROR("Cannot mount file system '%s': Not found\n", fs_name);
+        unlock_mutex();
+        ticket_unlock(&g_mount_writer_lock);
+        return false;
+    }
+
+    mount_point_t* mp_entry = add_mount_point(mount_point, fs_context, config);
+    if(mp_entry == NULL)
+    {
+        DMOD_LOG_ERROR("Cannot mount file system '%s'\n", fs_name);
+        unlock_mutex();
+        ticket_unlock(&g_mount_writer_lock);
+        return false;
+    }
+    publish_mount_table();
+    refresh_all_cwd_mount_points();
+
+    unlock_mutex();
+    wait_for_mount_readers();
+    ticket_unlock(&g_mount_writer_lock);
+    DMOD_LOG_INFO("File system '%s' mounted at '%s' successfully\n", fs_name, mount_point);
+    return true;
+}
+
+/**
+ * @brief Unmount file system
+ * 
+ * The function unmounts a file system at the specified mount point.
+ * It waits for the operations that are running on the file system, closes
+ * the files and directories that are still open on it, deinitializes the
+ * file system using its deinit function and removes the mount point from
+ * the DMVFS. It is the same as dmvfs_unmount_fs_ex() with DMVFS_UNMOUNT_FORCE.
+ * 
+ * @param mount_point Mount point path
+ * @return true on success, false on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, bool, _unmount_fs, (const char* mount_point))
+{
+    return dmvfs_unmount_fs_ex(mount_point, DMVFS_UNMOUNT_FORCE);
+}
+
+/**
+ * @brief Unmount file system with options
+ *
+ * The mount point is removed from the file tree at once, then the operations
+ * that are running on it are drained without holding the DMVFS mutex, so the
+ * other mount points are not blocked. Open handles decide what happens next:
+ *  - without flags the unmount fails if any file or directory is open
+ *  - DMVFS_UNMOUNT_FORCE invalidates the open handles (they fail from now
+ *    on and only have to be closed) and closes them in the file system
+ *  - DMVFS_UNMOUNT_LAZY keeps the open handles working and releases the file
+ *    system when the last of them is closed
+ *
+ * @param mount_point Mount point path
+ * @param flags Combination of DMVFS_UNMOUNT_* flags
+ * @return true on success, false on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, bool, _unmount_fs_ex, (const char* mount_point, int flags))
+{
+    if(!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return false;
+    }
+
+    if(mount_point == NULL)
+    {
+        DMOD_LOG_ERROR("Invalid arguments to _unmount_fs_ex\n");
+        return false;
+    }
+
+    if(!remove_mount_point(mount_point, flags))
+    {
+        DMOD_LOG_ERROR("Cannot unmount file system at mount point '%s'\n", mount_point);
+        return false;
+    }
+
+    DMOD_LOG_INFO("File system at mount point '%s' unmounted successfully\n", mount_point);
+    return true;
+}
+
+/**
+ * @brief Set the capabilities and optional operations of a mounted file system
+ *
+ * DMFSI does not tell whether a backend is reentrant or which fast paths it
+ * supports, so DMVFS assumes the worst and serializes all calls. A backend
+ * (or the application that mounts it) can advertise its capabilities with
+ * this function - for example with DMVFS_CAP_THREAD_SAFE the calls to the
+ * mount point are not serialized by the DMVFS mutex. The settings are
+ * dropped when the file system is unmounted.
+ *
+ * @param mount_point Mount point path
+ * @param ops Capabilities and operations of the mount point (copied)
+ * @return true on success, false on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, bool, _set_mount_ops, (const char* mount_point, const dmvfs_mount_ops_t* ops))
+{
+    if(!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return false;
+    }
+
+    if(mount_point == NULL || ops == NULL || (ops->alignment & (ops->alignment - 1)) != 0)
+    {
+        DMOD_LOG_ERROR("Invalid arguments to _set_mount_ops\n");
+        return false;
+    }
+
+    if(!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return false;
+    }
+
+    mount_point_t* mp_entry = find_mount_point(mount_point);
+    if(mp_entry == NULL)
+    {
+        unlock_mutex();
+        return false;
+    }
+    mp_entry->ops = *ops;
+
+    unlock_mutex();
+    DMOD_LOG_INFO("Capabilities of mount point '%s' set to 0x%08X\n", mount_point, (unsigned)ops->caps);
+    return true;
+}
+
+/**
+ * @brief Get the capabilities and optional operations of a mounted file system
+ * @param mount_point Mount point path
+ * @param ops Pointer to store the capabilities and operations
+ * @return true on success, false on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, bool, _get_mount_ops, (const char* mount_point, dmvfs_mount_ops_t* ops))
+{
+    if(!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return false;
+    }
+
+    if(mount_point == NULL || ops == NULL)
+    {
+        DMOD_LOG_ERROR("Invalid arguments to _get_mount_ops\n");
+        return false;
+    }
+
+    if(!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return false;
+    }
+
+    mount_point_t* mp_entry = find_mount_point(mount_point);
+    if(mp_entry != NULL)
+    {
+        *ops = mp_entry->ops;
+    }
+
+    unlock_mutex();
+    return (mp_entry != NULL);
+}
+
+/**
+ * @brief Configure the I/O scheduler of a mounted file system
+ *
+ * By default the reads, writes and flushes of all callers reach the backend
+ * in the order in which they take the DMVFS lock, so a bulk transfer can hold
+ * off a latency critical one. With the scheduler enabled at most max_active
+ * requests are passed to the backend at once and the waiting ones are
+ * dispatched by their I/O class (see dmvfs_set_io_class()) and deadline. A
+ * request that misses its deadline is dispatched before all the others, so
+ * the lower classes are not starved. Deadlines need a clock (see
+ * dmvfs_set_clock()). The settings are dropped when the file system is
+ * unmounted.
+ *
+ * @param mount_point Mount point path
+ * @param sched Scheduler parameters (copied), max_active 0 disables the scheduler
+ * @return true on success, false on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, bool, _set_io_sched, (const char* mount_point, const dmvfs_io_sched_t* sched))
+{
+    if(!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return false;
+    }
+
+    if(mount_point == NULL || sched == NULL)
+    {
+        DMOD_LOG_ERROR("Invalid arguments to _set_io_sched\n");
+        return false;
+    }
+
+    if(!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return false;
+    }
+
+    mount_point_t* mp_entry = find_mount_point(mount_point);
+    if(mp_entry != NULL)
+    {
+        ticket_lock(&mp_entry->sched.lock);
+        mp_entry->sched.params = *sched;
+        ticket_unlock(&mp_entry->sched.lock);
+    }
+
+    unlock_mutex();
+    return (mp_entry != NULL);
+}
+
+/**
+ * @brief Get the statistics of the I/O scheduler of a mounted file system
+ * @param mount_point Mount point path
+ * @param stats Pointer to store the statistics
+ * @return true on success, false on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, bool, _get_io_sched_stats, (const char* mount_point, dmvfs_io_sched_stats_t* stats))
+{
+    if(!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return false;
+    }
+
+    if(mount_point == NULL || stats == NULL)
+    {
+        DMOD_LOG_ERROR("Invalid arguments to _get_io_sched_stats\n");
+        return false;
+    }
+
+    if(!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return false;
+    }
+
+    mount_point_t* mp_entry = find_mount_point(mount_point);
+    if(mp_entry != NULL)
+    {
+        ticket_lock(&mp_entry->sched.lock);
+        *stats = mp_entry->sched.stats;
+        ticket_unlock(&mp_entry->sched.lock);
+    }
+
+    unlock_mutex();
+    return (mp_entry != NULL);
+}
+
+/**
+ * @brief Set the I/O class of a process
+ *
+ * The class is used by the I/O schedulers of the mount points for the files
+ * opened by the process, unless the file has its own class. Processes
+ * without a class use DMVFS_IO_CLASS_BE.
+ *
+ * @param pid Process ID
+ * @param io_class I/O class (DMVFS_IO_CLASS_*), or -1 to go back to the default
+ * @return true on success, false on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, bool, _set_io_class, (int pid, int io_class))
+{
+    if(!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return false;
+    }
+
+    if(io_class >= DMVFS_IO_CLASSES)
+    {
+        DMOD_LOG_ERROR("Invalid I/O class %d\n", io_class);
+        return false;
+    }
+
+    if(!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return false;
+    }
+
+    io_class_entry_t* entry = NULL;
+    for(int i = 0; i < DMVFS_MAX_IO_CLASS_PIDS; i++)
+    {
+        if(g_io_classes[i].used && g_io_classes[i].pid == pid)
+        {
+            entry = &g_io_classes[i];
+            break;
+        }
+        if(entry == NULL && !g_io_classes[i].used)
+        {
+            entry = &g_io_classes[i];
+        }
+    }
+
+    bool result = true;
+    if(io_class < 0)
+    {
+        if(entry != NULL && entry->used && entry->pid == pid)
+        {
+            entry->used = false;
+        }
+    }
+    else if(entry == NULL)
+    {
+        DMOD_LOG_ERROR("No free I/O class entries for process ID %d\n", pid);
+        result = false;
+    }
+    else
+    {
+        entry->used = true;
+        entry->pid = pid;
+        entry->io_class = io_class;
+    }
+
+    unlock_mutex();
+    return result;
+}
+
+/**
+ * @brief Set the I/O class of an open file
+ * @param fp File handle
+ * @param io_class I/O class (DMVFS_IO_CLASS_*), or -1 to use the class of the process
+ * @return true on success, false on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, bool, _set_file_io_class, (void* fp, int io_class))
+{
+    if(!is_initialized() || fp == NULL || io_class >= DMVFS_IO_CLASSES)
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized or invalid arguments to _set_file_io_class\n");
+        return false;
+    }
+
+    if(!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return false;
+    }
+
+    file_t* file_entry = (file_t*)fp;
+    bool result = is_file_valid(file_entry);
+    if(result)
+    {
+        file_entry->io_class = (io_class < 0) ? -1 : io_class;
+    }
+
+    unlock_mutex();
+    return result;
+}
+
+/**
+ * @brief Limit the I/O bandwidth and operations of a process
+ *
+ * Reads and writes of the files opened by the process are delayed with a
+ * token bucket, so a misbehaving process cannot saturate the storage. The
+ * limits are enforced only if a clock is set (see dmvfs_set_clock()). A
+ * delayed request sleeps with the function set by dmvfs_set_sleep(), or
+ * fails with DMVFS_ERR_AGAIN when no sleep function is set.
+ *
+ * @param pid Process ID
+ * @param limits Limits (copied), NULL or zero rates remove the limits of the process
+ * @return true on success, false on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, bool, _set_throttle, (int pid, const dmvfs_throttle_t* limits))
+{
+    if(!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return false;
+    }
+
+    if(!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return false;
+    }
+
+    pid_throttle_t* entry = NULL;
+    for(int i = 0; i < DMVFS_MAX_THROTTLED_PIDS; i++)
+    {
+        if(g_pid_throttles[i].used && g_pid_throttles[i].pid == pid)
+        {
+            entry = &g_pid_throttles[i];
+            break;
+        }
+        if(entry == NULL && !g_pid_throttles[i].used)
+        {
+            entry = &g_pid_throttles[i];
+        }
+    }
+
+    bool result = true;
+    if(limits == NULL || (limits->bytes_per_sec == 0 && limits->ops_per_sec == 0))
+    {
+        if(entry != NULL && entry->used && entry->pid == pid)
+        {
+            entry->used = false;
+        }
+    }
+    else if(entry == NULL)
+    {
+        DMOD_LOG_ERROR("No free throttling entries for process ID %d\n", pid);
+        result = false;
+    }
+    else
+    {
+        entry->used = true;
+        entry->pid = pid;
+        token_bucket_setup(&entry->bucket, limits);
+    }
+
+    unlock_mutex();
+    return result;
+}
+
+/**
+ * @brief Limit the I/O bandwidth and operations of a mounted file system
+ *
+ * The limits are shared by all processes and enforced in the same way as
+ * the limits of dmvfs_set_throttle(). They are dropped when the file system
+ * is unmounted.
+ *
+ * @param mount_point Mount point path
+ * @param limits Limits (copied), NULL to remove the limits
+ * @return true on success, false on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, bool, _set_mount_throttle, (const char* mount_point, const dmvfs_throttle_t* limits))
+{
+    if(!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return false;
+    }
+
+    if(mount_point == NULL)
+    {
+        DMOD_LOG_ERROR("Invalid arguments to _set_mount_throttle\n");
+        return false;
+    }
+
+    if(!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return false;
+    }
+
+    mount_point_t* mp_entry = find_mount_point(mount_point);
+    if(mp_entry != NULL)
+    {
+        token_bucket_setup(&mp_entry->throttle, limits);
+    }
+
+    unlock_mutex();
+    return (mp_entry != NULL);
+}
+
+/**
+ * @brief Configure write coalescing of a mounted file system
+ *
+ * Flash devices program whole pages and erase whole blocks, so small and
+ * unaligned writes are amplified by the backend. With write coalescing the
+ * writes of each open file are collected until they fill a block (the erase
+ * block, or the program block if the erase size is 0) and passed to the
+ * backend aligned to the block boundaries of the file. The buffered data is
+ * written before any other operation of the same handle and when it is
+ * closed - path based operations (e.g. stat) see it only after that. The
+ * buffer is guarded by the DMVFS mutex, so coalesced writes do not bypass it
+ * on mount points with DMVFS_CAP_THREAD_SAFE. The settings are dropped when
+ * the file system is unmounted.
+ *
+ * @param mount_point Mount point path
+ * @param config Flash geometry (copied), NULL or program size 0 disables coalescing
+ * @return true on success, false on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, bool, _set_write_coalescing, (const char* mount_point, const dmvfs_coalesce_t* config))
+{
+    if(!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return false;
+    }
+
+    if(mount_point == NULL ||
+       (config != NULL && config->program_size != 0 && config->erase_size % config->program_size != 0))
+    {
+        DMOD_LOG_ERROR("Invalid arguments to _set_write_coalescing\n");
+        return false;
+    }
+
+    if(!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return false;
+    }
+
+    mount_point_t* mp_entry = find_mount_point(mount_point);
+    if(mp_entry != NULL)
+    {
+        if(config != NULL)
+        {
+            mp_entry->coalesce = *config;
+        }
+        else
+        {
+            memset(&mp_entry->coalesce, 0, sizeof(mp_entry->coalesce));
+        }
+    }
+
+    unlock_mutex();
+    return (mp_entry != NULL);
+}
+
+/**
+ * @brief Get the write coalescing statistics of a mounted file system
+ * @param mount_point Mount point path
+ * @param stats Pointer to store the statistics
+ * @return true on success, false on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, bool, _get_write_coalescing_stats, (const char* mount_point, dmvfs_coalesce_stats_t* stats))
+{
+    if(!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return false;
+    }
+
+    if(mount_point == NULL || stats == NULL)
+    {
+        DMOD_LOG_ERROR("Invalid arguments to _get_write_coalescing_stats\n");
+        return false;
+    }
+
+    if(!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return false;
+    }
+
+    mount_point_t* mp_entry = find_mount_point(mount_point);
+    if(mp_entry != NULL)
+    {
+        *stats = mp_entry->coalesce_stats;
+    }
+
+    unlock_mutex();
+    return (mp_entry != NULL);
+}
+
+/**
+ * @brief Set up the pool of aligned bounce buffers
+ *
+ * Backends that advertise DMVFS_CAP_ALIGNED_IO (for example drivers that hand
+ * the buffer directly to a DMA engine) need aligned memory. Large transfers
+ * with an unaligned buffer of the caller are staged through this pool, and
+ * backends can borrow buffers from it with dmvfs_bounce_alloc(). The pool can
+ * only be changed when none of its buffers is in use.
+ *
+ * @param count Number of buffers (at most 32), 0 to free the pool
+ * @param size Size of each buffer in bytes (rounded up to the alignment)
+ * @param alignment Alignment of the buffers (power of 2)
+ *
+ * @return true on success, false on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, bool, _set_bounce_pool, (size_t count, size_t size, size_t alignment))
+{
+    if(!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return false;
+    }
+
+    if(count > DMVFS_BOUNCE_MAX_BUFFERS || (count != 0 && (size == 0 || alignment == 0 || (alignment & (alignment - 1)) != 0)))
+    {
+        DMOD_LOG_ERROR("Invalid arguments to _set_bounce_pool\n");
+        return false;
+    }
+
+    if(!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return false;
+    }
+
+    // Claim all buffers, so no transfer can take one while the pool changes
+    uint32_t all = (g_bounce.count < DMVFS_BOUNCE_MAX_BUFFERS) ? ((1u << g_bounce.count) - 1) : 0xFFFFFFFFu;
+    uint32_t expected = all;
+    if(!__atomic_compare_exchange_n(&g_bounce.free_mask, &expected, 0, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+        DMOD_LOG_ERROR("Bounce buffers are in use\n");
+        unlock_mutex();
+        return false;
+    }
+
+    void* memory = NULL;
+    size = (size + alignment - 1) & ~(alignment - 1);
+    if(count != 0)
+    {
+        memory = vfs_malloc(count * size + alignment);
+        if(memory == NULL)
+        {
+            DMOD_LOG_ERROR("Failed to allocate bounce buffer pool\n");
+            __atomic_store_n(&g_bounce.free_mask, all, __ATOMIC_RELEASE);
+            unlock_mutex();
+            return false;
+        }
+    }
+
+    __atomic_store_n(&g_bounce.count, 0, __ATOMIC_RELEASE);
+    vfs_free(g_bounce.memory);
+    g_bounce.memory = memory;
+    g_bounce.buffers = (uint8_t*)(((uintptr_t)memory + alignment - 1) & ~(uintptr_t)(alignment - 1));
+    g_bounce.size = (count != 0) ? size : 0;
+    g_bounce.alignment = (count != 0) ? alignment : 0;
+    memset(&g_bounce.stats, 0, sizeof(g_bounce.stats));
+    __atomic_store_n(&g_bounce.count, (uint32_t)count, __ATOMIC_RELEASE);
+    all = (count < DMVFS_BOUNCE_MAX_BUFFERS) ? ((1u << count) - 1) : 0xFFFFFFFFu;
+    __atomic_store_n(&g_bounce.free_mask, all, __ATOMIC_RELEASE);
+
+    unlock_mutex();
+    return true;
+}
+
+/**
+ * @brief Get statistics of the bounce buffer pool
+ * @param stats Pointer to store the statistics
+ * @return true on success, false on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, bool, _get_bounce_stats, (dmvfs_bounce_stats_t* stats))
+{
+    if(!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return false;
+    }
+
+    if(stats == NULL)
+    {
+        DMOD_LOG_ERROR("Invalid arguments to _get_bounce_stats\n");
+        return false;
+    }
+
+    if(!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return false;
+    }
+
+    *stats = g_bounce.stats;
+    stats->buffers = g_bounce.count;
+    stats->buffer_size = (uint32_t)g_bounce.size;
+    stats->alignment = (uint32_t)g_bounce.alignment;
+    stats->in_use = g_bounce.count - (uint32_t)__builtin_popcount(__atomic_load_n(&g_bounce.free_mask, __ATOMIC_ACQUIRE));
+
+    unlock_mutex();
+    return true;
+}
+
+/**
+ * @brief Borrow an aligned buffer from the bounce buffer pool
+ *
+ * Meant for backends that need aligned memory for their own transfers. The
+ * call does not block - it returns NULL when the pool is empty or the buffers
+ * are too small.
+ *
+ * @param size Number of bytes needed
+ * @return Aligned buffer, or NULL if none is available
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, void*, _bounce_alloc, (size_t size))
+{
+    if(size == 0 || size > g_bounce.size)
+    {
+        return NULL;
+    }
+
+    void* buffer = bounce_take();
+    if(buffer != NULL)
+    {
+        __atomic_fetch_add(&g_bounce.stats.lent, 1, __ATOMIC_RELAXED);
+    }
+    return buffer;
+}
+
+/**
+ * @brief Return a buffer borrowed with dmvfs_bounce_alloc()
+ * @param buffer Buffer to return (NULL is ignored)
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, void, _bounce_free, (void* buffer))
+{
+    uint8_t* ptr = (uint8_t*)buffer;
+    if(ptr == NULL)
+    {
+        return;
+    }
+
+    if(g_bounce.count == 0 || ptr < g_bounce.buffers || ptr >= g_bounce.buffers + g_bounce.count * g_bounce.size ||
+       (size_t)(ptr - g_bounce.buffers) % g_bounce.size != 0)
+    {
+        DMOD_LOG_ERROR("Buffer %p does not belong to the bounce buffer pool\n", buffer);
+        return;
+    }
+
+    bounce_give(ptr);
+}
+
+/**
+ * @brief Set the size of the open-handle cache
+ *
+ * When the cache is enabled, closing a file that was opened only for reading
+ * keeps its backend handle, and the next read-only open of the same path with
+ * the same mode reuses it (rewound to the beginning) instead of opening the
+ * file in the backend again. Cached handles are closed when the path or one
+ * of its parent directories is opened for writing, removed or renamed, when
+ * the mount point is unmounted and when they are evicted to make room for
+ * newer ones. A file changed without DMVFS is detected by its size and
+ * modification time when the handle is reused.
+ *
+ * @param entries Number of cached handles (at most DMVFS_HANDLE_CACHE_SIZE), 0 to disable
+ * @return true on success, false on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, bool, _set_handle_cache, (int entries))
+{
+    if(!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return false;
+    }
+
+    if(entries < 0 || entries > DMVFS_HANDLE_CACHE_SIZE)
+    {
+        DMOD_LOG_ERROR("Invalid arguments to _set_handle_cache\n");
+        return false;
+    }
+
+    if(!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return false;
+    }
+
+    handle_cache_invalidate(NULL, NULL);
+    ticket_lock(&g_handle_cache_lock);
+    g_handle_cache_limit = entries;
+    memset(&g_handle_cache_stats, 0, sizeof(g_handle_cache_stats));
+    ticket_unlock(&g_handle_cache_lock);
+
+    unlock_mutex();
+    return true;
+}
+
+/**
+ * @brief Get statistics of the open-handle cache
+ * @param stats Pointer to store the statistics
+ * @return true on success, false on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, bool, _get_handle_cache_stats, (dmvfs_handle_cache_stats_t* stats))
+{
+    if(!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return false;
+    }
+
+    if(stats == NULL)
+    {
+        DMOD_LOG_ERROR("Invalid arguments to _get_handle_cache_stats\n");
+        return false;
+    }
+
+    ticket_lock(&g_handle_cache_lock);
+    *stats = g_handle_cache_stats;
+    stats->cached = 0;
+    for(int i = 0; i < DMVFS_HANDLE_CACHE_SIZE; i++)
+    {
+        if(g_handle_cache[i].mount_point != NULL)
+        {
+            stats->cached++;
+        }
+    }
+    ticket_unlock(&g_handle_cache_lock);
+    return true;
+}
+
+/**
+ * @brief Refresh the registry of file system modules
+ *
+ * DMVFS keeps a registry of the DMOD modules that implement the DMFSI
+ * interface, so mounting does not walk the whole module list every time.
+ * Modules loaded later are picked up automatically on the first mount that
+ * does not find them, but the registry must be refreshed after a file system
+ * module is unloaded.
+ *
+ * @return Number of registered file systems, or -1 on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _refresh_fs, (void))
+{
+    if(!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return -1;
+    }
+
+    if(!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return -1;
+    }
+
+    int count = refresh_fs_registry();
+
+    unlock_mutex();
+    return count;
+}
+
+/**
+ * @brief Open a file relative to a base directory
+ *
+ * Must be called with the DMVFS mutex locked - the mutex stays locked.
+ *
+ * @param fp Pointer to store the file handle
+ * @param path Absolute path, or path relative to the base directory
+ * @param base Base directory for relative paths
+ * @param dir Backend handle of the base directory for the openat hook (NULL if none)
+ * @param mode File open mode
+ * @param attr File attributes
+ * @param pid Process ID of the caller
+ * @return 0 on success, -1 on failure
+ */
+static int open_file(void** fp, const char* path, const cwd_t* base, void* dir, int mode, int attr, int pid)
+{
+    resolved_path_t resolved;
+    if (!resolve_path(path, base, &resolved))
+    {
+        DMOD_LOG_ERROR("No mount point found for path '%s'\n", path);
+        return -1;
+    }
+    mount_point_t* mp_entry = resolved.mount_point;
+
+    dmvfs_openat_t openat_func = (dir != NULL && path[0] != '/') ? mp_entry->ops.openat : NULL;
+    dmod_dmfsi_fopen_t fopen_func = (dmod_dmfsi_fopen_t)Dmod_GetDifFunction(mp_entry->fs_context, dmod_dmfsi_fopen_sig);
+    if (fopen_func == NULL && openat_func == NULL)
+    {
+        DMOD_LOG_ERROR("File system does not support fopen for path '%s'\n", path);
+        release_path(&resolved);
+        return -1;
+    }
+
+    file_t* free_entry = find_free_file_entry();
+    if (free_entry == NULL)
+    {
+        DMOD_LOG_ERROR("No free file entries available\n");
+        release_path(&resolved);
+        return -1;
+    }
+
+    void* fs_file = NULL;
+    char* fs_path = NULL;
+    int result = 0;
+    uint64_t start = trace_begin();
+    if (g_handle_cache_limit > 0)
+    {
+        if (is_read_only_mode(mode))
+        {
+            fs_file = handle_cache_reuse(mp_entry, resolved.fs_path, mode, &fs_path);
+        }
+        else
+        {
+            handle_cache_invalidate(mp_entry, resolved.fs_path);
+        }
+        if (fs_path == NULL)
+        {
+            fs_path = normalized_path(resolved.fs_path);
+        }
+    }
+    if (fs_file == NULL && openat_func != NULL)
+    {
+        result = openat_func(mp_entry->mount_context, dir, &fs_file, path, mode, attr);
+    }
+    else if (fs_file == NULL)
+    {
+        result = fopen_func(mp_entry->mount_context, &fs_file, resolved.fs_path, mode, attr);
+    }
+    release_path(&resolved);
+
+    if (fs_file == NULL || result != 0)
+    {
+        trace_record(DMVFS_TRACE_OP_FOPEN, pid, mp_entry, NULL, 0, mode, result, start);
+        DMOD_LOG_ERROR("Failed to open file '%s'\n", path);
+        vfs_free(fs_path);
+        return -1;
+    }
+    trace_record(DMVFS_TRACE_OP_FOPEN, pid, mp_entry, free_entry, 0, mode, result, start);
+
+    assign_file_entry(free_entry, mp_entry, fs_file, pid, false);
+    free_entry->mode = mode;
+    free_entry->fs_path = fs_path;
+    *fp = free_entry;
+
+    DMOD_LOG_INFO("File '%s' opened successfully\n", path);
+    return 0;
+}
+
+/**
+ * @brief Open a file in the DMVFS
+ * 
+ * This function opens a file at the specified path with the given mode and attributes.
+ * It resolves the mount point for the file, invokes the file system's open function,
+ * and registers the file in the DMVFS open file table.
+ * 
+ * @param fp Pointer to store the file handle
+ * @param path Path to the file to open
+ * @param mode File open mode (e.g., read, write)
+ * @param attr File attributes
+ * @param pid Process ID of the caller
+ * 
+ * @return 0 on success, -1 on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _fopen, (void** fp, const char* path, int mode, int attr, int pid))
+{
+    if (!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return -1;
+    }
+
+    if (fp == NULL || path == NULL)
+    {
+        DMOD_LOG_ERROR("Invalid arguments to _fopen\n");
+        return -1;
+    }
+
+    if (!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return -1;
+    }
+
+    int result = open_file(fp, path, get_cwd(pid), NULL, mode, attr, pid);
+
+    unlock_mutex();
+    return result;
+}
+
+/**
+ * @brief Open a file relative to an open directory
+ *
+ * Relative paths are resolved against the directory opened with
+ * dmvfs_opendir(), so neither the working directory nor the mount table is
+ * used. Backends that provide the openat hook in their mount operations
+ * receive the directory handle and the relative path directly.
+ *
+ * @param fp Pointer to store the file handle
+ * @param dp Directory handle (from dmvfs_opendir())
+ * @param path Path relative to the directory (absolute paths ignore the directory)
+ * @param mode File open mode
+ * @param attr File attributes
+ * @param pid Process ID of the caller
+ *
+ * @return 0 on success, -1 on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _openat, (void** fp, void* dp, const char* path, int mode, int attr, int pid))
+{
+    if (!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return -1;
+    }
+
+    if (fp == NULL || dp == NULL || path == NULL)
+    {
+        DMOD_LOG_ERROR("Invalid arguments to _openat\n");
+        return -1;
+    }
+
+    if (!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return -1;
+    }
+
+    file_t* dir_entry = (file_t*)dp;
+    cwd_t base;
+    if (!get_dir_base(dir_entry, &base))
+    {
+        DMOD_LOG_ERROR("Invalid directory handle\n");
+        unlock_mutex();
+        return -1;
+    }
+
+    int result = open_file(fp, path, &base, dir_entry->fs_file, mode, attr, pid);
+
+    unlock_mutex();
+    return result;
+}
+
+/**
+ * @brief Close an open file in the DMVFS
+ * 
+ * This function closes a file that was previously opened in the DMVFS.
+ * It invokes the file system's close function and removes the file
+ * from the DMVFS open file table. The handle is released even when the
+ * data left in its write buffer cannot be written - the function then
+ * fails.
+ * 
+ * @param fp Pointer to the file handle to close
+ * 
+ * @return 0 on success, -1 on failure (also if the buffered data was lost)
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _fclose, (void* fp))
+{
+    if (!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return -1;
+    }
+
+    if (fp == NULL)
+    {
+        DMOD_LOG_ERROR("Invalid file pointer\n");
+        return -1;
+    }
+
+    file_t* file_entry = (file_t*)fp;
+
+    if (!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return -1;
+    }
+
+    if (file_entry->revoked)
+    {
+        DMOD_LOG_ERROR("File was already closed by a forced unmount\n");
+        release_file_entry(file_entry);
+        unlock_mutex();
+        return -1;
+    }
+
+    if (file_entry->mount_point == NULL || file_entry->fs_file == NULL)
+    {
+        DMOD_LOG_ERROR("Invalid file entry\n");
+        unlock_mutex();
+        return -1;
+    }
+
+    dmod_dmfsi_fclose_t fclose_func = (dmod_dmfsi_fclose_t)Dmod_GetDifFunction(
+        file_entry->mount_point->fs_context, dmod_dmfsi_fclose_sig);
+
+    if (fclose_func == NULL)
+    {
+        DMOD_LOG_ERROR("File system does not support fclose\n");
+        release_file_entry(file_entry);
+        unlock_mutex();
+        return -1;
+    }
+
+    int flushed = flush_write_buffer(file_entry);
+    if (flushed != 0)
+    {
+        DMOD_LOG_ERROR("Failed to write buffered data\n");
+    }
+
+    uint64_t start = trace_begin();
+    if (flushed == 0 && handle_cache_keep(file_entry))
+    {
+        trace_record(DMVFS_TRACE_OP_FCLOSE, file_entry->pid, file_entry->mount_point, file_entry, 0, 0, 0, start);
+        release_file_entry(file_entry);
+        unlock_mutex();
+        return 0;
+    }
+
+    int result = fclose_func(file_entry->mount_point->mount_context, file_entry->fs_file);
+    trace_record(DMVFS_TRACE_OP_FCLOSE, file_entry->pid, file_entry->mount_point, file_entry, 0, 0, result, start);
+    if (file_entry->fs_path != NULL && !is_read_only_mode(file_entry->mode))
+    {
+        // The file could have been modified - drop handles that were cached in the meantime
+        handle_cache_invalidate(file_entry->mount_point, file_entry->fs_path);
+    }
+    if (result != 0 || flushed != 0)
+    {
+        DMOD_LOG_ERROR("Failed to close file\n");
+        release_file_entry(file_entry);
+        unlock_mutex();
+        return -1;
+    }
+
+    release_file_entry(file_entry);
+
+    unlock_mutex();
+    DMOD_LOG_INFO("File closed successfully\n");
+    return 0;
+}
+
+/**
+ * @brief Close all open files for a given process ID
+ * 
+ * This function iterates through the open file table and closes all files
+ * associated with the specified process ID. It invokes the file system's
+ * close function for each file and removes the file from the DMVFS open file table.
+ * 
+ * @param pid Process ID whose files should be closed
+ * 
+ * @return 0 on success, -1 on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _fclose_process, (int pid))
+{
+    if (!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return -1;
+    }
+
+    if (!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return -1;
+    }
+
+    bool success = true;
+
+    for (int i = 0; i < g_max_open_files; i++)
+    {
+        if (g_open_files[i].pid == pid && g_open_files[i].revoked)
+        {
+            release_file_entry(&g_open_files[i]);
+        }
+        else if (g_open_files[i].pid == pid && !g_open_files[i].is_dir && g_open_files[i].mount_point != NULL)
+        {
+            dmod_dmfsi_fclose_t fclose_func = (dmod_dmfsi_fclose_t)Dmod_GetDifFunction(
+                g_open_files[i].mount_point->fs_context, dmod_dmfsi_fclose_sig);
+
+            if (flush_write_buffer(&g_open_files[i]) != 0)
+            {
+                DMOD_LOG_ERROR("Failed to write buffered data for process ID %d\n", pid);
+                success = false;
+            }
+
+            if (fclose_func != NULL)
+            {
+                if (fclose_func(g_open_files[i].mount_point->mount_context, g_open_files[i].fs_file) != 0)
+                {
+                    DMOD_LOG_ERROR("Failed to close file for process ID %d\n", pid);
+                    success = false;
+                }
+            }
+
+            if (g_open_files[i].fs_path != NULL && !is_read_only_mode(g_open_files[i].mode))
+            {
+                handle_cache_invalidate(g_open_files[i].mount_point, g_open_files[i].fs_path);
+            }
+
+            release_file_entry(&g_open_files[i]);
+        }
+    }
+
+    unlock_mutex();
+
+    if (success)
+    {
+        DMOD_LOG_INFO("All files for process ID %d closed successfully\n", pid);
+        return 0;
+    }
+    else
+    {
+        DMOD_LOG_ERROR("Failed to close some files for process ID %d\n", pid);
+        return -1;
+    }
+}
+
+/**
+ * @brief Read data from an open file in the DMVFS
+ * 
+ * This function reads data from a file that was previously opened in the DMVFS.
+ * It invokes the file system's read function and updates the read_bytes parameter
+ * with the number of bytes actually read.
+ * 
+ * @param fp Pointer to the file handle
+ * @param buf Buffer to store the read data
+ * @param size Number of bytes to read
+ * @param read_bytes Pointer to store the number of bytes actually read
+ * 
+ * @return 0 on success, DMVFS_ERR_AGAIN if the throttling limits did not
+ *         admit the read and no sleep function is set, -1 on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _fread, (void* fp, void* buf, size_t size, size_t* read_bytes))
+{
+    if (!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return -1;
+    }
+
+    if (fp == NULL || buf == NULL || size == 0)
+    {
+        DMOD_LOG_ERROR("Invalid arguments to _fread\n");
+        return -1;
+    }
+
+    if(!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return -1;
+    }
+
+    file_t* file_entry = (file_t*)fp;
+
+    if (!is_file_valid(file_entry))
+    {
+        DMOD_LOG_ERROR("Invalid file entry\n");
+        unlock_mutex();
+        return -1;
+    }
+
+    if (flush_write_buffer(file_entry) != 0)
+    {
+        DMOD_LOG_ERROR("Failed to write buffered data\n");
+        unlock_mutex();
+        return -1;
+    }
+
+    dmod_dmfsi_fread_t fread_func = (dmod_dmfsi_fread_t)Dmod_GetDifFunction(
+        file_entry->mount_point->fs_context, dmod_dmfsi_fread_sig);
+
+    if (fread_func == NULL)
+    {
+        DMOD_LOG_ERROR("File system does not support fread\n");
+        unlock_mutex();
+        return -1;
+    }
+
+    int throttled = throttle_io(file_entry, size);
+    if (throttled != 0)
+    {
+        DMOD_LOG_ERROR("Request was not admitted by the throttling limits\n");
+        return throttled;
+    }
+
+    io_request_t request;
+    if (!io_sched_begin(file_entry, &request))
+    {
+        DMOD_LOG_ERROR("Request was not dispatched by the I/O scheduler\n");
+        return -1;
+    }
+
+    size_t bytes_read = 0;
+    mount_pin_t pin;
+    mount_pin_t* pinned = unlock_for_backend(file_entry->mount_point, &pin);
+    uint64_t start = trace_begin();
+    int result = backend_read(file_entry, fread_func, buf, size, &bytes_read);
+    trace_record(DMVFS_TRACE_OP_FREAD, file_entry->pid, file_entry->mount_point, file_entry, (uint32_t)size, (int32_t)bytes_read, result, start);
+
+    if (read_bytes)
+    {
+        *read_bytes = bytes_read;
+    }
+    unlock_after_backend(pinned);
+    io_sched_end(&request);
+
+    if (result != 0)
+    {
+        DMOD_LOG_ERROR("Failed to read from file\n");
+        return -1;
+    }
+
+    DMOD_LOG_VERBOSE("Read %zu bytes from file\n", bytes_read);
+    return 0;
+}
+
+/**
+ * @brief Write data to an open file in the DMVFS
+ *
+ * This function writes data to a file that was previously opened in the DMVFS.
+ * It invokes the file system's write function and updates the written_bytes parameter
+ * with the number of bytes actually written.
+ *
+ * @param fp Pointer to the file handle
+ * @param buf Buffer containing the data to write
+ * @param size Number of bytes to write
+ * @param written_bytes Pointer to store the number of bytes actually written
+ *
+ * @return 0 on success, DMVFS_ERR_AGAIN if the throttling limits did not
+ *         admit the write and no sleep function is set, -1 on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _fwrite, (void* fp, const void* buf, size_t size, size_t* written_bytes))
+{
+    if (!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return -1;
+    }
+
+    if (fp == NULL || buf == NULL || size == 0)
+    {
+        DMOD_LOG_ERROR("Invalid arguments to _fwrite\n");
+        return -1;
+    }
+
+    if(!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return -1;
+    }
+
+    file_t* file_entry = (file_t*)fp;
+
+    if (!is_file_valid(file_entry))
+    {
+        DMOD_LOG_ERROR("Invalid file entry\n");
+        unlock_mutex();
+        return -1;
+    }
+
+    dmod_dmfsi_fwrite_t fwrite_func = (dmod_dmfsi_fwrite_t)Dmod_GetDifFunction(
+        file_entry->mount_point->fs_context, dmod_dmfsi_fwrite_sig);
+
+    if (fwrite_func == NULL)
+    {
+        DMOD_LOG_ERROR("File system does not support fwrite\n");
+        unlock_mutex();
+        return -1;
+    }
+
+    int throttled = throttle_io(file_entry, size);
+    if (throttled != 0)
+    {
+        DMOD_LOG_ERROR("Request was not admitted by the throttling limits\n");
+        return throttled;
+    }
+
+    io_request_t request;
+    if (!io_sched_begin(file_entry, &request))
+    {
+        DMOD_LOG_ERROR("Request was not dispatched by the I/O scheduler\n");
+        return -1;
+    }
+
+    size_t bytes_written = 0;
+    bool coalesced = file_entry->mount_point->coalesce.program_size != 0;
+    int result = coalesced ? 0 : flush_write_buffer(file_entry);
+    // The write buffer of the handle is guarded by the mutex, so coalesced writes keep it
+    mount_pin_t pin;
+    mount_pin_t* pinned = coalesced ? NULL : unlock_for_backend(file_entry->mount_point, &pin);
+    uint64_t start = trace_begin();
+    if (coalesced)
+    {
+        result = coalesce_write(file_entry, fwrite_func, buf, size);
+        bytes_written = (result == 0) ? size : 0;
+    }
+    else if (result == 0)
+    {
+        result = backend_write(file_entry, fwrite_func, buf, size, &bytes_written);
+    }
+    trace_record(DMVFS_TRACE_OP_FWRITE, file_entry->pid, file_entry->mount_point, file_entry, (uint32_t)size, (int32_t)bytes_written, result, start);
+
+    if (written_bytes)
+    {
+        *written_bytes = bytes_written;
+    }
+
+    unlock_after_backend(pinned);
+    io_sched_end(&request);
+
+    if (result != 0)
+    {
+        DMOD_LOG_ERROR("Failed to write to file\n");
+        return -1;
+    }
+
+    DMOD_LOG_VERBOSE("Wrote %zu bytes to file\n", bytes_written);
+    return 0;
+}
+
+/**
+ * @brief Seek to a position in an open file in the DMVFS
+ *
+ * This function sets the file position for a file previously opened in the DMVFS.
+ * It invokes the file system's lseek function.
+ *
+ * @param fp Pointer to the file handle
+ * @param offset Offset to seek to
+ * @param whence Seek mode (SEEK_SET, SEEK_CUR, SEEK_END)
+ *
+ * @return New offset on success, -1 on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _lseek, (void* fp, long offset, int whence))
+{
+    if (!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return -1;
+    }
+    
+    if (fp == NULL)
+    {
+        DMOD_LOG_ERROR("Invalid file pointer\n");
+        return -1;
+    }
+
+    if(!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return -1;
+    }
+
+    file_t* file_entry = (file_t*)fp;
+    if (!is_file_valid(file_entry))
+    {
+        DMOD_LOG_ERROR("Invalid file entry\n");
+        unlock_mutex();
+        return -1;
+    }
+
+    if (flush_write_buffer(file_entry) != 0)
+    {
+        DMOD_LOG_ERROR("Failed to write buffered data\n");
+        unlock_mutex();
+        return -1;
+    }
+
+    dmod_dmfsi_lseek_t lseek_func = (dmod_dmfsi_lseek_t)Dmod_GetDifFunction(
+        file_entry->mount_point->fs_context, dmod_dmfsi_lseek_sig);
+    
+    if (lseek_func == NULL)
+    {
+        DMOD_LOG_ERROR("File system does not support lseek\n");
+        unlock_mutex();
+        return -1;
+    }
+
+    mount_pin_t pin;
+    mount_pin_t* pinned = unlock_for_backend(file_entry->mount_point, &pin);
+    uint64_t start = trace_begin();
+    int result = lseek_func(file_entry->mount_point->mount_context, file_entry->fs_file, offset, whence);
+    trace_record(DMVFS_TRACE_OP_LSEEK, file_entry->pid, file_entry->mount_point, file_entry, offset, whence, result, start);
+    unlock_after_backend(pinned);
+
+    if (result < 0)
+    {
+        DMOD_LOG_ERROR("Failed to seek in file\n");
+        return -1;
+    }
+
+    return result;
+}
+
+/**
+ * @brief Get the current position in an open file in the DMVFS
+ *
+ * This function returns the current file position for a file previously opened in the DMVFS.
+ * It invokes the file system's ftell function.
+ *
+ * @param fp Pointer to the file handle
+ *
+ * @return Current offset on success, -1 on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, long, _ftell, (void* fp))
+{
+    if (!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return -1;
+    }
+    if (fp == NULL)
+    {
+        DMOD_LOG_ERROR("Invalid file pointer\n");
+        return -1;
+    }
+
+    if(!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return -1;
+    }
+
+    file_t* file_entry = (file_t*)fp;
+    if (!is_file_valid(file_entry))
+    {
+        DMOD_LOG_ERROR("Invalid file entry\n");
+        unlock_mutex();
+        return -1;
+    }
+    if (flush_write_buffer(file_entry) != 0)
+    {
+        unlock_mutex();
+        return -1;
+    }
+    dmod_dmfsi_tell_t ftell_func = (dmod_dmfsi_tell_t)Dmod_GetDifFunction(
+        file_entry->mount_point->fs_context, dmod_dmfsi_tell_sig);
+    if (ftell_func == NULL)
+    {
+        DMOD_LOG_ERROR("File system does not support ftell\n");
+        unlock_mutex();
+        return -1;
+    }
+    mount_pin_t pin;
+    mount_pin_t* pinned = unlock_for_backend(file_entry->mount_point, &pin);
+    uint64_t start = trace_begin();
+    long result = ftell_func(file_entry->mount_point->mount_context, file_entry->fs_file);
+    trace_record(DMVFS_TRACE_OP_FTELL, file_entry->pid, file_entry->mount_point, file_entry, 0, 0, (int32_t)result, start);
+    unlock_after_backend(pinned);
+    
+    if (result < 0)
+    {
+        DMOD_LOG_ERROR("Failed to get file position\n");
+        return -1;
+    }
+    return result;
+}
+
+/**
+ * @brief Check if end-of-file has been reached for a DMVFS file
+ *
+ * @param fp Pointer to the file handle
+ * @return 1 if EOF, 0 otherwise, -1 on error
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _feof, (void* fp))
+{
+    if (!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return -1;
+    }
+    
+    if (fp == NULL)
+    {
+        DMOD_LOG_ERROR("Invalid file pointer\n");
+        return -1;
+    }
+
+    if(!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return -1;
+    }
+
+    file_t* file_entry = (file_t*)fp;
+    if (!is_file_valid(file_entry))
+    {
+        DMOD_LOG_ERROR("Invalid file entry\n");
+        unlock_mutex();
+        return -1;
+    }
+
+    if (flush_write_buffer(file_entry) != 0)
+    {
+        DMOD_LOG_ERROR("Failed to write buffered data\n");
+        unlock_mutex();
+        return -1;
+    }
+
+    dmod_dmfsi_eof_t feof_func = (dmod_dmfsi_eof_t)Dmod_GetDifFunction(
+        file_entry->mount_point->fs_context, dmod_dmfsi_eof_sig);
+    
+    if (feof_func == NULL)
+    {
+        DMOD_LOG_ERROR("File system does not support feof\n");
+        unlock_mutex();
+        return -1;
+    }
+
+    mount_pin_t pin;
+    mount_pin_t* pinned = unlock_for_backend(file_entry->mount_point, &pin);
+    uint64_t start = trace_begin();
+    int result = feof_func(file_entry->mount_point->mount_context, file_entry->fs_file);
+    trace_record(DMVFS_TRACE_OP_FEOF, file_entry->pid, file_entry->mount_point, file_entry, 0, 0, result, start);
+    unlock_after_backend(pinned);
+    return result;
+}
+
+/**
+ * @brief Flush file buffers for a DMVFS file
+ *
+ * @param fp Pointer to the file handle
+ * @return 0 on success, -1 on error
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _fflush, (void* fp))
+{
+    if (!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return -1;
+    }
+    
+    if (fp == NULL)
+    {
+        DMOD_LOG_ERROR("Invalid file pointer\n");
+        return -1;
+    }
+
+    if(!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return -1;
+    }
+
+    file_t* file_entry = (file_t*)fp;
+    if (!is_file_valid(file_entry))
+    {
+        DMOD_LOG_ERROR("Invalid file entry\n");
+        unlock_mutex();
+        return -1;
+    }
+
+    if (flush_write_buffer(file_entry) != 0)
+    {
+        DMOD_LOG_ERROR("Failed to write buffered data\n");
+        unlock_mutex();
+        return -1;
+    }
+
+    dmod_dmfsi_fflush_t fflush_func = (dmod_dmfsi_fflush_t)Dmod_GetDifFunction(
+        file_entry->mount_point->fs_context, dmod_dmfsi_fflush_sig);
+    
+    if (fflush_func == NULL)
+    {
+        DMOD_LOG_ERROR("File system does not support fflush\n");
+        unlock_mutex();
+        return -1;
+    }
+
+    io_request_t request;
+    if (!io_sched_begin(file_entry, &request))
+    {
+        DMOD_LOG_ERROR("Request was not dispatched by the I/O scheduler\n");
+        return -1;
+    }
+
+    mount_pin_t pin;
+    mount_pin_t* pinned = unlock_for_backend(file_entry->mount_point, &pin);
+    uint64_t start = trace_begin();
+    int result = fflush_func(file_entry->mount_point->mount_context, file_entry->fs_file);
+    trace_record(DMVFS_TRACE_OP_FFLUSH, file_entry->pid, file_entry->mount_point, file_entry, 0, 0, result, start);
+    unlock_after_backend(pinned);
+    io_sched_end(&request);
+    return result;
+}
+
+/**
+ * @brief Get error status for a DMVFS file
+ *
+ * @param fp Pointer to the file handle
+ * @return Error code or 0 if no error
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _error, (void* fp))
+{
+    if (!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return -1;
+    }
+    
+    if (fp == NULL)
+    {
+        DMOD_LOG_ERROR("Invalid file pointer\n");
+        return -1;
+    }
+
+    if(!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return -1;
+    }
+
+    file_t* file_entry = (file_t*)fp;
+    if (!is_file_valid(file_entry))
+    {
+        DMOD_LOG_ERROR("Invalid file entry\n");
+        unlock_mutex();
+        return -1;
+    }
+
+    if (flush_write_buffer(file_entry) != 0)
+    {
+        DMOD_LOG_ERROR("Failed to write buffered data\n");
+        unlock_mutex();
+        return -1;
+    }
+
+    dmod_dmfsi_error_t error_func = (dmod_dmfsi_error_t)Dmod_GetDifFunction(
+        file_entry->mount_point->fs_context, dmod_dmfsi_error_sig);
+    
+    if (error_func == NULL)
+    {
+        DMOD_LOG_ERROR("File system does not support error\n");
+        unlock_mutex();
+        return -1;
+    }
+
+    mount_pin_t pin;
+    mount_pin_t* pinned = unlock_for_backend(file_entry->mount_point, &pin);
+    uint64_t start = trace_begin();
+    int result = error_func(file_entry->mount_point->mount_context, file_entry->fs_file);
+    trace_record(DMVFS_TRACE_OP_ERROR, file_entry->pid, file_entry->mount_point, file_entry, 0, 0, result, start);
+    unlock_after_backend(pinned);
+    return result;
+}
+
+/**
+ * @brief Remove a file in DMVFS
+ *
+ * @param path Path to the file
+ * @return 0 on success, -1 on error
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _remove, (const char* path))
+{
+    if (!is_initialized() || path == NULL)
+        return -1;
+    
+    resolved_path_t resolved;
+    if (!acquire_path(path, &resolved))
+    {
+        DMOD_LOG_ERROR("No mount point found for path '%s'\n", path);
+        return -1;
+    }
+    mount_point_t* mp_entry = resolved.mount_point;
+    dmod_dmfsi_unlink_t remove_func = (dmod_dmfsi_unlink_t)Dmod_GetDifFunction(
+        mp_entry->fs_context, dmod_dmfsi_unlink_sig);
+    int result = -1;
+    handle_cache_invalidate(mp_entry, resolved.fs_path);
+    uint64_t start = trace_begin();
+    if (remove_func)
+        result = remove_func(mp_entry->mount_context, resolved.fs_path);
+    trace_record(DMVFS_TRACE_OP_REMOVE, -1, mp_entry, NULL, 0, 0, result, start);
+    release_path(&resolved);
+    return result;
+}
+
+/**
+ * @brief Rename a file in DMVFS
+ *
+ * @param oldpath Old file path
+ * @param newpath New file path
+ * @return 0 on success, -1 on error
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _rename, (const char* oldpath, const char* newpath))
+{
+    if (!is_initialized() || oldpath == NULL || newpath == NULL)
+        return -1;
+    
+    if(!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return -1;
+    }
+    
+    resolved_path_t resolved_old;
+    resolved_path_t resolved_new;
+    if (!resolve_path(oldpath, current_cwd(), &resolved_old))
+    {
+        unlock_mutex();
+        return -1;
+    }
+    if (!resolve_path(newpath, current_cwd(), &resolved_new))
+    {
+        release_path(&resolved_old);
+        unlock_mutex();
+        return -1;
+    }
+    mount_point_t* mp_entry = resolved_old.mount_point;
+    if (resolved_new.mount_point != mp_entry)
+    {
+        DMOD_LOG_ERROR("Cannot rename '%s' to '%s': different mount points (use dmvfs_move)\n", oldpath, newpath);
+        release_path(&resolved_old);
+        release_path(&resolved_new);
+        unlock_mutex();
+        return -1;
+    }
+    dmod_dmfsi_rename_t rename_func = (dmod_dmfsi_rename_t)Dmod_GetDifFunction(
+        mp_entry->fs_context, dmod_dmfsi_rename_sig);
+    int result = -1;
+    handle_cache_invalidate(mp_entry, resolved_old.fs_path);
+    handle_cache_invalidate(mp_entry, resolved_new.fs_path);
+    mount_pin_t pin;
+    mount_pin_t* pinned = unlock_for_backend(mp_entry, &pin);
+    uint64_t start = trace_begin();
+    if (rename_func)
+        result = rename_func(mp_entry->mount_context, resolved_old.fs_path, resolved_new.fs_path);
+    trace_record(DMVFS_TRACE_OP_RENAME, -1, mp_entry, NULL, 0, 0, result, start);
+    release_path(&resolved_old);
+    release_path(&resolved_new);
+    unlock_after_backend(pinned);
+    return result;
+}
+
+/**
+ * @brief Perform an ioctl operation on a DMVFS file
+ *
+ * @param fp Pointer to the file handle
+ * @param command Ioctl command
+ * @param arg Argument for the command
+ * @return 0 on success, -1 on error
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _ioctl, (void* fp, int command, void* arg))
+{
+    if (!is_initialized() || fp == NULL)
+        return -1;
+    
+    if(!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return -1;
+    }
+    
+    file_t* file_entry = (file_t*)fp;
+    if (!is_file_valid(file_entry))
+    {
+        unlock_mutex();
+        return -1;
+    }
+    if (flush_write_buffer(file_entry) != 0)
+    {
+        unlock_mutex();
+        return -1;
+    }
+    dmod_dmfsi_ioctl_t ioctl_func = (dmod_dmfsi_ioctl_t)Dmod_GetDifFunction(
+        file_entry->mount_point->fs_context, dmod_dmfsi_ioctl_sig);
+    if (!ioctl_func)
+    {
+        unlock_mutex();
+        return -1;
+    }
+    mount_pin_t pin;
+    mount_pin_t* pinned = unlock_for_backend(file_entry->mount_point, &pin);
+    uint64_t start = trace_begin();
+    int result = ioctl_func(file_entry->mount_point->mount_context, file_entry->fs_file, command, arg);
+    trace_record(DMVFS_TRACE_OP_IOCTL, file_entry->pid, file_entry->mount_point, file_entry, 0, command, result, start);
+    unlock_after_backend(pinned);
+    return result;
+}
+
+/**
+ * @brief Synchronize a DMVFS file (flush to disk)
+ *
+ * @param fp Pointer to the file handle
+ * @return 0 on success, -1 on error
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _sync, (void* fp))
+{
+    if (!is_initialized() || fp == NULL)
+        return -1;
+    
+    if(!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return -1;
+    }
+    
+    file_t* file_entry = (file_t*)fp;
+    if (!is_file_valid(file_entry))
+    {
+        unlock_mutex();
+        return -1;
+    }
+    if (flush_write_buffer(file_entry) != 0)
+    {
+        unlock_mutex();
+        return -1;
+    }
+    dmod_dmfsi_sync_t sync_func = (dmod_dmfsi_sync_t)Dmod_GetDifFunction(
+        file_entry->mount_point->fs_context, dmod_dmfsi_sync_sig);
+    if (!sync_func)
+    {
+        unlock_mutex();
+        return -1;
+    }
+    io_request_t request;
+    if (!io_sched_begin(file_entry, &request))
+    {
+        DMOD_LOG_ERROR("Request was not dispatched by the I/O scheduler\n");
+        return -1;
+    }
+
+    mount_pin_t pin;
+    mount_pin_t* pinned = unlock_for_backend(file_entry->mount_point, &pin);
+    uint64_t start = trace_begin();
+    int result = sync_func(file_entry->mount_point->mount_context, file_entry->fs_file);
+    trace_record(DMVFS_TRACE_OP_SYNC, file_entry->pid, file_entry->mount_point, file_entry, 0, 0, result, start);
+    unlock_after_backend(pinned);
+    io_sched_end(&request);
+    return result;
+}
+
+/**
+ * @brief Get file status information in DMVFS
+ *
+ * @param path Path to the file
+ * @param stat Pointer to stat structure to fill
+ * @return 0 on success, -1 on error
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _stat, (const char* path, dmfsi_stat_t* stat))
+{
+    if (!is_initialized() || path == NULL || stat == NULL)
+        return -1;
+    
+    resolved_path_t resolved;
+    if (!acquire_path(path, &resolved))
+    {
+        DMOD_LOG_ERROR("No mount point found for path '%s'\n", path);
+        return -1;
+    }
+    mount_point_t* mp_entry = resolved.mount_point;
+    dmod_dmfsi_stat_t stat_func = (dmod_dmfsi_stat_t)Dmod_GetDifFunction(
+        mp_entry->fs_context, dmod_dmfsi_stat_sig);
+    int result = -1;
+    uint64_t start = trace_begin();
+    if (stat_func)
+        result = stat_func(mp_entry->mount_context, resolved.fs_path, stat);
+    trace_record(DMVFS_TRACE_OP_STAT, -1, mp_entry, NULL, 0, 0, result, start);
+    release_path(&resolved);
+    return result;
+}
+
+/**
+ * @brief Get file information relative to an open directory
+ *
+ * @param dp Directory handle (from dmvfs_opendir())
+ * @param path Path relative to the directory (absolute paths ignore the directory)
+ * @param stat Pointer to store the file information
+ * @return 0 on success, -1 on error
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _statat, (void* dp, const char* path, dmfsi_stat_t* stat))
+{
+    if (!is_initialized() || dp == NULL || path == NULL || stat == NULL)
+        return -1;
+
+    if (!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return -1;
+    }
+
+    file_t* dir_entry = (file_t*)dp;
+    cwd_t base;
+    resolved_path_t resolved;
+    if (!get_dir_base(dir_entry, &base) || !resolve_path(path, &base, &resolved))
+    {
+        DMOD_LOG_ERROR("Cannot resolve path '%s' in directory\n", path);
+        unlock_mutex();
+        return -1;
+    }
+    mount_point_t* mp_entry = resolved.mount_point;
+    dmvfs_statat_t statat_func = (path[0] != '/') ? mp_entry->ops.statat : NULL;
+    dmod_dmfsi_stat_t stat_func = (dmod_dmfsi_stat_t)Dmod_GetDifFunction(
+        mp_entry->fs_context, dmod_dmfsi_stat_sig);
+    int result = -1;
+    mount_pin_t pin;
+    mount_pin_t* pinned = unlock_for_backend(mp_entry, &pin);
+    uint64_t start = trace_begin();
+    if (statat_func)
+        result = statat_func(mp_entry->mount_context, dir_entry->fs_file, path, stat);
+    else if (stat_func)
+        result = stat_func(mp_entry->mount_context, resolved.fs_path, stat);
+    trace_record(DMVFS_TRACE_OP_STAT, -1, mp_entry, NULL, 0, 0, result, start);
+    release_path(&resolved);
+    unlock_after_backend(pinned);
+    return result;
+}
+
+/**
+ * @brief Read a whole file in one call
+ *
+ * The path is resolved once and the file is opened, read and closed directly
+ * in the backend, without taking an entry of the open file table. When
+ * *buffer is NULL, a buffer of the size of the file (plus a terminating zero,
+ * so text files can be used as strings) is allocated and must be released
+ * with dmvfs_free_buffer(). Otherwise at most *size bytes are read into the
+ * buffer of the caller - a larger file fails with DMVFS_ERR_TOO_BIG, the
+ * buffer then holds the beginning of the file and *size the size of the file
+ * (if the backend can stat it). The reads go through the throttling limits
+ * and the I/O scheduler like dmvfs_fread().
+ *
+ * @param path Path to the file
+ * @param buffer Pointer to the buffer of the caller, or to NULL to allocate one
+ * @param size Size of the buffer of the caller on input, number of bytes read on output
+ * @return 0 on success, DMVFS_ERR_TOO_BIG if the file does not fit in the
+ *         buffer of the caller, DMVFS_ERR_AGAIN if the throttling limits did
+ *         not admit a read and no sleep function is set, -1 on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _read_file, (const char* path, void** buffer, size_t* size))
+{
+    if (!is_initialized() || path == NULL || buffer == NULL || size == NULL)
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized or invalid arguments to _read_file\n");
+        return -1;
+    }
+
+    resolved_path_t resolved;
+    if (!acquire_path(path, &resolved))
+    {
+        DMOD_LOG_ERROR("No mount point found for path '%s'\n", path);
+        return -1;
+    }
+    mount_point_t* mp_entry = resolved.mount_point;
+
+    dmod_dmfsi_fopen_t fopen_func = (dmod_dmfsi_fopen_t)Dmod_GetDifFunction(mp_entry->fs_context, dmod_dmfsi_fopen_sig);
+    dmod_dmfsi_fread_t fread_func = (dmod_dmfsi_fread_t)Dmod_GetDifFunction(mp_entry->fs_context, dmod_dmfsi_fread_sig);
+    dmod_dmfsi_fclose_t fclose_func = (dmod_dmfsi_fclose_t)Dmod_GetDifFunction(mp_entry->fs_context, dmod_dmfsi_fclose_sig);
+    dmod_dmfsi_stat_t stat_func = (dmod_dmfsi_stat_t)Dmod_GetDifFunction(mp_entry->fs_context, dmod_dmfsi_stat_sig);
+    if (fopen_func == NULL || fread_func == NULL || fclose_func == NULL || (*buffer == NULL && stat_func == NULL))
+    {
+        DMOD_LOG_ERROR("File system does not support reading of '%s'\n", path);
+        release_path(&resolved);
+        return -1;
+    }
+
+    uint8_t* data = (uint8_t*)*buffer;
+    size_t capacity = *size;
+    if (data == NULL)
+    {
+        dmfsi_stat_t stat = {0};
+        uint64_t start = trace_begin();
+        int result = stat_func(mp_entry->mount_context, resolved.fs_path, &stat);
+        trace_record(DMVFS_TRACE_OP_STAT, -1, mp_entry, NULL, 0, 0, result, start);
+        if (result != 0)
+        {
+            DMOD_LOG_ERROR("Cannot stat file '%s'\n", path);
+            release_path(&resolved);
+            return -1;
+        }
+        capacity = (size_t)stat.size;
+        data = (uint8_t*)vfs_malloc(capacity + 1);
+        if (data == NULL)
+        {
+            DMOD_LOG_ERROR("Cannot allocate buffer for file '%s'\n", path);
+            release_path(&resolved);
+            return -1;
+        }
+    }
+
+    void* fs_file = NULL;
+    uint64_t start = trace_begin();
+    int result = fopen_func(mp_entry->mount_context, &fs_file, resolved.fs_path, DMFSI_O_RDONLY, 0);
+    trace_record(DMVFS_TRACE_OP_FOPEN, -1, mp_entry, NULL, 0, DMFSI_O_RDONLY, result, start);
+    if (result != 0 || fs_file == NULL)
+    {
+        DMOD_LOG_ERROR("Failed to open file '%s'\n", path);
+        release_path(&resolved);
+        if (*buffer == NULL)
+        {
+            vfs_free(data);
+        }
+        return -1;
+    }
+
+    size_t total = 0;
+    bool too_big = false;
+    for (;;)
+    {
+        // A full buffer of the caller is probed with one more byte to detect a larger file
+        uint8_t probe = 0;
+        bool probing = (total == capacity);
+        if (probing && *buffer == NULL)
+        {
+            break;
+        }
+        size_t length = probing ? 1 : capacity - total;
+        io_request_t request;
+        result = admit_direct_io(&resolved, length, &request);
+        if (result != 0)
+        {
+            break;
+        }
+        size_t chunk = 0;
+        start = trace_begin();
+        result = fread_func(mp_entry->mount_context, fs_file, probing ? &probe : data + total, length, &chunk);
+        trace_record(DMVFS_TRACE_OP_FREAD, -1, mp_entry, NULL, (uint32_t)length, (int32_t)chunk, result, start);
+        finish_direct_io(&resolved, &request);
+        if (result != 0 || chunk == 0)
+        {
+            break;
+        }
+        if (probing)
+        {
+            too_big = true;
+            break;
+        }
+        total += chunk;
+    }
+
+    start = trace_begin();
+    int close_result = fclose_func(mp_entry->mount_context, fs_file);
+    trace_record(DMVFS_TRACE_OP_FCLOSE, -1, mp_entry, NULL, 0, 0, close_result, start);
+
+    if (result != 0)
+    {
+        DMOD_LOG_ERROR("Failed to read file '%s'\n", path);
+        release_path(&resolved);
+        if (*buffer == NULL)
+        {
+            vfs_free(data);
+        }
+        return (result == DMVFS_ERR_AGAIN) ? result : -1;
+    }
+
+    if (too_big)
+    {
+        DMOD_LOG_ERROR("File '%s' does not fit in a buffer of %zu bytes\n", path, capacity);
+        dmfsi_stat_t stat = {0};
+        if (stat_func != NULL && stat_func(mp_entry->mount_context, resolved.fs_path, &stat) == 0)
+        {
+            *size = (size_t)stat.size;
+        }
+        release_path(&resolved);
+        return DMVFS_ERR_TOO_BIG;
+    }
+    release_path(&resolved);
+
+    if (*buffer == NULL)
+    {
+        data[total] = 0;
+        *buffer = data;
+    }
+    *size = total;
+    return 0;
+}
+
+/**
+ * @brief Release a buffer allocated by DMVFS
+ * @param buffer Buffer returned by dmvfs_read_file() (can be NULL)
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, void, _free_buffer, (void* buffer))
+{
+    vfs_free(buffer);
+}
+
+/**
+ * @brief Replace the content of a file atomically
+ *
+ * The data is written to a temporary file next to the target (the path with
+ * DMVFS_ATOMIC_SUFFIX and a sequence number appended, so concurrent writes
+ * of the same path never share it), synchronized, closed and then renamed
+ * over the target, so after a power loss the file holds either the old or
+ * the new content. The path is resolved once and all steps run directly in
+ * the backend. Backends that provide the write_atomic hook in their mount
+ * operations get the whole request instead. The writes go through the
+ * throttling limits and the I/O scheduler like dmvfs_fwrite().
+ *
+ * @param path Path to the file
+ * @param data Data to write (can be NULL if size is 0)
+ * @param size Number of bytes to write
+ * @return 0 on success, DMVFS_ERR_AGAIN if the throttling limits did not
+ *         admit a write and no sleep function is set, -1 on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _write_file_atomic, (const char* path, const void* data, size_t size))
+{
+    if (!is_initialized() || path == NULL || (data == NULL && size != 0))
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized or invalid arguments to _write_file_atomic\n");
+        return -1;
+    }
+
+    resolved_path_t resolved;
+    if (!acquire_path(path, &resolved))
+    {
+        DMOD_LOG_ERROR("No mount point found for path '%s'\n", path);
+        return -1;
+    }
+    mount_point_t* mp_entry = resolved.mount_point;
+    handle_cache_invalidate(mp_entry, resolved.fs_path);
+
+    int result = -1;
+    uint64_t start = 0;
+    if (mp_entry->ops.write_atomic != NULL)
+    {
+        io_request_t request;
+        result = admit_direct_io(&resolved, size, &request);
+        if (result == 0)
+        {
+            start = trace_begin();
+            result = mp_entry->ops.write_atomic(mp_entry->mount_context, resolved.fs_path, data, size);
+            trace_record(DMVFS_TRACE_OP_FWRITE, -1, mp_entry, NULL, (uint32_t)size, 0, result, start);
+            finish_direct_io(&resolved, &request);
+        }
+        release_path(&resolved);
+        return (result == 0 || result == DMVFS_ERR_AGAIN) ? result : -1;
+    }
+
+    dmod_dmfsi_fopen_t fopen_func = (dmod_dmfsi_fopen_t)Dmod_GetDifFunction(mp_entry->fs_context, dmod_dmfsi_fopen_sig);
+    dmod_dmfsi_fwrite_t fwrite_func = (dmod_dmfsi_fwrite_t)Dmod_GetDifFunction(mp_entry->fs_context, dmod_dmfsi_fwrite_sig);
+    dmod_dmfsi_fclose_t fclose_func = (dmod_dmfsi_fclose_t)Dmod_GetDifFunction(mp_entry->fs_context, dmod_dmfsi_fclose_sig);
+    dmod_dmfsi_rename_t rename_func = (dmod_dmfsi_rename_t)Dmod_GetDifFunction(mp_entry->fs_context, dmod_dmfsi_rename_sig);
+    dmod_dmfsi_sync_t sync_func = (dmod_dmfsi_sync_t)Dmod_GetDifFunction(mp_entry->fs_context, dmod_dmfsi_sync_sig);
+    dmod_dmfsi_unlink_t unlink_func = (dmod_dmfsi_unlink_t)Dmod_GetDifFunction(mp_entry->fs_context, dmod_dmfsi_unlink_sig);
+    if (fopen_func == NULL || fwrite_func == NULL || fclose_func == NULL || rename_func == NULL)
+    {
+        DMOD_LOG_ERROR("File system does not support atomic writes of '%s'\n", path);
+        release_path(&resolved);
+        return -1;
+    }
+
+    // Every write gets its own temporary file, so concurrent writes of the path do not share it
+    static const char digits[] = "0123456789abcdef";
+    uint32_t sequence = __atomic_fetch_add(&g_atomic_sequence, 1, __ATOMIC_RELAXED);
+    size_t length = strlen(resolved.fs_path);
+    char* temp_path = (char*)vfs_malloc(length + sizeof(DMVFS_ATOMIC_SUFFIX) + 8);
+    if (temp_path == NULL)
+    {
+        DMOD_LOG_ERROR("Failed to allocate memory for path\n");
+        release_path(&resolved);
+        return -1;
+    }
+    memcpy(temp_path, resolved.fs_path, length);
+    memcpy(temp_path + length, DMVFS_ATOMIC_SUFFIX, sizeof(DMVFS_ATOMIC_SUFFIX) - 1);
+    char* suffix = temp_path + length + sizeof(DMVFS_ATOMIC_SUFFIX) - 1;
+    for (int i = 0; i < 8; i++)
+    {
+        suffix[i] = digits[(sequence >> (28 - 4 * i)) & 0xF];
+    }
+    suffix[8] = '\0';
+
+    void* fs_file = NULL;
+    start = trace_begin();
+    result = fopen_func(mp_entry->mount_context, &fs_file, temp_path, DMFSI_O_CREAT | DMFSI_O_WRONLY | DMFSI_O_TRUNC, 0);
+    trace_record(DMVFS_TRACE_OP_FOPEN, -1, mp_entry, NULL, 0, DMFSI_O_CREAT | DMFSI_O_WRONLY | DMFSI_O_TRUNC, result, start);
+    if (result == 0 && fs_file != NULL)
+    {
+        size_t total = 0;
+        while (result == 0 && total < size)
+        {
+            io_request_t request;
+            result = admit_direct_io(&resolved, size - total, &request);
+            if (result != 0)
+            {
+                break;
+            }
+            size_t chunk = 0;
+            start = trace_begin();
+            result = fwrite_func(mp_entry->mount_context, fs_file, (const uint8_t*)data + total, size - total, &chunk);
+            trace_record(DMVFS_TRACE_OP_FWRITE, -1, mp_entry, NULL, (uint32_t)(size - total), (int32_t)chunk, result, start);
+            finish_direct_io(&resolved, &request);
+            if (result == 0 && chunk == 0)
+            {
+                result = -1;
+            }
+            total += chunk;
+        }
+
+        if (result == 0 && sync_func != NULL)
+        {
+            start = trace_begin();
+            result = sync_func(mp_entry->mount_context, fs_file);
+            trace_record(DMVFS_TRACE_OP_SYNC, -1, mp_entry, NULL, 0, 0, result, start);
+        }
+
+        start = trace_begin();
+        int close_result = fclose_func(mp_entry->mount_context, fs_file);
+        trace_record(DMVFS_TRACE_OP_FCLOSE, -1, mp_entry, NULL, 0, 0, close_result, start);
+        if (result == 0)
+        {
+            result = close_result;
+        }
+
+        if (result == 0)
+        {
+            start = trace_begin();
+            result = rename_func(mp_entry->mount_context, temp_path, resolved.fs_path);
+            trace_record(DMVFS_TRACE_OP_RENAME, -1, mp_entry, NULL, 0, 0, result, start);
+        }
+
+        if (result != 0 && unlink_func != NULL)
+        {
+            // Do not leave a partial temporary file behind - the target is untouched
+            unlink_func(mp_entry->mount_context, temp_path);
+        }
+    }
+    else
+    {
+        result = -1;
+    }
+
+    vfs_free(temp_path);
+    release_path(&resolved);
+
+    if (result != 0)
+    {
+        DMOD_LOG_ERROR("Failed to write file '%s'\n", path);
+        return (result == DMVFS_ERR_AGAIN) ? result : -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Check if two paths are on the same mount point
+ * @param path_a First path
+ * @param path_b Second path
+ * @return true if both paths resolve to the same mount point
+ */
+static bool is_same_mount(const char* path_a, const char* path_b)
+{
+    if (!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return false;
+    }
+
+    bool same = false;
+    resolved_path_t resolved_a;
+    resolved_path_t resolved_b;
+    if (resolve_path(path_a, current_cwd(), &resolved_a))
+    {
+        if (resolve_path(path_b, current_cwd(), &resolved_b))
+        {
+            same = (resolved_a.mount_point == resolved_b.mount_point);
+            release_path(&resolved_b);
+        }
+        release_path(&resolved_a);
+    }
+
+    unlock_mutex();
+    return same;
+}
+
+/**
+ * @brief Check if two paths lead to the same file
+ *
+ * The paths are resolved and compared by the mount point and the normalized
+ * path inside of its file system, so "/sd/a.txt" and "/sd/./a.txt" are the
+ * same file.
+ *
+ * @param path_a First path
+ * @param path_b Second path
+ * @return true if both paths lead to the same file
+ */
+static bool is_same_file(const char* path_a, const char* path_b)
+{
+    if (!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return false;
+    }
+
+    bool same = false;
+    resolved_path_t resolved_a;
+    resolved_path_t resolved_b;
+    if (resolve_path(path_a, current_cwd(), &resolved_a))
+    {
+        if (resolve_path(path_b, current_cwd(), &resolved_b))
+        {
+            if (resolved_a.mount_point == resolved_b.mount_point)
+            {
+                char* fs_path_a = normalized_path(resolved_a.fs_path);
+                char* fs_path_b = normalized_path(resolved_b.fs_path);
+                same = (fs_path_a != NULL && fs_path_b != NULL && strcmp(fs_path_a, fs_path_b) == 0);
+                vfs_free(fs_path_a);
+                vfs_free(fs_path_b);
+            }
+            release_path(&resolved_b);
+        }
+        release_path(&resolved_a);
+    }
+
+    unlock_mutex();
+    return same;
+}
+
+/**
+ * @brief Copy a file, also between different mount points
+ *
+ * The data is streamed in chunks of DMVFS_COPY_CHUNK_SIZE bytes through
+ * regular file handles, so the DMVFS mutex is taken once per chunk rather
+ * than for the whole copy, and the transfer goes through the I/O scheduler,
+ * throttling and write coalescing of both mount points. Both files are
+ * opened for the calling process (see dmvfs_set_getpid()) and resolved
+ * against its working directory. The destination is created or truncated,
+ * so copying a file onto itself is rejected, and it is removed again when
+ * the copy fails.
+ *
+ * @param src Path of the source file
+ * @param dst Path of the destination file
+ * @param stats Pointer to store the amount of copied data and the throughput (can be NULL)
+ * @return 0 on success, -1 on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _copy, (const char* src, const char* dst, dmvfs_copy_stats_t* stats))
+{
+    if (!is_initialized() || src == NULL || dst == NULL)
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized or invalid arguments to _copy\n");
+        return -1;
+    }
+
+    if (is_same_file(src, dst))
+    {
+        DMOD_LOG_ERROR("Cannot copy '%s' onto itself\n", src);
+        return -1;
+    }
+
+    uint8_t* buffer = (uint8_t*)vfs_malloc(DMVFS_COPY_CHUNK_SIZE);
+    if (buffer == NULL)
+    {
+        DMOD_LOG_ERROR("Failed to allocate copy buffer\n");
+        return -1;
+    }
+
+    uint64_t start = (g_clock != NULL) ? g_clock() : 0;
+    int pid = current_pid();
+    void* in_fp = NULL;
+    void* out_fp = NULL;
+    if (dmvfs_fopen(&in_fp, src, DMFSI_O_RDONLY, 0, pid) != 0)
+    {
+        vfs_free(buffer);
+        return -1;
+    }
+    if (dmvfs_fopen(&out_fp, dst, DMFSI_O_CREAT | DMFSI_O_WRONLY | DMFSI_O_TRUNC, 0, pid) != 0)
+    {
+        dmvfs_fclose(in_fp);
+        vfs_free(buffer);
+        return -1;
+    }
+
+    int result = 0;
+    uint64_t total = 0;
+    for (;;)
+    {
+        size_t read_bytes = 0;
+        size_t written = 0;
+        result = dmvfs_fread(in_fp, buffer, DMVFS_COPY_CHUNK_SIZE, &read_bytes);
+        if (result != 0 || read_bytes == 0)
+        {
+            break;
+        }
+        result = dmvfs_fwrite(out_fp, buffer, read_bytes, &written);
+        total += written;
+        if (result == 0 && written != read_bytes)
+        {
+            result = -1;
+        }
+        if (result != 0)
+        {
+            break;
+        }
+    }
+
+    dmvfs_fclose(in_fp);
+    if (dmvfs_fclose(out_fp) != 0)
+    {
+        result = -1;
+    }
+    vfs_free(buffer);
+    if (result != 0 && dmvfs_unlink(dst) != 0)
+    {
+        DMOD_LOG_ERROR("Failed to remove partial copy '%s'\n", dst);
+    }
+
+    if (stats != NULL)
+    {
+        stats->bytes = total;
+        stats->elapsed = (g_clock != NULL) ? g_clock() - start : 0;
+        stats->bytes_per_sec = (stats->elapsed != 0) ? (total * 1000000u) / stats->elapsed : 0;
+        stats->renamed = false;
+    }
+
+    if (result != 0)
+    {
+        DMOD_LOG_ERROR("Failed to copy '%s' to '%s'\n", src, dst);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Move a file, also between different mount points
+ *
+ * On the same mount point the file is renamed by the backend. Between mount
+ * points it is copied with dmvfs_copy() and the source is removed after the
+ * copy succeeded - a failed copy removes the partial destination and keeps
+ * the source.
+ *
+ * @param src Path of the source file
+ * @param dst Path of the destination file
+ * @param stats Pointer to store the amount of moved data and the throughput (can be NULL)
+ * @return 0 on success, -1 on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _move, (const char* src, const char* dst, dmvfs_copy_stats_t* stats))
+{
+    if (!is_initialized() || src == NULL || dst == NULL)
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized or invalid arguments to _move\n");
+        return -1;
+    }
+
+    if (is_same_mount(src, dst))
+    {
+        if (stats != NULL)
+        {
+            memset(stats, 0, sizeof(*stats));
+            stats->renamed = true;
+        }
+        return (dmvfs_rename(src, dst) == 0) ? 0 : -1;
+    }
+
+    if (dmvfs_copy(src, dst, stats) != 0)
+    {
+        return -1;
+    }
+    if (dmvfs_unlink(src) != 0)
+    {
+        DMOD_LOG_ERROR("Copied '%s' to '%s' but failed to remove the source\n", src, dst);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Move the position of a file for a read at an explicit offset
+ *
+ * Must be called with the DMVFS mutex locked, which has to stay locked until
+ * the position is restored, so no other user of the handle sees it moved.
+ *
+ * @param file_entry File entry
+ * @param position Position to move to
+ * @return Previous position of the file, or -1 on failure
+ */
+static long swap_position(file_t* file_entry, long position)
+{
+    mount_point_t* mp_entry = file_entry->mount_point;
+    dmod_dmfsi_tell_t tell_func = (dmod_dmfsi_tell_t)Dmod_GetDifFunction(mp_entry->fs_context, dmod_dmfsi_tell_sig);
+    dmod_dmfsi_lseek_t lseek_func = (dmod_dmfsi_lseek_t)Dmod_GetDifFunction(mp_entry->fs_context, dmod_dmfsi_lseek_sig);
+    if(tell_func == NULL || lseek_func == NULL)
+    {
+        return -1;
+    }
+    long previous = tell_func(mp_entry->mount_context, file_entry->fs_file);
+    if(previous < 0 || lseek_func(mp_entry->mount_context, file_entry->fs_file, position, DMFSI_SEEK_SET) < 0)
+    {
+        return -1;
+    }
+    return previous;
+}
+
+/**
+ * @brief Move one chunk of data between two open files
+ *
+ * Must be called with the DMVFS mutex locked and returns with it unlocked.
+ * The read and the write go through the throttling limits and the I/O
+ * scheduler of their mount points like dmvfs_fread() and dmvfs_fwrite(),
+ * one after the other, so a request never holds a dispatch slot while it
+ * waits for another one. The backend hook moves the data in one request
+ * that is charged to the throttling limits of both files. When the write of
+ * a chunk that was already read is not admitted, the position of in_entry
+ * is moved back by the chunk.
+ *
+ * With an explicit offset the position of in_entry is moved to it, the data
+ * is read and the position is restored without unlocking the mutex in
+ * between (also on mount points with DMVFS_CAP_THREAD_SAFE), so other users
+ * of the handle never see the position moved.
+ *
+ * @param out_entry File to write to
+ * @param in_entry File to read from
+ * @param buffer Transfer buffer of DMVFS_COPY_CHUNK_SIZE bytes (NULL if the backend hook is used)
+ * @param offset Position to read from, or NULL to read from the position of in_entry
+ * @param count Number of bytes that are still to be sent
+ * @param moved Pointer to store the number of bytes moved
+ * @return 0 on success, DMVFS_ERR_AGAIN if the throttling limits did not
+ *         admit the chunk and no sleep function is set, -1 on failure
+ */
+static int send_chunk(file_t* out_entry, file_t* in_entry, uint8_t* buffer, const long* offset, size_t count, size_t* moved)
+{
+    *moved = 0;
+    if (flush_write_buffer(in_entry) != 0 || (buffer == NULL && flush_write_buffer(out_entry) != 0))
+    {
+        DMOD_LOG_ERROR("Failed to write buffered data\n");
+        unlock_mutex();
+        return -1;
+    }
+
+    dmod_dmfsi_fread_t fread_func = NULL;
+    dmod_dmfsi_fwrite_t fwrite_func = NULL;
+    if (buffer != NULL)
+    {
+        fread_func = (dmod_dmfsi_fread_t)Dmod_GetDifFunction(in_entry->mount_point->fs_context, dmod_dmfsi_fread_sig);
+        fwrite_func = (dmod_dmfsi_fwrite_t)Dmod_GetDifFunction(out_entry->mount_point->fs_context, dmod_dmfsi_fwrite_sig);
+        if (fread_func == NULL || fwrite_func == NULL)
+        {
+            DMOD_LOG_ERROR("File system does not support fread or fwrite\n");
+            unlock_mutex();
+            return -1;
+        }
+    }
+
+    size_t chunk = (buffer == NULL || count < DMVFS_COPY_CHUNK_SIZE) ? count : DMVFS_COPY_CHUNK_SIZE;
+    int throttled = throttle_io(in_entry, chunk);
+    if (throttled == 0 && buffer == NULL)
+    {
+        // The hook reads and writes - charge the destination as well
+        throttled = throttle_io(out_entry, chunk);
+        if (throttled == 0 && !is_file_valid(in_entry))
+        {
+            unlock_mutex();
+            throttled = -1;
+        }
+    }
+    if (throttled != 0)
+    {
+        DMOD_LOG_ERROR("Request was not admitted by the throttling limits\n");
+        return throttled;
+    }
+
+    io_request_t request;
+    if (!io_sched_begin(in_entry, &request))
+    {
+        DMOD_LOG_ERROR("Request was not dispatched by the I/O scheduler\n");
+        return -1;
+    }
+
+    mount_point_t* mp_entry = in_entry->mount_point;
+    mount_pin_t pin;
+    mount_pin_t* pinned = NULL;
+    long previous = -1;
+    int result = -1;
+    if (offset != NULL)
+    {
+        previous = swap_position(in_entry, *offset);
+    }
+    else
+    {
+        pinned = unlock_for_backend(mp_entry, &pin);
+    }
+    uint64_t start = trace_begin();
+    size_t read_bytes = 0;
+    if (offset != NULL && previous < 0)
+    {
+        DMOD_LOG_ERROR("Cannot seek to offset %ld\n", *offset);
+    }
+    else if (buffer == NULL)
+    {
+        result = mp_entry->ops.sendfile(mp_entry->mount_context, out_entry->fs_file, in_entry->fs_file, chunk, moved);
+        trace_record(DMVFS_TRACE_OP_FWRITE, out_entry->pid, mp_entry, out_entry, (uint32_t)chunk, (int32_t)*moved, result, start);
+    }
+    else
+    {
+        result = backend_read(in_entry, fread_func, buffer, chunk, &read_bytes);
+        trace_record(DMVFS_TRACE_OP_FREAD, in_entry->pid, mp_entry, in_entry, (uint32_t)chunk, (int32_t)read_bytes, result, start);
+    }
+    if (previous >= 0 && swap_position(in_entry, previous) < 0)
+    {
+        DMOD_LOG_ERROR("Cannot restore the position %ld of the source file\n", previous);
+        result = -1;
+    }
+    unlock_after_backend(pinned);
+    io_sched_end(&request);
+    if (buffer == NULL || result != 0 || read_bytes == 0)
+    {
+        return (result == 0) ? 0 : -1;
+    }
+
+    if (!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return -1;
+    }
+    if (!is_file_valid(out_entry))
+    {
+        DMOD_LOG_ERROR("Invalid file entry\n");
+        unlock_mutex();
+        return -1;
+    }
+
+    throttled = throttle_io(out_entry, read_bytes);
+    if (throttled != 0 || !io_sched_begin(out_entry, &request))
+    {
+        DMOD_LOG_ERROR("Write of the chunk was not admitted\n");
+        if (offset == NULL && dmvfs_lseek(in_entry, -(long)read_bytes, DMFSI_SEEK_CUR) < 0)
+        {
+            DMOD_LOG_ERROR("Failed to move back the position of the source file\n");
+            return -1;
+        }
+        return (throttled != 0) ? throttled : -1;
+    }
+    bool coalesced = out_entry->mount_point->coalesce.program_size != 0;
+    result = coalesced ? 0 : flush_write_buffer(out_entry);
+    // The write buffer of the handle is guarded by the mutex, so coalesced writes keep it
+    pinned = coalesced ? NULL : unlock_for_backend(out_entry->mount_point, &pin);
+    start = trace_begin();
+    if (coalesced)
+    {
+        result = coalesce_write(out_entry, fwrite_func, buffer, read_bytes);
+        *moved = (result == 0) ? read_bytes : 0;
+    }
+    else if (result == 0)
+    {
+        result = backend_write(out_entry, fwrite_func, buffer, read_bytes, moved);
+    }
+    trace_record(DMVFS_TRACE_OP_FWRITE, out_entry->pid, out_entry->mount_point, out_entry, (uint32_t)read_bytes, (int32_t)*moved, result, start);
+    unlock_after_backend(pinned);
+    io_sched_end(&request);
+    return (result == 0 && *moved == read_bytes) ? 0 : -1;
+}
+
+/**
+ * @brief Transfer data between two open files
+ *
+ * The data goes through an internal buffer of DMVFS_COPY_CHUNK_SIZE bytes.
+ * Every chunk is read and written under the throttling limits and the I/O
+ * scheduler like dmvfs_fread() and dmvfs_fwrite(). When both files are on
+ * the same mount point and the backend provides the sendfile hook in its
+ * mount operations, the backend moves the data itself.
+ *
+ * @param out_fp File to write to
+ * @param in_fp File to read from
+ * @param offset Position to read from, updated after the transfer - the position of in_fp
+ *               is then not changed (NULL to read from and advance the position of in_fp)
+ * @param count Number of bytes to transfer
+ * @param sent Pointer to store the number of bytes transferred (can be NULL)
+ * @return 0 on success (also when the end of in_fp was reached), DMVFS_ERR_AGAIN
+ *         if a chunk was not admitted by the throttling limits and no sleep
+ *         function is set, -1 on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _sendfile, (void* out_fp, void* in_fp, long* offset, size_t count, size_t* sent))
+{
+    if (!is_initialized() || out_fp == NULL || in_fp == NULL)
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized or invalid arguments to _sendfile\n");
+        return -1;
+    }
+
+    file_t* out_entry = (file_t*)out_fp;
+    file_t* in_entry = (file_t*)in_fp;
+
+    int result = 0;
+    size_t total = 0;
+    uint8_t* buffer = NULL;
+    while (result == 0 && total < count)
+    {
+        if (!lock_mutex())
+        {
+            DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+            result = -1;
+            break;
+        }
+
+        if (!is_file_valid(out_entry) || !is_file_valid(in_entry) || out_entry->is_dir || in_entry->is_dir)
+        {
+            DMOD_LOG_ERROR("Invalid file entry\n");
+            unlock_mutex();
+            result = -1;
+            break;
+        }
+
+        bool direct = (in_entry->mount_point == out_entry->mount_point && in_entry->mount_point->ops.sendfile != NULL);
+        if (!direct && buffer == NULL)
+        {
+            buffer = (uint8_t*)vfs_malloc(DMVFS_COPY_CHUNK_SIZE);
+            if (buffer == NULL)
+            {
+                DMOD_LOG_ERROR("Failed to allocate transfer buffer\n");
+                unlock_mutex();
+                result = -1;
+                break;
+            }
+        }
+
+        size_t moved = 0;
+        long position = (offset != NULL) ? *offset + (long)total : -1;
+        result = send_chunk(out_entry, in_entry, direct ? NULL : buffer, (offset != NULL) ? &position : NULL, count - total, &moved);
+
+        total += moved;
+        if (moved == 0)
+        {
+            break;
+        }
+    }
+    vfs_free(buffer);
+
+    if (offset != NULL)
+    {
+        *offset += (long)total;
+    }
+    if (sent != NULL)
+    {
+        *sent = total;
+    }
+
+    if (result != 0)
+    {
+        DMOD_LOG_ERROR("Failed to send data between files\n");
+        return (result == DMVFS_ERR_AGAIN) ? result : -1;
+    }
+    return 0;
+}
+
+#if !defined(DMVFS_CRC32C_SSE42) && !defined(DMVFS_CRC32C_ARMV8)
+/**
+ * @brief Build the lookup tables of the slice-by-8 CRC32C
+ */
+static void crc32c_init_tables(void)
+{
+    for(uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t crc = i;
+        for(int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (DMVFS_CRC32C_POLY & (0u - (crc & 1u)));
+        }
+        g_crc32c_tables[0][i] = crc;
+    }
+    for(uint32_t i = 0; i < 256; i++)
+    {
+        for(int slice = 1; slice < 8; slice++)
+        {
+            uint32_t previous = g_crc32c_tables[slice - 1][i];
+            g_crc32c_tables[slice][i] = (previous >> 8) ^ g_crc32c_tables[0][previous & 0xFFu];
+        }
+    }
+    __atomic_store_n(&g_crc32c_ready, true, __ATOMIC_RELEASE);
+}
+#endif
+
+/**
+ * @brief Update a CRC32C (Castagnoli) checksum
+ *
+ * Uses the CRC32 instructions of SSE4.2 or ARMv8 when the build enables
+ * them, and a slice-by-8 table otherwise.
+ *
+ * @param crc Current value of the checksum (not inverted)
+ * @param data Data to add
+ * @param size Number of bytes
+ * @return New value of the checksum
+ */
+static uint32_t crc32c_update(uint32_t crc, const uint8_t* data, size_t size)
+{
+#if defined(DMVFS_CRC32C_SSE42)
+    for(; size >= 8; size -= 8, data += 8)
+    {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        crc = (uint32_t)_mm_crc32_u64(crc, word);
+    }
+    for(; size > 0; size--)
+    {
+        crc = _mm_crc32_u8(crc, *data++);
+    }
+#elif defined(DMVFS_CRC32C_ARMV8)
+    for(; size >= 8; size -= 8, data += 8)
+    {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        crc = __crc32cd(crc, word);
+    }
+    for(; size > 0; size--)
+    {
+        crc = __crc32cb(crc, *data++);
+    }
+#else
+    if(!__atomic_load_n(&g_crc32c_ready, __ATOMIC_ACQUIRE))
+    {
+        crc32c_init_tables();
+    }
+    for(; size >= 8; size -= 8, data += 8)
+    {
+        uint32_t low = crc ^ ((uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24));
+        uint32_t high = (uint32_t)data[4] | ((uint32_t)data[5] << 8) | ((uint32_t)data[6] << 16) | ((uint32_t)data[7] << 24);
+        crc = g_crc32c_tables[7][low & 0xFFu] ^ g_crc32c_tables[6][(low >> 8) & 0xFFu] ^
+              g_crc32c_tables[5][(low >> 16) & 0xFFu] ^ g_crc32c_tables[4][low >> 24] ^
+              g_crc32c_tables[3][high & 0xFFu] ^ g_crc32c_tables[2][(high >> 8) & 0xFFu] ^
+              g_crc32c_tables[1][(high >> 16) & 0xFFu] ^ g_crc32c_tables[0][high >> 24];
+    }
+    for(; size > 0; size--)
+    {
+        crc = g_crc32c_tables[0][(crc ^ *data++) & 0xFFu] ^ (crc >> 8);
+    }
+#endif
+    return crc;
+}
+
+static const uint32_t g_sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define SHA256_ROTR(x, n)   (((x) >> (n)) | ((x) << (32 - (n))))
+
+/**
+ * @brief Initialize a SHA-256 state
+ * @param sha State
+ */
+static void sha256_init(sha256_t* sha)
+{
+    static const uint32_t initial[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(sha->state, initial, sizeof(initial));
+    sha->length = 0;
+    sha->used = 0;
+}
+
+/**
+ * @brief Process one 64 byte block of SHA-256
+ * @param sha State
+ * @param block Block of data
+ */
+static void sha256_block(sha256_t* sha, const uint8_t* block)
+{
+    uint32_t w[64];
+    for(int i = 0; i < 16; i++)
+    {
+        w[i] = ((uint32_t)block[i * 4] << 24) | ((uint32_t)block[i * 4 + 1] << 16) |
+               ((uint32_t)block[i * 4 + 2] << 8) | (uint32_t)block[i * 4 + 3];
+    }
+    for(int i = 16; i < 64; i++)
+    {
+        uint32_t s0 = SHA256_ROTR(w[i - 15], 7) ^ SHA256_ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = SHA256_ROTR(w[i - 2], 17) ^ SHA256_ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = sha->state[0], b = sha->state[1], c = sha->state[2], d = sha->state[3];
+    uint32_t e = sha->state[4], f = sha->state[5], g = sha->state[6], h = sha->state[7];
+    for(int i = 0; i < 64; i++)
+    {
+        uint32_t s1 = SHA256_ROTR(e, 6) ^ SHA256_ROTR(e, 11) ^ SHA256_ROTR(e, 25);
+        uint32_t t1 = h + s1 + ((e & f) ^ (~e & g)) + g_sha256_k[i] + w[i];
+        uint32_t s0 = SHA256_ROTR(a, 2) ^ SHA256_ROTR(a, 13) ^ SHA256_ROTR(a, 22);
+        uint32_t t2 = s0 + ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    sha->state[0] += a; sha->state[1] += b; sha->state[2] += c; sha->state[3] += d;
+    sha->state[4] += e; sha->state[5] += f; sha->state[6] += g; sha->state[7] += h;
+}
+
+/**
+ * @brief Add data to a SHA-256 state
+ * @param sha State
+ * @param data Data to add
+ * @param size Number of bytes
+ */
+static void sha256_update(sha256_t* sha, const uint8_t* data, size_t size)
+{
+    sha->length += size;
+    if(sha->used != 0)
+    {
+        size_t take = (size < 64 - sha->used) ? size : 64 - sha->used;
+        memcpy(sha->buffer + sha->used, data, take);
+        sha->used += take;
+        data += take;
+        size -= take;
+        if(sha->used < 64)
+        {
+            return;
+        }
+        sha256_block(sha, sha->buffer);
+        sha->used = 0;
+    }
+    for(; size >= 64; size -= 64, data += 64)
+    {
+        sha256_block(sha, data);
+    }
+    memcpy(sha->buffer, data, size);
+    sha->used = size;
+}
+
+/**
+ * @brief Finish a SHA-256 digest
+ * @param sha State
+ * @param digest Buffer for the 32 byte digest
+ */
+static void sha256_final(sha256_t* sha, uint8_t* digest)
+{
+    uint64_t bits = sha->length * 8;
+    uint8_t padding[72] = { 0x80 };
+    size_t pad = (sha->used < 56) ? 56 - sha->used : 120 - sha->used;
+    for(int i = 0; i < 8; i++)
+    {
+        padding[pad + i] = (uint8_t)(bits >> (56 - i * 8));
+    }
+    sha256_update(sha, padding, pad + 8);
+    for(int i = 0; i < 8; i++)
+    {
+        digest[i * 4] = (uint8_t)(sha->state[i] >> 24);
+        digest[i * 4 + 1] = (uint8_t)(sha->state[i] >> 16);
+        digest[i * 4 + 2] = (uint8_t)(sha->state[i] >> 8);
+        digest[i * 4 + 3] = (uint8_t)sha->state[i];
+    }
+}
+
+/**
+ * @brief Compute a checksum or digest of a file
+ *
+ * The file is read with dmvfs_fread() in DMVFS_COPY_CHUNK_SIZE chunks into a
+ * buffer allocated by DMVFS, and each chunk is hashed right after it was read,
+ * while it is still in the CPU cache, so the file never has to be held in
+ * memory as a whole. The handle belongs to the calling process (see
+ * dmvfs_set_getpid()). CRC32C uses the CRC32 instructions of the CPU when
+ * they are enabled in the build.
+ *
+ * @param path Path to the file
+ * @param algo DMVFS_HASH_CRC32C (4 bytes, big-endian) or DMVFS_HASH_SHA256 (32 bytes)
+ * @param out Buffer for the result
+ * @param out_size Size of the buffer
+ * @return Length of the result on success, -1 on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _hash_file, (const char* path, int algo, uint8_t* out, size_t out_size))
+{
+    size_t digest_size = (algo == DMVFS_HASH_CRC32C) ? 4 : (algo == DMVFS_HASH_SHA256) ? 32 : 0;
+    if (!is_initialized() || path == NULL || out == NULL || digest_size == 0 || out_size < digest_size)
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized or invalid arguments to _hash_file\n");
+        return -1;
+    }
+
+    uint8_t* buffer = (uint8_t*)vfs_malloc(DMVFS_COPY_CHUNK_SIZE + sizeof(sha256_t));
+    if (buffer == NULL)
+    {
+        DMOD_LOG_ERROR("Failed to allocate hash buffer\n");
+        return -1;
+    }
+    sha256_t* sha = (sha256_t*)(buffer + DMVFS_COPY_CHUNK_SIZE);
+
+    void* fp = NULL;
+    if (dmvfs_fopen(&fp, path, DMFSI_O_RDONLY, 0, current_pid()) != 0)
+    {
+        vfs_free(buffer);
+        return -1;
+    }
+
+    uint32_t crc = 0xFFFFFFFFu;
+    sha256_init(sha);
+    int result = 0;
+    for (;;)
+    {
+        size_t read_bytes = 0;
+        result = dmvfs_fread(fp, buffer, DMVFS_COPY_CHUNK_SIZE, &read_bytes);
+        if (result != 0 || read_bytes == 0)
+        {
+            break;
+        }
+        if (algo == DMVFS_HASH_CRC32C)
+        {
+            crc = crc32c_update(crc, buffer, read_bytes);
+        }
+        else
+        {
+            sha256_update(sha, buffer, read_bytes);
+        }
+    }
+    dmvfs_fclose(fp);
+
+    if (result == 0 && algo == DMVFS_HASH_CRC32C)
+    {
+        crc ^= 0xFFFFFFFFu;
+        out[0] = (uint8_t)(crc >> 24);
+        out[1] = (uint8_t)(crc >> 16);
+        out[2] = (uint8_t)(crc >> 8);
+        out[3] = (uint8_t)crc;
+    }
+    else if (result == 0)
+    {
+        sha256_final(sha, out);
+    }
+    vfs_free(buffer);
+
+    if (result != 0)
+    {
+        DMOD_LOG_ERROR("Failed to read file '%s'\n", path);
+        return -1;
+    }
+    return (int)digest_size;
+}
+
+/**
+ * @brief Read a character from a DMVFS file
+ *
+ * @param fp Pointer to the file handle
+ * @return Character read, or -1 on error
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _getc, (void* fp))
 {
-    if (!is_initialized())
+    if (!is_initialized() || fp == NULL)
+        return -1;
+    
+    if(!lock_mutex())
     {
-        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
         return -1;
     }
-
-    if (fp == NULL || path == NULL)
+    
+    file_t* file_entry = (file_t*)fp;
+    if (!is_file_valid(file_entry))
     {
-        DMOD_LOG_ERROR("Invalid arguments to _fopen\n");
+        unlock_mutex();
         return -1;
     }
-
-    if (!lock_mutex())
+    if (flush_write_buffer(file_entry) != 0)
     {
-        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        unlock_mutex();
         return -1;
     }
-
-    const char* abs_path = to_absolute_path(path);
-    if (abs_path == NULL)
+    dmod_dmfsi_getc_t getc_func = (dmod_dmfsi_getc_t)Dmod_GetDifFunction(
+        file_entry->mount_point->fs_context, dmod_dmfsi_getc_sig);
+    if (!getc_func)
     {
-        DMOD_LOG_ERROR("Failed to resolve absolute path for '%s'\n", path);
         unlock_mutex();
         return -1;
     }
+    mount_pin_t pin;
+    mount_pin_t* pinned = unlock_for_backend(file_entry->mount_point, &pin);
+    uint64_t start = trace_begin();
+    int result = getc_func(file_entry->mount_point->mount_context, file_entry->fs_file);
+    trace_record(DMVFS_TRACE_OP_GETC, file_entry->pid, file_entry->mount_point, file_entry, 1, 0, result, start);
+    unlock_after_backend(pinned);
+    return result;
+}
 
-    mount_point_t* mp_entry = get_mount_point_for_path(abs_path);
-    if (mp_entry == NULL)
+/**
+ * @brief Write a character to a DMVFS file
+ *
+ * @param fp Pointer to the file handle
+ * @param c Character to write
+ * @return Character written, or -1 on error
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _putc, (void* fp, int c))
+{
+    if (!is_initialized() || fp == NULL)
+        return -1;
+    
+    if(!lock_mutex())
     {
-        DMOD_LOG_ERROR("No mount point found for path '%s'\n", abs_path);
-        Dmod_Free((void*)abs_path);
-        unlock_mutex();
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
         return -1;
     }
-
-    dmod_dmfsi_fopen_t fopen_func = (dmod_dmfsi_fopen_t)Dmod_GetDifFunction(mp_entry->fs_context, dmod_dmfsi_fopen_sig);
-    if (fopen_func == NULL)
+    
+    file_t* file_entry = (file_t*)fp;
+    if (!is_file_valid(file_entry))
     {
-        DMOD_LOG_ERROR("File system does not support fopen for path '%s'\n", abs_path);
-        Dmod_Free((void*)abs_path);
         unlock_mutex();
         return -1;
     }
-
-    void* fs_file = NULL;
-    int result = fopen_func(mp_entry->mount_context, &fs_file, abs_path + strlen(mp_entry->mount_point), mode, attr);
-    Dmod_Free((void*)abs_path);
-
-    if (fs_file == NULL || result != 0)
+    if (flush_write_buffer(file_entry) != 0)
     {
-        DMOD_LOG_ERROR("Failed to open file '%s'\n", path);
         unlock_mutex();
         return -1;
     }
-
-    file_t* free_entry = find_free_file_entry();
-    if (free_entry == NULL)
+    dmod_dmfsi_putc_t putc_func = (dmod_dmfsi_putc_t)Dmod_GetDifFunction(
+        file_entry->mount_point->fs_context, dmod_dmfsi_putc_sig);
+    if (!putc_func)
     {
-        DMOD_LOG_ERROR("No free file entries available\n");
         unlock_mutex();
         return -1;
     }
-
-    free_entry->mount_point = mp_entry;
-    free_entry->fs_file = fs_file;
-    free_entry->pid = pid;
-    *fp = free_entry;
-
-    unlock_mutex();
-    DMOD_LOG_INFO("File '%s' opened successfully\n", path);
-    return 0;
+    mount_pin_t pin;
+    mount_pin_t* pinned = unlock_for_backend(file_entry->mount_point, &pin);
+    uint64_t start = trace_begin();
+    int result = putc_func(file_entry->mount_point->mount_context, file_entry->fs_file, c);
+    trace_record(DMVFS_TRACE_OP_PUTC, file_entry->pid, file_entry->mount_point, file_entry, 1, c, result, start);
+    unlock_after_backend(pinned);
+    return result;
 }
 
 /**
- * @brief Close an open file in the DMVFS
- * 
- * This function closes a file that was previously opened in the DMVFS.
- * It invokes the file system's close function and removes the file
- * from the DMVFS open file table.
- * 
- * @param fp Pointer to the file handle to close
- * 
+ * @brief Change the permissions of a file in DMVFS
+ *
+ * This function changes the permissions of a file at the specified path.
+ * It resolves the mount point for the file and invokes the file system's chmod function.
+ *
+ * @param path Path to the file
+ * @param mode New permissions mode
  * @return 0 on success, -1 on failure
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _fclose, (void* fp))
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _chmod, (const char* path, int mode))
 {
-    if (!is_initialized())
+    if (!is_initialized() || path == NULL)
     {
-        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        DMOD_LOG_ERROR("DMVFS is not initialized or path is NULL\n");
         return -1;
     }
 
-    if (fp == NULL)
+    resolved_path_t resolved;
+    if (!acquire_path(path, &resolved))
     {
-        DMOD_LOG_ERROR("Invalid file pointer\n");
+        DMOD_LOG_ERROR("No mount point found for path '%s'\n", path);
         return -1;
     }
+    mount_point_t* mp_entry = resolved.mount_point;
 
-    file_t* file_entry = (file_t*)fp;
-
-    if (!lock_mutex())
-    {
-        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
-        return -1;
-    }
+    dmod_dmfsi_chmod_t chmod_func = (dmod_dmfsi_chmod_t)Dmod_GetDifFunction(
+        mp_entry->fs_context, dmod_dmfsi_chmod_sig);
 
-    if (file_entry->mount_point == NULL || file_entry->fs_file == NULL)
+    if (!chmod_func)
     {
-        DMOD_LOG_ERROR("Invalid file entry\n");
-        unlock_mutex();
+        DMOD_LOG_ERROR("File system does not support chmod for path '%s'\n", path);
+        release_path(&resolved);
         return -1;
     }
 
-    dmod_dmfsi_fclose_t fclose_func = (dmod_dmfsi_fclose_t)Dmod_GetDifFunction(
-        file_entry->mount_point->fs_context, dmod_dmfsi_fclose_sig);
-
-    if (fclose_func == NULL)
-    {
-        DMOD_LOG_ERROR("File system does not support fclose\n");
-        file_entry->mount_point = NULL;
-        file_entry->fs_file = NULL;
-        unlock_mutex();
-        return -1;
-    }
+    uint64_t start = trace_begin();
+    int result = chmod_func(mp_entry->mount_context, resolved.fs_path, mode);
+    trace_record(DMVFS_TRACE_OP_CHMOD, -1, mp_entry, NULL, 0, mode, result, start);
+    release_path(&resolved);
 
-    if (!fclose_func(file_entry->mount_point->mount_context, file_entry->fs_file))
+    if (result != 0)
     {
-        DMOD_LOG_ERROR("Failed to close file\n");
-        file_entry->mount_point = NULL;
-        file_entry->fs_file = NULL;
-        unlock_mutex();
+        DMOD_LOG_ERROR("Failed to change permissions for '%s'\n", path);
         return -1;
     }
 
-    file_entry->mount_point = NULL;
-    file_entry->fs_file = NULL;
-
-    unlock_mutex();
-    DMOD_LOG_INFO("File closed successfully\n");
+    DMOD_LOG_INFO("Permissions for '%s' changed successfully\n", path);
     return 0;
 }
-
 /**
- * @brief Close all open files for a given process ID
- * 
- * This function iterates through the open file table and closes all files
- * associated with the specified process ID. It invokes the file system's
- * close function for each file and removes the file from the DMVFS open file table.
- * 
- * @param pid Process ID whose files should be closed
- * 
+ * @brief Update the access and modification times of a file in DMVFS
+ *
+ * This function updates the access and modification times of a file
+ * at the specified path. It resolves the mount point for the file
+ * and invokes the file system's utime function.
+ *
+ * @param path Path to the file
+ * @param atime New access time (UNIX timestamp)
+ * @param mtime New modification time (UNIX timestamp)
  * @return 0 on success, -1 on failure
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _fclose_process, (int pid))
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _utime, (const char* path, uint32_t atime, uint32_t mtime))
 {
-    if (!is_initialized())
+    if (!is_initialized() || path == NULL)
     {
-        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        DMOD_LOG_ERROR("DMVFS is not initialized or path is NULL\n");
         return -1;
     }
 
-    if (!lock_mutex())
+    resolved_path_t resolved;
+    if (!acquire_path(path, &resolved))
     {
-        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        DMOD_LOG_ERROR("No mount point found for path '%s'\n", path);
         return -1;
     }
+    mount_point_t* mp_entry = resolved.mount_point;
 
-    bool success = true;
+    dmod_dmfsi_utime_t utime_func = (dmod_dmfsi_utime_t)Dmod_GetDifFunction(
+        mp_entry->fs_context, dmod_dmfsi_utime_sig);
 
-    for (int i = 0; i < g_max_open_files; i++)
+    if (!utime_func)
     {
-        if (g_open_files[i].pid == pid && g_open_files[i].mount_point != NULL)
-        {
-            dmod_dmfsi_fclose_t fclose_func = (dmod_dmfsi_fclose_t)Dmod_GetDifFunction(
-                g_open_files[i].mount_point->fs_context, dmod_dmfsi_fclose_sig);
-
-            if (fclose_func != NULL)
-            {
-                if (!fclose_func(g_open_files[i].mount_point->mount_context, g_open_files[i].fs_file))
-                {
-                    DMOD_LOG_ERROR("Failed to close file for process ID %d\n", pid);
-                    success = false;
-                }
-            }
-
-            g_open_files[i].mount_point = NULL;
-            g_open_files[i].fs_file = NULL;
-            g_open_files[i].pid = 0;
-        }
+        DMOD_LOG_ERROR("File system does not support utime for path '%s'\n", path);
+        release_path(&resolved);
+        return -1;
     }
 
-    unlock_mutex();
+    uint64_t start = trace_begin();
+    int result = utime_func(mp_entry->mount_context, resolved.fs_path, atime, mtime);
+    trace_record(DMVFS_TRACE_OP_UTIME, -1, mp_entry, NULL, 0, 0, result, start);
+    release_path(&resolved);
 
-    if (success)
-    {
-        DMOD_LOG_INFO("All files for process ID %d closed successfully\n", pid);
-        return 0;
-    }
-    else
+    if (result != 0)
     {
-        DMOD_LOG_ERROR("Failed to close some files for process ID %d\n", pid);
+        DMOD_LOG_ERROR("Failed to update times for '%s'\n", path);
         return -1;
     }
+
+    DMOD_LOG_INFO("Times for '%s' updated successfully\n", path);
+    return 0;
 }
 
 /**
- * @brief Read data from an open file in the DMVFS
- * 
- * This function reads data from a file that was previously opened in the DMVFS.
- * It invokes the file system's read function and updates the read_bytes parameter
- * with the number of bytes actually read.
- * 
- * @param fp Pointer to the file handle
- * @param buf Buffer to store the read data
- * @param size Number of bytes to read
- * @param read_bytes Pointer to store the number of bytes actually read
- * 
+ * @brief Remove a file in DMVFS
+ *
+ * This function removes a file at the specified path. It resolves the
+ * mount point for the file and invokes the file system's unlink function.
+ *
+ * @param path Path to the file
  * @return 0 on success, -1 on failure
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _fread, (void* fp, void* buf, size_t size, size_t* read_bytes))
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _unlink, (const char* path))
 {
-    if (!is_initialized())
+    if (!is_initialized() || path == NULL)
     {
-        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        DMOD_LOG_ERROR("DMVFS is not initialized or path is NULL\n");
         return -1;
     }
 
-    if (fp == NULL || buf == NULL || size == 0)
+    resolved_path_t resolved;
+    if (!acquire_path(path, &resolved))
     {
-        DMOD_LOG_ERROR("Invalid arguments to _fread\n");
+        DMOD_LOG_ERROR("No mount point found for path '%s'\n", path);
         return -1;
     }
+    mount_point_t* mp_entry = resolved.mount_point;
 
-    if(!lock_mutex())
+    dmod_dmfsi_unlink_t unlink_func = (dmod_dmfsi_unlink_t)Dmod_GetDifFunction(
+        mp_entry->fs_context, dmod_dmfsi_unlink_sig);
+
+    if (!unlink_func)
     {
-        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        DMOD_LOG_ERROR("File system does not support unlink for path '%s'\n", path);
+        release_path(&resolved);
         return -1;
     }
 
-    file_t* file_entry = (file_t*)fp;
+    handle_cache_invalidate(mp_entry, resolved.fs_path);
+    uint64_t start = trace_begin();
+    int result = unlink_func(mp_entry->mount_context, resolved.fs_path);
+    trace_record(DMVFS_TRACE_OP_UNLINK, -1, mp_entry, NULL, 0, 0, result, start);
+    release_path(&resolved);
 
-    if (file_entry->mount_point == NULL || file_entry->fs_file == NULL)
+    if (result != 0)
     {
-        DMOD_LOG_ERROR("Invalid file entry\n");
-        unlock_mutex();
+        DMOD_LOG_ERROR("Failed to remove file '%s'\n", path);
         return -1;
     }
 
-    dmod_dmfsi_fread_t fread_func = (dmod_dmfsi_fread_t)Dmod_GetDifFunction(
-        file_entry->mount_point->fs_context, dmod_dmfsi_fread_sig);
+    DMOD_LOG_INFO("File '%s' removed successfully\n", path);
+    return 0;
+}
 
-    if (fread_func == NULL)
+/**
+ * @brief Create a directory in DMVFS
+ *
+ * This function creates a directory at the specified path with the given mode.
+ * It resolves the mount point for the directory and invokes the file system's mkdir function.
+ *
+ * @param path Path to the directory
+ * @param mode Permissions mode for the new directory
+ * @return 0 on success, -1 on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _mkdir, (const char* path, int mode))
+{
+    if (!is_initialized() || path == NULL)
     {
-        DMOD_LOG_ERROR("File system does not support fread\n");
-        unlock_mutex();
+        DMOD_LOG_ERROR("DMVFS is not initialized or path is NULL\n");
         return -1;
     }
 
-    size_t bytes_read = 0;
-    int result = fread_func(file_entry->mount_point->mount_context, file_entry->fs_file, buf, size, &bytes_read);
+    resolved_path_t resolved;
+    if (!acquire_path(path, &resolved))
+    {
+        DMOD_LOG_ERROR("No mount point found for path '%s'\n", path);
+        return -1;
+    }
+    mount_point_t* mp_entry = resolved.mount_point;
 
-    if (read_bytes)
+    dmod_dmfsi_mkdir_t mkdir_func = (dmod_dmfsi_mkdir_t)Dmod_GetDifFunction(
+        mp_entry->fs_context, dmod_dmfsi_mkdir_sig);
+
+    if (!mkdir_func)
     {
-        *read_bytes = bytes_read;
+        DMOD_LOG_ERROR("File system does not support mkdir for path '%s'\n", path);
+        release_path(&resolved);
+        return -1;
     }
-    unlock_mutex();
+
+    uint64_t start = trace_begin();
+    int result = mkdir_func(mp_entry->mount_context, resolved.fs_path, mode);
+    trace_record(DMVFS_TRACE_OP_MKDIR, -1, mp_entry, NULL, 0, mode, result, start);
+    release_path(&resolved);
 
     if (result != 0)
     {
-        DMOD_LOG_ERROR("Failed to read from file\n");
+        DMOD_LOG_ERROR("Failed to create directory '%s'\n", path);
         return -1;
     }
 
-    DMOD_LOG_VERBOSE("Read %zu bytes from file\n", bytes_read);
+    DMOD_LOG_INFO("Directory '%s' created successfully\n", path);
     return 0;
 }
 
 /**
- * @brief Write data to an open file in the DMVFS
- *
- * This function writes data to a file that was previously opened in the DMVFS.
- * It invokes the file system's write function and updates the written_bytes parameter
- * with the number of bytes actually written.
- *
- * @param fp Pointer to the file handle
- * @param buf Buffer containing the data to write
- * @param size Number of bytes to write
- * @param written_bytes Pointer to store the number of bytes actually written
+ * @brief Create a directory relative to an open directory
  *
+ * @param dp Directory handle (from dmvfs_opendir())
+ * @param path Path relative to the directory (absolute paths ignore the directory)
+ * @param mode Directory permissions
  * @return 0 on success, -1 on failure
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _fwrite, (void* fp, const void* buf, size_t size, size_t* written_bytes))
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _mkdirat, (void* dp, const char* path, int mode))
 {
-    if (!is_initialized())
+    if (!is_initialized() || dp == NULL || path == NULL)
     {
-        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        DMOD_LOG_ERROR("DMVFS is not initialized or invalid arguments to _mkdirat\n");
         return -1;
     }
 
-    if (fp == NULL || buf == NULL || size == 0)
+    if (!lock_mutex())
     {
-        DMOD_LOG_ERROR("Invalid arguments to _fwrite\n");
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
         return -1;
     }
 
-    if(!lock_mutex())
+    file_t* dir_entry = (file_t*)dp;
+    cwd_t base;
+    resolved_path_t resolved;
+    if (!get_dir_base(dir_entry, &base) || !resolve_path(path, &base, &resolved))
     {
-        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        DMOD_LOG_ERROR("Cannot resolve path '%s' in directory\n", path);
+        unlock_mutex();
         return -1;
     }
+    mount_point_t* mp_entry = resolved.mount_point;
 
-    file_t* file_entry = (file_t*)fp;
+    dmvfs_mkdirat_t mkdirat_func = (path[0] != '/') ? mp_entry->ops.mkdirat : NULL;
+    dmod_dmfsi_mkdir_t mkdir_func = (dmod_dmfsi_mkdir_t)Dmod_GetDifFunction(
+        mp_entry->fs_context, dmod_dmfsi_mkdir_sig);
 
-    if (file_entry->mount_point == NULL || file_entry->fs_file == NULL)
+    if (!mkdir_func && !mkdirat_func)
     {
-        DMOD_LOG_ERROR("Invalid file entry\n");
+        DMOD_LOG_ERROR("File system does not support mkdir for path '%s'\n", path);
+        release_path(&resolved);
         unlock_mutex();
         return -1;
     }
 
-    dmod_dmfsi_fwrite_t fwrite_func = (dmod_dmfsi_fwrite_t)Dmod_GetDifFunction(
-        file_entry->mount_point->fs_context, dmod_dmfsi_fwrite_sig);
+    mount_pin_t pin;
+    mount_pin_t* pinned = unlock_for_backend(mp_entry, &pin);
+    uint64_t start = trace_begin();
+    int result = mkdirat_func ? mkdirat_func(mp_entry->mount_context, dir_entry->fs_file, path, mode)
+                              : mkdir_func(mp_entry->mount_context, resolved.fs_path, mode);
+    trace_record(DMVFS_TRACE_OP_MKDIR, -1, mp_entry, NULL, 0, mode, result, start);
+    release_path(&resolved);
+    unlock_after_backend(pinned);
 
-    if (fwrite_func == NULL)
+    if (result != 0)
     {
-        DMOD_LOG_ERROR("File system does not support fwrite\n");
-        unlock_mutex();
+        DMOD_LOG_ERROR("Failed to create directory '%s'\n", path);
         return -1;
     }
 
-    size_t bytes_written = 0;
-    int result = fwrite_func(file_entry->mount_point->mount_context, file_entry->fs_file, buf, size, &bytes_written);
+    DMOD_LOG_INFO("Directory '%s' created successfully\n", path);
+    return 0;
+}
+/**
+ * @brief Remove a directory in DMVFS
+ *
+ * This function removes a directory at the specified path. It resolves the
+ * mount point for the directory and invokes the file system's rmdir function.
+ *
+ * @param path Path to the directory
+ * @return 0 on success, -1 on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _rmdir, (const char* path))
+{
+    if (!is_initialized() || path == NULL)
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized or path is NULL\n");
+        return -1;
+    }
 
-    if (written_bytes)
+    resolved_path_t resolved;
+    if (!acquire_path(path, &resolved))
     {
-        *written_bytes = bytes_written;
+        DMOD_LOG_ERROR("No mount point found for path '%s'\n", path);
+        return -1;
     }
+    mount_point_t* mp_entry = resolved.mount_point;
 
-    unlock_mutex();
+    dmod_dmfsi_unlink_t rmdir_func = (dmod_dmfsi_unlink_t)Dmod_GetDifFunction(
+        mp_entry->fs_context, dmod_dmfsi_unlink_sig);
+
+    if (!rmdir_func)
+    {
+        DMOD_LOG_ERROR("File system does not support rmdir for path '%s'\n", path);
+        release_path(&resolved);
+        return -1;
+    }
+
+    handle_cache_invalidate(mp_entry, resolved.fs_path);
+    uint64_t start = trace_begin();
+    int result = rmdir_func(mp_entry->mount_context, resolved.fs_path);
+    trace_record(DMVFS_TRACE_OP_RMDIR, -1, mp_entry, NULL, 0, 0, result, start);
+    release_path(&resolved);
 
     if (result != 0)
     {
-        DMOD_LOG_ERROR("Failed to write to file\n");
+        DMOD_LOG_ERROR("Failed to remove directory '%s'\n", path);
         return -1;
     }
 
-    DMOD_LOG_VERBOSE("Wrote %zu bytes to file\n", bytes_written);
+    DMOD_LOG_INFO("Directory '%s' removed successfully\n", path);
     return 0;
 }
 
 /**
- * @brief Seek to a position in an open file in the DMVFS
- *
- * This function sets the file position for a file previously opened in the DMVFS.
- * It invokes the file system's lseek function.
+ * @brief Change a working directory
  *
- * @param fp Pointer to the file handle
- * @param offset Offset to seek to
- * @param whence Seek mode (SEEK_SET, SEEK_CUR, SEEK_END)
+ * The function must be called with the DMVFS mutex locked. A relative path
+ * is resolved against the working directory that is currently used by the
+ * process (or against the global one).
  *
- * @return New offset on success, -1 on failure
+ * @param path Path to the new working directory
+ * @param pid Process ID
+ * @param process true to change the working directory of the process, false to change the global one
+ * @return 0 on success, -1 on failure
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _lseek, (void* fp, long offset, int whence))
+static int change_directory(const char* path, int pid, bool process)
 {
-    if (!is_initialized())
+    cwd_t* cwd = process ? get_cwd(pid) : &g_cwd;
+    const char* abs_path = to_absolute_path(path, cwd);
+    if (!abs_path)
     {
-        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        DMOD_LOG_ERROR("Failed to resolve absolute path for '%s'\n", path);
         return -1;
     }
-    
-    if (fp == NULL)
+
+    resolved_path_t resolved;
+    if (!resolve_path(abs_path, cwd, &resolved))
     {
-        DMOD_LOG_ERROR("Invalid file pointer\n");
+        DMOD_LOG_ERROR("No mount point found for path '%s'\n", abs_path);
+        vfs_free((void*)abs_path);
         return -1;
     }
+    mount_point_t* mp_entry = resolved.mount_point;
 
-    if(!lock_mutex())
+    dmod_dmfsi_direxists_t direxists_func = (dmod_dmfsi_direxists_t)Dmod_GetDifFunction(
+        mp_entry->fs_context, dmod_dmfsi_direxists_sig);
+
+    uint64_t start = trace_begin();
+    int exists = (direxists_func != NULL) ? direxists_func(mp_entry->mount_context, resolved.fs_path) : 0;
+    trace_record(DMVFS_TRACE_OP_CHDIR, process ? pid : -1, mp_entry, NULL, 0, 0, exists, start);
+    release_path(&resolved);
+
+    if (!exists)
     {
-        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        DMOD_LOG_ERROR("Directory '%s' does not exist\n", abs_path);
+        vfs_free((void*)abs_path);
         return -1;
     }
 
-    file_t* file_entry = (file_t*)fp;
-    if (file_entry->mount_point == NULL || file_entry->fs_file == NULL)
+    if (process && cwd == &g_cwd)
     {
-        DMOD_LOG_ERROR("Invalid file entry\n");
-        unlock_mutex();
-        return -1;
+        cwd = find_process_cwd(pid);
+        for (int i = 0; cwd == NULL && i < DMVFS_MAX_PROCESS_CWDS; i++)
+        {
+            if (g_process_cwds[i].path == NULL)
+            {
+                cwd = &g_process_cwds[i];
+            }
+        }
+        if (cwd == NULL)
+        {
+            DMOD_LOG_ERROR("No free working directory entries for process ID %d\n", pid);
+            vfs_free((void*)abs_path);
+            return -1;
+        }
+        cwd->pid = pid;
     }
 
-    dmod_dmfsi_lseek_t lseek_func = (dmod_dmfsi_lseek_t)Dmod_GetDifFunction(
-        file_entry->mount_point->fs_context, dmod_dmfsi_lseek_sig);
-    
-    if (lseek_func == NULL)
+    char* new_path = duplicate_string(abs_path);
+    vfs_free((void*)abs_path);
+    if (new_path == NULL)
     {
-        DMOD_LOG_ERROR("File system does not support lseek\n");
-        unlock_mutex();
+        DMOD_LOG_ERROR("Failed to update current working directory\n");
         return -1;
     }
 
-    int result = lseek_func(file_entry->mount_point->mount_context, file_entry->fs_file, offset, whence);
-    unlock_mutex();
-
-    if (result < 0)
+    if (cwd->path != NULL)
     {
-        DMOD_LOG_ERROR("Failed to seek in file\n");
-        return -1;
+        vfs_free(cwd->path);
     }
+    cwd->path = new_path;
+    refresh_cwd_mount_point(cwd);
 
-    return result;
+    DMOD_LOG_INFO("Current working directory changed to '%s'\n", cwd->path);
+    return 0;
 }
 
 /**
- * @brief Get the current position in an open file in the DMVFS
- *
- * This function returns the current file position for a file previously opened in the DMVFS.
- * It invokes the file system's ftell function.
+ * @brief Change the current working directory in DMVFS
  *
- * @param fp Pointer to the file handle
+ * This function changes the global working directory to the specified path.
+ * It is used by all processes that did not set their own working directory
+ * with dmvfs_chdir_process(). When a function that returns the calling
+ * process is set with dmvfs_set_getpid(), the working directory of the
+ * calling process is changed instead, so other processes are not affected.
+ * It resolves the mount point for the directory and verifies its existence.
  *
- * @return Current offset on success, -1 on failure
+ * @param path Path to the new working directory
+ * @return 0 on success, -1 on failure
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, long, _ftell, (void* fp))
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _chdir, (const char* path))
 {
-    if (!is_initialized())
-    {
-        DMOD_LOG_ERROR("DMVFS is not initialized\n");
-        return -1;
-    }
-    if (fp == NULL)
+    if (!is_initialized() || path == NULL)
     {
-        DMOD_LOG_ERROR("Invalid file pointer\n");
+        DMOD_LOG_ERROR("DMVFS is not initialized or path is NULL\n");
         return -1;
     }
 
@@ -1148,51 +7387,31 @@ DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, long, _ftell, (void* fp))
         return -1;
     }
 
-    file_t* file_entry = (file_t*)fp;
-    if (file_entry->mount_point == NULL || file_entry->fs_file == NULL)
-    {
-        DMOD_LOG_ERROR("Invalid file entry\n");
-        unlock_mutex();
-        return -1;
-    }
-    dmod_dmfsi_tell_t ftell_func = (dmod_dmfsi_tell_t)Dmod_GetDifFunction(
-        file_entry->mount_point->fs_context, dmod_dmfsi_tell_sig);
-    if (ftell_func == NULL)
-    {
-        DMOD_LOG_ERROR("File system does not support ftell\n");
-        unlock_mutex();
-        return -1;
-    }
-    long result = ftell_func(file_entry->mount_point->mount_context, file_entry->fs_file);
+    dmvfs_getpid_t getpid = g_getpid;
+    int result = (getpid != NULL) ? change_directory(path, getpid(), true) : change_directory(path, 0, false);
     unlock_mutex();
-    
-    if (result < 0)
-    {
-        DMOD_LOG_ERROR("Failed to get file position\n");
-        return -1;
-    }
     return result;
 }
 
 /**
- * @brief Check if end-of-file has been reached for a DMVFS file
+ * @brief Change the working directory of a process in DMVFS
  *
- * @param fp Pointer to the file handle
- * @return 1 if EOF, 0 otherwise, -1 on error
+ * This function sets the working directory used to resolve relative paths
+ * opened by the given process. Other processes are not affected. Passing
+ * NULL as the path releases the entry of the process, so it uses the global
+ * working directory again.
+ *
+ * @param path Path to the new working directory (or NULL)
+ * @param pid Process ID
+ * @return 0 on success, -1 on failure
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _feof, (void* fp))
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _chdir_process, (const char* path, int pid))
 {
     if (!is_initialized())
     {
         DMOD_LOG_ERROR("DMVFS is not initialized\n");
         return -1;
     }
-    
-    if (fp == NULL)
-    {
-        DMOD_LOG_ERROR("Invalid file pointer\n");
-        return -1;
-    }
 
     if(!lock_mutex())
     {
@@ -1200,95 +7419,115 @@ DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _feof, (void* fp))
         return -1;
     }
 
-    file_t* file_entry = (file_t*)fp;
-    if (file_entry->mount_point == NULL || file_entry->fs_file == NULL)
+    int result = 0;
+    if (path == NULL)
     {
-        DMOD_LOG_ERROR("Invalid file entry\n");
-        unlock_mutex();
-        return -1;
+        cwd_t* cwd = find_process_cwd(pid);
+        if (cwd != NULL)
+        {
+            vfs_free(cwd->path);
+            cwd->path = NULL;
+            cwd->mount_point = NULL;
+        }
     }
-
-    dmod_dmfsi_eof_t feof_func = (dmod_dmfsi_eof_t)Dmod_GetDifFunction(
-        file_entry->mount_point->fs_context, dmod_dmfsi_eof_sig);
-    
-    if (feof_func == NULL)
+    else
     {
-        DMOD_LOG_ERROR("File system does not support feof\n");
-        unlock_mutex();
-        return -1;
+        result = change_directory(path, pid, true);
     }
 
-    int result = feof_func(file_entry->mount_point->mount_context, file_entry->fs_file);
     unlock_mutex();
     return result;
 }
 
 /**
- * @brief Flush file buffers for a DMVFS file
+ * @brief Open a directory in DMVFS
  *
- * @param fp Pointer to the file handle
- * @return 0 on success, -1 on error
+ * This function opens a directory at the specified path and returns a directory
+ * handle that can be used for reading directory entries.
+ *
+ * @param dp Pointer to store the directory handle
+ * @param path Path to the directory
+ * @return 0 on success, -1 on failure
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _fflush, (void* fp))
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _opendir, (void** dp, const char* path))
 {
-    if (!is_initialized())
+    if (!is_initialized() || dp == NULL || path == NULL)
     {
-        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        DMOD_LOG_ERROR("DMVFS is not initialized or invalid arguments to _opendir\n");
         return -1;
     }
-    
-    if (fp == NULL)
+
+    if(!lock_mutex())
     {
-        DMOD_LOG_ERROR("Invalid file pointer\n");
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
         return -1;
     }
 
-    if(!lock_mutex())
+    resolved_path_t resolved;
+    if (!resolve_path(path, current_cwd(), &resolved))
     {
-        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        DMOD_LOG_ERROR("No mount point found for path '%s'\n", path);
+        unlock_mutex();
         return -1;
     }
+    mount_point_t* mp_entry = resolved.mount_point;
 
-    file_t* file_entry = (file_t*)fp;
-    if (file_entry->mount_point == NULL || file_entry->fs_file == NULL)
+    dmod_dmfsi_opendir_t opendir_func = (dmod_dmfsi_opendir_t)Dmod_GetDifFunction(
+        mp_entry->fs_context, dmod_dmfsi_opendir_sig);
+
+    if (!opendir_func)
     {
-        DMOD_LOG_ERROR("Invalid file entry\n");
+        DMOD_LOG_ERROR("File system does not support opendir for path '%s'\n", path);
+        release_path(&resolved);
         unlock_mutex();
         return -1;
     }
 
-    dmod_dmfsi_fflush_t fflush_func = (dmod_dmfsi_fflush_t)Dmod_GetDifFunction(
-        file_entry->mount_point->fs_context, dmod_dmfsi_fflush_sig);
-    
-    if (fflush_func == NULL)
+    file_t* free_entry = find_free_file_entry();
+    if (free_entry == NULL) {
+        DMOD_LOG_ERROR("No free file entries available for directory\n");
+        release_path(&resolved);
+        unlock_mutex();
+        return -1;
+    }
+
+    void* dir_handle = NULL;
+    uint64_t start = trace_begin();
+    int result = opendir_func(mp_entry->mount_context, &dir_handle, resolved.fs_path);
+    char* fs_path = (result == 0 && dir_handle != NULL) ? duplicate_string(resolved.fs_path) : NULL;
+    release_path(&resolved);
+
+    if (result != 0 || dir_handle == NULL)
     {
-        DMOD_LOG_ERROR("File system does not support fflush\n");
+        trace_record(DMVFS_TRACE_OP_OPENDIR, -1, mp_entry, NULL, 0, 0, result, start);
+        DMOD_LOG_ERROR("Failed to open directory '%s'\n", path);
         unlock_mutex();
         return -1;
     }
+    trace_record(DMVFS_TRACE_OP_OPENDIR, -1, mp_entry, free_entry, 0, 0, result, start);
+    assign_file_entry(free_entry, mp_entry, dir_handle, 0, true);
+    free_entry->fs_path = fs_path;
 
-    int result = fflush_func(file_entry->mount_point->mount_context, file_entry->fs_file);
+    *dp = free_entry;
+    DMOD_LOG_INFO("Directory '%s' opened successfully\n", path);
     unlock_mutex();
-    return result;
+    return 0;
 }
-
 /**
- * @brief Get error status for a DMVFS file
+ * @brief Read the next directory entry in DMVFS
+ *
+ * This function reads the next directory entry from an open directory handle.
+ * It invokes the file system's readdir function to retrieve the directory entry.
  *
- * @param fp Pointer to the file handle
- * @return Error code or 0 if no error
+ * @param dp Pointer to the directory handle
+ * @param entry Pointer to a structure to store the directory entry
+ * @return 0 on success, -1 on failure or end of directory
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _error, (void* fp))
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _readdir, (void* dp, dmfsi_dir_entry_t* entry))
 {
-    if (!is_initialized())
-    {
-        DMOD_LOG_ERROR("DMVFS is not initialized\n");
-        return -1;
-    }
-    
-    if (fp == NULL)
+    if (!is_initialized() || dp == NULL || entry == NULL)
     {
-        DMOD_LOG_ERROR("Invalid file pointer\n");
+        DMOD_LOG_ERROR("DMVFS is not initialized or invalid arguments to _readdir\n");
         return -1;
     }
 
@@ -1298,508 +7537,861 @@ DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _error, (void* fp))
         return -1;
     }
 
-    file_t* file_entry = (file_t*)fp;
-    if (file_entry->mount_point == NULL || file_entry->fs_file == NULL)
+    file_t* dir_entry = (file_t*)dp;
+
+    if (!is_file_valid(dir_entry))
     {
-        DMOD_LOG_ERROR("Invalid file entry\n");
+        DMOD_LOG_ERROR("Invalid directory handle\n");
         unlock_mutex();
         return -1;
     }
 
-    dmod_dmfsi_error_t error_func = (dmod_dmfsi_error_t)Dmod_GetDifFunction(
-        file_entry->mount_point->fs_context, dmod_dmfsi_error_sig);
-    
-    if (error_func == NULL)
+    dmod_dmfsi_readdir_t readdir_func = (dmod_dmfsi_readdir_t)Dmod_GetDifFunction(
+        dir_entry->mount_point->fs_context, dmod_dmfsi_readdir_sig);
+
+    if (!readdir_func)
     {
-        DMOD_LOG_ERROR("File system does not support error\n");
+        DMOD_LOG_ERROR("File system does not support readdir\n");
         unlock_mutex();
         return -1;
     }
 
-    int result = error_func(file_entry->mount_point->mount_context, file_entry->fs_file);
-    unlock_mutex();
-    return result;
+    mount_pin_t pin;
+    mount_pin_t* pinned = unlock_for_backend(dir_entry->mount_point, &pin);
+    uint64_t start = trace_begin();
+    int result = readdir_func(dir_entry->mount_point->mount_context, dir_entry->fs_file, entry);
+    trace_record(DMVFS_TRACE_OP_READDIR, dir_entry->pid, dir_entry->mount_point, dir_entry, 0, 0, result, start);
+    unlock_after_backend(pinned);
+
+    if (result != 0)
+    {
+        DMOD_LOG_VERBOSE("End of directory or error reading directory\n");
+        return -1;
+    }
+
+    return 0;
 }
 
 /**
- * @brief Remove a file in DMVFS
+ * @brief Get the name of a directory entry without its directory
  *
- * @param path Path to the file
- * @return 0 on success, -1 on error
+ * Backends may report the entry name together with its directory.
+ *
+ * @param entry Directory entry
+ * @return Name of the entry, or NULL for an empty name, "." and ".."
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _remove, (const char* path))
+static const char* entry_name(const dmfsi_dir_entry_t* entry)
 {
-    if (!is_initialized() || path == NULL)
-        return -1;
-    
-    if(!lock_mutex())
+    const char* name = strrchr(entry->name, '/');
+    name = (name != NULL) ? name + 1 : entry->name;
+    if(name[0] == '\0' || strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
     {
-        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
-        return -1;
+        return NULL;
     }
-    
-    const char* abs_path = to_absolute_path(path);
-    if (!abs_path)
+    return name;
+}
+
+/**
+ * @brief Check if a directory entry is a directory
+ *
+ * The DMFSI_ATTR_DIRECTORY attribute of the entry is used when the backend
+ * reports attributes, so no additional lookup is needed. A clear attribute
+ * only proves the entry is a file once the listing has reported attributes
+ * for some entry, otherwise dmvfs_direxists() is called for the path.
+ *
+ * @param path Full path of the entry
+ * @param entry Directory entry
+ * @param attributes Pointer to the flag set once the listing reports attributes
+ * @return true if the entry is a directory, false otherwise
+ */
+static bool entry_is_directory(const char* path, const dmfsi_dir_entry_t* entry, bool* attributes)
+{
+#ifdef DMFSI_ATTR_DIRECTORY
+    if(entry->attr != 0)
     {
-        unlock_mutex();
-        return -1;
+        *attributes = true;
     }
-    mount_point_t* mp_entry = get_mount_point_for_path(abs_path);
-    if (!mp_entry)
+    if(*attributes)
     {
-        Dmod_Free((void*)abs_path);
-        unlock_mutex();
-        return -1;
+        return (entry->attr & DMFSI_ATTR_DIRECTORY) != 0;
     }
-    dmod_dmfsi_unlink_t remove_func = (dmod_dmfsi_unlink_t)Dmod_GetDifFunction(
-        mp_entry->fs_context, dmod_dmfsi_unlink_sig);
-    int result = -1;
-    if (remove_func)
-        result = remove_func(mp_entry->mount_context, abs_path + strlen(mp_entry->mount_point));
-    Dmod_Free((void*)abs_path);
-    unlock_mutex();
-    return result;
+#else
+    (void)entry;
+    (void)attributes;
+#endif
+    return dmvfs_direxists(path) == 1;
 }
 
 /**
- * @brief Rename a file in DMVFS
+ * @brief Read the next entry of a directory whose name starts with a prefix
  *
- * @param oldpath Old file path
- * @param newpath New file path
- * @return 0 on success, -1 on error
+ * When the backend provides the readdir_prefix operation (see
+ * dmvfs_set_mount_ops), the query is passed to it, so a backend that keeps
+ * its directories sorted or hashed can answer it without a scan. Otherwise
+ * the entries are read with readdir and filtered inside DMVFS, still without
+ * a round trip through the caller for every entry.
+ *
+ * @param dp Pointer to the directory handle
+ * @param prefix Prefix of the entry name (without its directory), "" for any entry
+ * @param entry Pointer to store the directory entry
+ * @return 0 on success, -1 at the end of the directory or on failure
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _rename, (const char* oldpath, const char* newpath))
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _readdir_prefix, (void* dp, const char* prefix, dmfsi_dir_entry_t* entry))
 {
-    if (!is_initialized() || oldpath == NULL || newpath == NULL)
+    if (!is_initialized() || dp == NULL || prefix == NULL || entry == NULL)
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized or invalid arguments to _readdir_prefix\n");
         return -1;
-    
+    }
+
     if(!lock_mutex())
     {
         DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
         return -1;
     }
-    
-    const char* abs_old = to_absolute_path(oldpath);
-    const char* abs_new = to_absolute_path(newpath);
-    if (!abs_old || !abs_new)
+
+    file_t* dir_entry = (file_t*)dp;
+
+    if (!is_file_valid(dir_entry))
     {
-        if (abs_old) Dmod_Free((void*)abs_old);
-        if (abs_new) Dmod_Free((void*)abs_new);
+        DMOD_LOG_ERROR("Invalid directory handle\n");
         unlock_mutex();
         return -1;
     }
-    mount_point_t* mp_entry = get_mount_point_for_path(abs_old);
-    if (!mp_entry)
+
+    mount_point_t* mp_entry = dir_entry->mount_point;
+    dmvfs_readdir_prefix_t prefix_func = mp_entry->ops.readdir_prefix;
+    dmod_dmfsi_readdir_t readdir_func = (dmod_dmfsi_readdir_t)Dmod_GetDifFunction(
+        mp_entry->fs_context, dmod_dmfsi_readdir_sig);
+
+    if (!prefix_func && !readdir_func)
     {
-        Dmod_Free((void*)abs_old);
-        Dmod_Free((void*)abs_new);
+        DMOD_LOG_ERROR("File system does not support readdir\n");
         unlock_mutex();
         return -1;
     }
-    dmod_dmfsi_rename_t rename_func = (dmod_dmfsi_rename_t)Dmod_GetDifFunction(
-        mp_entry->fs_context, dmod_dmfsi_rename_sig);
+
+    size_t prefix_length = strlen(prefix);
+    mount_pin_t pin;
+    mount_pin_t* pinned = unlock_for_backend(mp_entry, &pin);
+    uint64_t start = trace_begin();
     int result = -1;
-    if (rename_func)
-        result = rename_func(mp_entry->mount_context, abs_old + strlen(mp_entry->mount_point), abs_new + strlen(mp_entry->mount_point));
-    Dmod_Free((void*)abs_old);
-    Dmod_Free((void*)abs_new);
-    unlock_mutex();
-    return result;
-}
+    if (prefix_func)
+    {
+        result = prefix_func(mp_entry->mount_context, dir_entry->fs_file, prefix, entry);
+    }
+    else
+    {
+        while ((result = readdir_func(mp_entry->mount_context, dir_entry->fs_file, entry)) == 0)
+        {
+            const char* name = entry_name(entry);
+            if (name != NULL && strncmp(name, prefix, prefix_length) == 0)
+            {
+                break;
+            }
+        }
+    }
+    trace_record(DMVFS_TRACE_OP_READDIR, dir_entry->pid, mp_entry, dir_entry, 0, 0, result, start);
+    unlock_after_backend(pinned);
+
+    if (result != 0)
+    {
+        DMOD_LOG_VERBOSE("End of directory or error reading directory\n");
+        return -1;
+    }
 
+    return 0;
+}
 /**
- * @brief Perform an ioctl operation on a DMVFS file
+ * @brief Close an open directory in DMVFS
  *
- * @param fp Pointer to the file handle
- * @param command Ioctl command
- * @param arg Argument for the command
- * @return 0 on success, -1 on error
+ * This function closes a directory that was previously opened in DMVFS.
+ * It invokes the file system's closedir function and releases the directory handle.
+ *
+ * @param dp Pointer to the directory handle
+ * @return 0 on success, -1 on failure
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _ioctl, (void* fp, int command, void* arg))
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _closedir, (void* dp))
 {
-    if (!is_initialized() || fp == NULL)
+    if (!is_initialized() || dp == NULL)
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized or invalid directory handle\n");
         return -1;
-    
+    }
+
     if(!lock_mutex())
     {
         DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
         return -1;
     }
-    
-    file_t* file_entry = (file_t*)fp;
-    if (file_entry->mount_point == NULL || file_entry->fs_file == NULL)
+
+    file_t* dir_entry = (file_t*)dp;
+
+    if (dir_entry->revoked)
     {
+        DMOD_LOG_ERROR("Directory was already closed by a forced unmount\n");
+        release_file_entry(dir_entry);
         unlock_mutex();
         return -1;
     }
-    dmod_dmfsi_ioctl_t ioctl_func = (dmod_dmfsi_ioctl_t)Dmod_GetDifFunction(
-        file_entry->mount_point->fs_context, dmod_dmfsi_ioctl_sig);
-    if (!ioctl_func)
+
+    if (dir_entry->mount_point == NULL || dir_entry->fs_file == NULL)
     {
+        DMOD_LOG_ERROR("Invalid directory handle\n");
         unlock_mutex();
         return -1;
     }
-    int result = ioctl_func(file_entry->mount_point->mount_context, file_entry->fs_file, command, arg);
+
+    dmod_dmfsi_closedir_t closedir_func = (dmod_dmfsi_closedir_t)Dmod_GetDifFunction(
+        dir_entry->mount_point->fs_context, dmod_dmfsi_closedir_sig);
+
+    if (!closedir_func)
+    {
+        DMOD_LOG_ERROR("File system does not support closedir\n");
+        unlock_mutex();
+        return -1;
+    }
+
+    uint64_t start = trace_begin();
+    int result = closedir_func(dir_entry->mount_point->mount_context, dir_entry->fs_file);
+    trace_record(DMVFS_TRACE_OP_CLOSEDIR, dir_entry->pid, dir_entry->mount_point, dir_entry, 0, 0, result, start);
+
+    if (result != 0)
+    {
+        DMOD_LOG_ERROR("Failed to close directory\n");
+        unlock_mutex();
+        return -1;
+    }
+
+    release_file_entry(dir_entry);
+
+    DMOD_LOG_INFO("Directory closed successfully\n");
     unlock_mutex();
-    return result;
+    return 0;
 }
-
 /**
- * @brief Synchronize a DMVFS file (flush to disk)
+ * @brief Check if a directory exists in DMVFS
  *
- * @param fp Pointer to the file handle
- * @return 0 on success, -1 on error
+ * This function checks if a directory exists at the specified path.
+ * It resolves the mount point for the directory and invokes the file system's direxists function.
+ *
+ * @param path Path to the directory
+ * @return 1 if the directory exists, 0 if it does not exist, -1 on error
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _sync, (void* fp))
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _direxists, (const char* path))
 {
-    if (!is_initialized() || fp == NULL)
-        return -1;
-    
-    if(!lock_mutex())
+    if (!is_initialized() || path == NULL)
     {
-        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        DMOD_LOG_ERROR("DMVFS is not initialized or path is NULL\n");
         return -1;
     }
-    
-    file_t* file_entry = (file_t*)fp;
-    if (file_entry->mount_point == NULL || file_entry->fs_file == NULL)
+
+    resolved_path_t resolved;
+    if (!acquire_path(path, &resolved))
     {
-        unlock_mutex();
+        DMOD_LOG_ERROR("No mount point found for path '%s'\n", path);
         return -1;
     }
-    dmod_dmfsi_sync_t sync_func = (dmod_dmfsi_sync_t)Dmod_GetDifFunction(
-        file_entry->mount_point->fs_context, dmod_dmfsi_sync_sig);
-    if (!sync_func)
+    mount_point_t* mp_entry = resolved.mount_point;
+
+    dmod_dmfsi_direxists_t direxists_func = (dmod_dmfsi_direxists_t)Dmod_GetDifFunction(
+        mp_entry->fs_context, dmod_dmfsi_direxists_sig);
+
+    if (!direxists_func)
     {
-        unlock_mutex();
+        DMOD_LOG_ERROR("File system does not support direxists for path '%s'\n", path);
+        release_path(&resolved);
         return -1;
     }
-    int result = sync_func(file_entry->mount_point->mount_context, file_entry->fs_file);
-    unlock_mutex();
+
+    uint64_t start = trace_begin();
+    int result = direxists_func(mp_entry->mount_context, resolved.fs_path);
+    trace_record(DMVFS_TRACE_OP_DIREXISTS, -1, mp_entry, NULL, 0, 0, result, start);
+    release_path(&resolved);
+
     return result;
 }
 
 /**
- * @brief Get file status information in DMVFS
- *
- * @param path Path to the file
- * @param stat Pointer to stat structure to fill
- * @return 0 on success, -1 on error
+ * @brief Allocate a directory node of a tree walk
+ * @param path Path of the directory
+ * @param length Length of the path
+ * @param depth Depth of the directory below the root of the walk
+ * @return Pointer to the node, or NULL on failure
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _stat, (const char* path, dmfsi_stat_t* stat))
+static walk_node_t* walk_new_node(const char* path, size_t length, int depth)
 {
-    if (!is_initialized() || path == NULL || stat == NULL)
-        return -1;
-    
-    if(!lock_mutex())
+    walk_node_t* node = (walk_node_t*)vfs_malloc(sizeof(walk_node_t) + length + 1);
+    if(node == NULL)
     {
-        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
-        return -1;
+        DMOD_LOG_ERROR("Failed to allocate walk node\n");
+        return NULL;
     }
-    
-    const char* abs_path = to_absolute_path(path);
-    if (!abs_path)
+    node->next = NULL;
+    node->depth = depth;
+    node->listed = false;
+    memcpy(node->path, path, length);
+    node->path[length] = '\0';
+    return node;
+}
+
+/**
+ * @brief Push a directory to the shared stack of a tree walk
+ * @param walk Tree walk
+ * @param node Directory node
+ */
+static void walk_push(dmvfs_walk_t* walk, walk_node_t* node)
+{
+    ticket_lock(&walk->lock);
+    node->next = walk->stack;
+    walk->stack = node;
+    walk->pending++;
+    ticket_unlock(&walk->lock);
+}
+
+/**
+ * @brief Report an entry of a tree walk to the callback
+ * @param walk Tree walk
+ * @param path Path of the entry
+ * @param entry Directory entry
+ * @param is_dir True if the entry is a directory
+ * @param depth Depth of the entry below the root of the walk
+ * @return true if the walk should descend into the entry
+ */
+static bool walk_visit(dmvfs_walk_t* walk, const char* path, const dmfsi_dir_entry_t* entry, bool is_dir, int depth)
+{
+    __atomic_fetch_add(&walk->visited, 1, __ATOMIC_RELAXED);
+
+    int action = DMVFS_WALK_CONTINUE;
+    if(walk->callback != NULL && (is_dir || !(walk->flags & DMVFS_WALK_DIRS_ONLY)))
     {
-        unlock_mutex();
-        return -1;
+        action = walk->callback(path, entry, is_dir, depth, walk->arg);
     }
-    mount_point_t* mp_entry = get_mount_point_for_path(abs_path);
-    if (!mp_entry)
+    if(action == DMVFS_WALK_STOP)
     {
-        Dmod_Free((void*)abs_path);
-        unlock_mutex();
-        return -1;
-    }
-    dmod_dmfsi_stat_t stat_func = (dmod_dmfsi_stat_t)Dmod_GetDifFunction(
-        mp_entry->fs_context, dmod_dmfsi_stat_sig);
-    int result = -1;
-    if (stat_func)
-        result = stat_func(mp_entry->mount_context, abs_path + strlen(mp_entry->mount_point), stat);
-    Dmod_Free((void*)abs_path);
-    unlock_mutex();
-    return result;
+        __atomic_store_n(&walk->stop, true, __ATOMIC_RELEASE);
+        return false;
+    }
+    return is_dir && action != DMVFS_WALK_PRUNE && (walk->max_depth <= 0 || depth < walk->max_depth);
 }
 
 /**
- * @brief Read a character from a DMVFS file
+ * @brief Collect the mount points located directly in a directory
  *
- * @param fp Pointer to the file handle
- * @return Character read, or -1 on error
+ * The nodes are created under the DMVFS mutex and reported after it is
+ * released, so the callback is free to call the DMVFS API.
+ *
+ * @param path Absolute path of the directory
+ * @param depth Depth of the mount points below the root of the walk
+ * @return List of directory nodes of the mount points
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _getc, (void* fp))
+static walk_node_t* walk_collect_mounts(const char* path, int depth)
 {
-    if (!is_initialized() || fp == NULL)
-        return -1;
-    
+    walk_node_t* list = NULL;
     if(!lock_mutex())
     {
         DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
-        return -1;
+        return NULL;
     }
-    
-    file_t* file_entry = (file_t*)fp;
-    if (file_entry->mount_point == NULL || file_entry->fs_file == NULL)
+
+    size_t path_length = strlen(path);
+    while(path_length > 1 && path[path_length - 1] == '/')
     {
-        unlock_mutex();
-        return -1;
+        path_length--;
     }
-    dmod_dmfsi_getc_t getc_func = (dmod_dmfsi_getc_t)Dmod_GetDifFunction(
-        file_entry->mount_point->fs_context, dmod_dmfsi_getc_sig);
-    if (!getc_func)
+    for(int i = 0; i < g_max_mount_points; i++)
     {
-        unlock_mutex();
-        return -1;
+        mount_point_t* mp = &g_mount_points[i];
+        if(mp->state != MOUNT_STATE_ACTIVE)
+        {
+            continue;
+        }
+        const char* name = strrchr(mp->mount_point, '/');
+        size_t parent_length = (name == NULL || name == mp->mount_point) ? 1 : (size_t)(name - mp->mount_point);
+        if(name == NULL || name[1] == '\0' || parent_length != path_length ||
+           strncmp(mp->mount_point, path, path_length) != 0)
+        {
+            continue;
+        }
+        walk_node_t* node = walk_new_node(mp->mount_point, mp->mount_point_length, depth);
+        if(node != NULL)
+        {
+            node->next = list;
+            list = node;
+        }
     }
-    int result = getc_func(file_entry->mount_point->mount_context, file_entry->fs_file);
+
     unlock_mutex();
-    return result;
+    return list;
 }
 
 /**
- * @brief Write a character to a DMVFS file
+ * @brief List one directory of a tree walk
  *
- * @param fp Pointer to the file handle
- * @param c Character to write
- * @return Character written, or -1 on error
+ * Entries that are directories are pushed to the shared stack, so they can
+ * be listed by any thread that runs the walk.
+ *
+ * @param walk Tree walk
+ * @param node Directory node
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _putc, (void* fp, int c))
+static void walk_directory(dmvfs_walk_t* walk, walk_node_t* node)
 {
-    if (!is_initialized() || fp == NULL)
-        return -1;
-    
-    if(!lock_mutex())
+    walk_node_t* mounts = NULL;
+    if(walk->flags & DMVFS_WALK_MOUNTS)
     {
-        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
-        return -1;
+        mounts = walk_collect_mounts(node->path, node->depth + 1);
     }
-    
-    file_t* file_entry = (file_t*)fp;
-    if (file_entry->mount_point == NULL || file_entry->fs_file == NULL)
+
+    void* dp = NULL;
+    bool listed = (mounts != NULL);
+    if(dmvfs_opendir(&dp, node->path) == 0)
     {
-        unlock_mutex();
-        return -1;
+        listed = true;
+        dmfsi_dir_entry_t entry;
+        while(!__atomic_load_n(&walk->stop, __ATOMIC_ACQUIRE) && dmvfs_readdir(dp, &entry) == 0)
+        {
+            const char* name = entry_name(&entry);
+            if(name == NULL)
+            {
+                continue;
+            }
+
+            char buffer[DMVFS_PATH_MAX];
+            char* allocated = NULL;
+            char* path = join_path(node->path, name, buffer, sizeof(buffer), &allocated);
+            if(path == NULL)
+            {
+                __atomic_store_n(&walk->failed, true, __ATOMIC_RELAXED);
+                break;
+            }
+
+            bool shadowed = false;
+            for(walk_node_t* mount = mounts; mount != NULL && !shadowed; mount = mount->next)
+            {
+                shadowed = (strcmp(mount->path, path) == 0);
+            }
+            if(!shadowed && walk_visit(walk, path, &entry, dmvfs_direxists(path) == 1, node->depth + 1))
+            {
+                walk_node_t* child = walk_new_node(path, strlen(path), node->depth + 1);
+                if(child == NULL)
+                {
+                    __atomic_store_n(&walk->failed, true, __ATOMIC_RELAXED);
+                }
+                else
+                {
+                    walk_push(walk, child);
+                }
+            }
+            vfs_free(allocated);
+        }
+        dmvfs_closedir(dp);
     }
-    dmod_dmfsi_putc_t putc_func = (dmod_dmfsi_putc_t)Dmod_GetDifFunction(
-        file_entry->mount_point->fs_context, dmod_dmfsi_putc_sig);
-    if (!putc_func)
+
+    while(mounts != NULL)
     {
-        unlock_mutex();
-        return -1;
+        walk_node_t* mount = mounts;
+        mounts = mount->next;
+
+        dmfsi_dir_entry_t entry;
+        memset(&entry, 0, sizeof(entry));
+        const char* name = strrchr(mount->path, '/') + 1;
+        strncpy(entry.name, name, sizeof(entry.name) - 1);
+#ifdef DMFSI_ATTR_DIRECTORY
+        entry.attr = DMFSI_ATTR_DIRECTORY;
+#endif
+        if(!__atomic_load_n(&walk->stop, __ATOMIC_ACQUIRE) && walk_visit(walk, mount->path, &entry, true, mount->depth))
+        {
+            walk_push(walk, mount);
+        }
+        else
+        {
+            vfs_free(mount);
+        }
+    }
+
+    if(!listed)
+    {
+        DMOD_LOG_ERROR("Cannot list directory '%s'\n", node->path);
+        __atomic_store_n(&walk->failed, true, __ATOMIC_RELAXED);
     }
-    int result = putc_func(file_entry->mount_point->mount_context, file_entry->fs_file, c);
-    unlock_mutex();
-    return result;
 }
 
 /**
- * @brief Change the permissions of a file in DMVFS
+ * @brief Prepare a recursive walk of a directory tree
  *
- * This function changes the permissions of a file at the specified path.
- * It resolves the mount point for the file and invokes the file system's chmod function.
+ * The walk keeps a shared stack of directories that are still to be listed.
+ * It is executed by dmvfs_walk_run(), which can be called from any number
+ * of threads at the same time - each of them takes the next directory from
+ * the stack and pushes the subdirectories it finds, so independent subtrees
+ * and mount points are listed in parallel and idle threads pick up the work
+ * found by the busy ones. DMOD does not provide threads, so the caller
+ * decides how many threads take part.
  *
- * @param path Path to the file
- * @param mode New permissions mode
- * @return 0 on success, -1 on failure
+ * @param root Path of the directory to walk
+ * @param max_depth Deepest level to report, 1 for the entries of the root only (0 for no limit)
+ * @param flags DMVFS_WALK_* flags
+ * @param callback Function called for every entry (can be NULL to only count the entries)
+ * @param arg Argument passed to the callback
+ * @return Pointer to the walk, or NULL on failure
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _chmod, (const char* path, int mode))
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, dmvfs_walk_t*, _walk_open, (const char* root, int max_depth, int flags, dmvfs_walk_callback_t callback, void* arg))
 {
-    if (!is_initialized() || path == NULL)
+    if (!is_initialized() || root == NULL)
     {
-        DMOD_LOG_ERROR("DMVFS is not initialized or path is NULL\n");
-        return -1;
+        DMOD_LOG_ERROR("DMVFS is not initialized or root is NULL\n");
+        return NULL;
     }
 
     if(!lock_mutex())
     {
         DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
-        return -1;
-    }
-
-    const char* abs_path = to_absolute_path(path);
-    if (!abs_path)
-    {
-        DMOD_LOG_ERROR("Failed to resolve absolute path for '%s'\n", path);
-        unlock_mutex();
-        return -1;
+        return NULL;
     }
-
-    mount_point_t* mp_entry = get_mount_point_for_path(abs_path);
-    if (!mp_entry)
+    char* abs_root = to_absolute_path(root, current_cwd());
+    unlock_mutex();
+    if (abs_root == NULL)
     {
-        DMOD_LOG_ERROR("No mount point found for path '%s'\n", abs_path);
-        Dmod_Free((void*)abs_path);
-        unlock_mutex();
-        return -1;
+        DMOD_LOG_ERROR("Failed to resolve walk root '%s'\n", root);
+        return NULL;
     }
 
-    dmod_dmfsi_chmod_t chmod_func = (dmod_dmfsi_chmod_t)Dmod_GetDifFunction(
-        mp_entry->fs_context, dmod_dmfsi_chmod_sig);
-
-    if (!chmod_func)
+    size_t length = strlen(abs_root);
+    while (length > 1 && abs_root[length - 1] == '/')
     {
-        DMOD_LOG_ERROR("File system does not support chmod for path '%s'\n", abs_path);
-        Dmod_Free((void*)abs_path);
-        unlock_mutex();
-        return -1;
+        length--;
     }
-
-    int result = chmod_func(mp_entry->mount_context, abs_path + strlen(mp_entry->mount_point), mode);
-    Dmod_Free((void*)abs_path);
-    unlock_mutex();
-
-    if (result != 0)
+    dmvfs_walk_t* walk = (dmvfs_walk_t*)vfs_malloc(sizeof(dmvfs_walk_t));
+    walk_node_t* node = walk_new_node(abs_root, length, 0);
+    vfs_free(abs_root);
+    if (walk == NULL || node == NULL)
     {
-        DMOD_LOG_ERROR("Failed to change permissions for '%s'\n", path);
-        return -1;
+        DMOD_LOG_ERROR("Failed to allocate tree walk\n");
+        vfs_free(walk);
+        vfs_free(node);
+        return NULL;
     }
 
-    DMOD_LOG_INFO("Permissions for '%s' changed successfully\n", path);
-    return 0;
+    memset(walk, 0, sizeof(dmvfs_walk_t));
+    ticket_lock_init(&walk->lock);
+    walk->max_depth = max_depth;
+    walk->flags = flags;
+    walk->callback = callback;
+    walk->arg = arg;
+    walk_push(walk, node);
+    return walk;
 }
+
 /**
- * @brief Update the access and modification times of a file in DMVFS
+ * @brief Take part in a tree walk
  *
- * This function updates the access and modification times of a file
- * at the specified path. It resolves the mount point for the file
- * and invokes the file system's utime function.
+ * Lists directories from the stack of the walk until all of them are done.
+ * A thread keeps its gate (see gate_get()) locked while it lists a
+ * directory. A thread that finds the stack empty while other threads are
+ * still listing directories blocks on the gate of one of them, and looks
+ * at the stack again when that thread has finished its directory. When none
+ * of the busy threads has a gate the idle thread returns at once - the
+ * busy threads list the rest of the tree themselves.
  *
- * @param path Path to the file
- * @param atime New access time (UNIX timestamp)
- * @param mtime New modification time (UNIX timestamp)
+ * @param walk Tree walk created with dmvfs_walk_open()
  * @return 0 on success, -1 on failure
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _utime, (const char* path, uint32_t atime, uint32_t mtime))
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _walk_run, (dmvfs_walk_t* walk))
 {
-    if (!is_initialized() || path == NULL)
+    if (walk == NULL)
     {
-        DMOD_LOG_ERROR("DMVFS is not initialized or path is NULL\n");
+        DMOD_LOG_ERROR("Invalid arguments to _walk_run\n");
         return -1;
     }
 
-    if(!lock_mutex())
+    walk_worker_t worker = { NULL, gate_get() };
+    for (;;)
     {
-        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
-        return -1;
+        // Only idle threads that look at the busy list lock the gate, so this never blocks for long
+        if (worker.gate != NULL)
+        {
+            Dmod_Mutex_Lock(worker.gate->mutex);
+        }
+
+        ticket_lock(&walk->lock);
+        walk_node_t* node = walk->stack;
+        if (node != NULL)
+        {
+            walk->stack = node->next;
+            worker.next = walk->busy;
+            walk->busy = &worker;
+            ticket_unlock(&walk->lock);
+
+            if (!__atomic_load_n(&walk->stop, __ATOMIC_ACQUIRE))
+            {
+                walk_directory(walk, node);
+            }
+            vfs_free(node);
+
+            ticket_lock(&walk->lock);
+            for (walk_worker_t** link = &walk->busy; *link != NULL; link = &(*link)->next)
+            {
+                if (*link == &worker)
+                {
+                    *link = worker.next;
+                    break;
+                }
+            }
+            walk->pending--;
+            ticket_unlock(&walk->lock);
+            if (worker.gate != NULL)
+            {
+                Dmod_Mutex_Unlock(worker.gate->mutex);
+            }
+            continue;
+        }
+
+        gate_t* gate = NULL;
+        for (walk_worker_t* busy = walk->busy; busy != NULL && walk->pending != 0; busy = busy->next)
+        {
+            if (busy->gate != NULL)
+            {
+                gate = busy->gate;
+            }
+        }
+        if (gate != NULL)
+        {
+            __atomic_add_fetch(&gate->refs, 1, __ATOMIC_ACQ_REL);
+        }
+        ticket_unlock(&walk->lock);
+        if (worker.gate != NULL)
+        {
+            Dmod_Mutex_Unlock(worker.gate->mutex);
+        }
+
+        if (gate == NULL)
+        {
+            // the walk is done, or the busy threads finish it without us
+            break;
+        }
+        Dmod_Mutex_Lock(gate->mutex);
+        Dmod_Mutex_Unlock(gate->mutex);
+        gate_put(gate);
     }
 
-    const char* abs_path = to_absolute_path(path);
-    if (!abs_path)
+    if (worker.gate != NULL)
     {
-        DMOD_LOG_ERROR("Failed to resolve absolute path for '%s'\n", path);
-        unlock_mutex();
-        return -1;
+        gate_put(worker.gate);
     }
+    return __atomic_load_n(&walk->failed, __ATOMIC_RELAXED) ? -1 : 0;
+}
 
-    mount_point_t* mp_entry = get_mount_point_for_path(abs_path);
-    if (!mp_entry)
+/**
+ * @brief Finish a tree walk
+ *
+ * Must be called after all calls of dmvfs_walk_run() returned.
+ *
+ * @param walk Tree walk created with dmvfs_walk_open()
+ * @return Number of visited entries, or -1 if a directory could not be listed
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _walk_close, (dmvfs_walk_t* walk))
+{
+    if (walk == NULL)
     {
-        DMOD_LOG_ERROR("No mount point found for path '%s'\n", abs_path);
-        Dmod_Free((void*)abs_path);
-        unlock_mutex();
+        DMOD_LOG_ERROR("Invalid arguments to _walk_close\n");
         return -1;
     }
 
-    dmod_dmfsi_utime_t utime_func = (dmod_dmfsi_utime_t)Dmod_GetDifFunction(
-        mp_entry->fs_context, dmod_dmfsi_utime_sig);
-
-    if (!utime_func)
+    while (walk->stack != NULL)
     {
-        DMOD_LOG_ERROR("File system does not support utime for path '%s'\n", abs_path);
-        Dmod_Free((void*)abs_path);
-        unlock_mutex();
-        return -1;
+        walk_node_t* node = walk->stack;
+        walk->stack = node->next;
+        vfs_free(node);
     }
 
-    int result = utime_func(mp_entry->mount_context, abs_path + strlen(mp_entry->mount_point), atime, mtime);
-    Dmod_Free((void*)abs_path);
-    unlock_mutex();
+    int result = walk->failed ? -1 : (int)walk->visited;
+    ticket_lock_deinit(&walk->lock);
+    vfs_free(walk);
+    return result;
+}
 
-    if (result != 0)
+/**
+ * @brief Walk a directory tree in the calling thread
+ *
+ * Shortcut for dmvfs_walk_open(), dmvfs_walk_run() and dmvfs_walk_close().
+ *
+ * @param root Path of the directory to walk
+ * @param max_depth Deepest level to report, 1 for the entries of the root only (0 for no limit)
+ * @param flags DMVFS_WALK_* flags
+ * @param callback Function called for every entry (can be NULL to only count the entries)
+ * @param arg Argument passed to the callback
+ * @return Number of visited entries, or -1 on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _walk, (const char* root, int max_depth, int flags, dmvfs_walk_callback_t callback, void* arg))
+{
+    dmvfs_walk_t* walk = dmvfs_walk_open(root, max_depth, flags, callback, arg);
+    if (walk == NULL)
     {
-        DMOD_LOG_ERROR("Failed to update times for '%s'\n", path);
         return -1;
     }
+    dmvfs_walk_run(walk);
+    return dmvfs_walk_close(walk);
+}
 
-    DMOD_LOG_INFO("Times for '%s' updated successfully\n", path);
-    return 0;
+/**
+ * @brief Update the duration and throughput of a tree operation
+ * @param stats Statistics of the operation
+ * @param start Start time of the operation
+ */
+static void tree_update_stats(dmvfs_tree_stats_t* stats, uint64_t start)
+{
+    stats->elapsed = (g_clock != NULL) ? g_clock() - start : 0;
+    stats->bytes_per_sec = (stats->elapsed != 0) ? (stats->bytes * 1000000u) / stats->elapsed : 0;
 }
 
 /**
- * @brief Remove a file in DMVFS
+ * @brief Remove a batch of files located in one directory
  *
- * This function removes a file at the specified path. It resolves the
- * mount point for the file and invokes the file system's unlink function.
+ * The directory is resolved once and the DMVFS mutex is taken (or the mount
+ * point pinned) once for the whole batch, instead of once per file as with
+ * dmvfs_unlink().
  *
- * @param path Path to the file
+ * @param dir Path of the directory
+ * @param files List of file names
+ * @param count Maximum number of files to remove from the list
+ * @param removed Pointer to the counter of removed files
  * @return 0 on success, -1 on failure
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _unlink, (const char* path))
+static int remove_files(const char* dir, const walk_node_t* files, int count, uint32_t* removed)
 {
-    if (!is_initialized() || path == NULL)
+    resolved_path_t resolved;
+    if (!acquire_path(dir, &resolved))
     {
-        DMOD_LOG_ERROR("DMVFS is not initialized or path is NULL\n");
+        DMOD_LOG_ERROR("No mount point found for path '%s'\n", dir);
         return -1;
     }
+    mount_point_t* mp_entry = resolved.mount_point;
 
-    if(!lock_mutex())
-    {
-        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
-        return -1;
-    }
+    dmod_dmfsi_unlink_t unlink_func = (dmod_dmfsi_unlink_t)Dmod_GetDifFunction(
+        mp_entry->fs_context, dmod_dmfsi_unlink_sig);
 
-    const char* abs_path = to_absolute_path(path);
-    if (!abs_path)
+    if (!unlink_func)
     {
-        DMOD_LOG_ERROR("Failed to resolve absolute path for '%s'\n", path);
-        unlock_mutex();
+        DMOD_LOG_ERROR("File system does not support unlink for path '%s'\n", dir);
+        release_path(&resolved);
         return -1;
     }
 
-    mount_point_t* mp_entry = get_mount_point_for_path(abs_path);
-    if (!mp_entry)
+    int result = 0;
+    for (const walk_node_t* file = files; file != NULL && count > 0; file = file->next, count--)
     {
-        DMOD_LOG_ERROR("No mount point found for path '%s'\n", abs_path);
-        Dmod_Free((void*)abs_path);
-        unlock_mutex();
-        return -1;
+        char buffer[DMVFS_PATH_MAX];
+        char* allocated = NULL;
+        char* fs_path = join_path(resolved.fs_path, file->path, buffer, sizeof(buffer), &allocated);
+        if (fs_path == NULL)
+        {
+            result = -1;
+            break;
+        }
+
+        handle_cache_invalidate(mp_entry, fs_path);
+        uint64_t start = trace_begin();
+        int unlinked = unlink_func(mp_entry->mount_context, fs_path);
+        trace_record(DMVFS_TRACE_OP_UNLINK, -1, mp_entry, NULL, 0, 0, unlinked, start);
+        if (unlinked != 0)
+        {
+            DMOD_LOG_ERROR("Failed to remove file '%s' in '%s'\n", file->path, dir);
+            result = -1;
+        }
+        else
+        {
+            (*removed)++;
+        }
+        vfs_free(allocated);
     }
 
-    dmod_dmfsi_unlink_t unlink_func = (dmod_dmfsi_unlink_t)Dmod_GetDifFunction(
-        mp_entry->fs_context, dmod_dmfsi_unlink_sig);
+    release_path(&resolved);
+    return result;
+}
 
-    if (!unlink_func)
+/**
+ * @brief List a directory that is going to be removed
+ *
+ * Directories are pushed to the stack, above the listed directory, and the
+ * names of the files are collected, so they are removed after the listing
+ * is closed.
+ *
+ * @param node Directory node
+ * @param stack Pointer to the stack of directories
+ * @param files Pointer to store the list of file names
+ * @param bytes Pointer to the counter of bytes of the files
+ * @return 0 on success, -1 on failure
+ */
+static int list_for_removal(const walk_node_t* node, walk_node_t** stack, walk_node_t** files, uint64_t* bytes)
+{
+    void* dp = NULL;
+    if (dmvfs_opendir(&dp, node->path) != 0)
     {
-        DMOD_LOG_ERROR("File system does not support unlink for path '%s'\n", abs_path);
-        Dmod_Free((void*)abs_path);
-        unlock_mutex();
         return -1;
     }
 
-    int result = unlink_func(mp_entry->mount_context, abs_path + strlen(mp_entry->mount_point));
-    Dmod_Free((void*)abs_path);
-    unlock_mutex();
-
-    if (result != 0)
+    int result = 0;
+    bool attributes = false;
+    dmfsi_dir_entry_t entry;
+    while (result == 0 && dmvfs_readdir(dp, &entry) == 0)
     {
-        DMOD_LOG_ERROR("Failed to remove file '%s'\n", path);
-        return -1;
+        const char* name = entry_name(&entry);
+        if (name == NULL)
+        {
+            continue;
+        }
+
+        char buffer[DMVFS_PATH_MAX];
+        char* allocated = NULL;
+        char* path = join_path(node->path, name, buffer, sizeof(buffer), &allocated);
+        if (path == NULL)
+        {
+            result = -1;
+            break;
+        }
+
+        walk_node_t* child = NULL;
+        if (entry_is_directory(path, &entry, &attributes))
+        {
+            child = walk_new_node(path, strlen(path), node->depth + 1);
+            if (child != NULL)
+            {
+                child->next = *stack;
+                *stack = child;
+            }
+        }
+        else
+        {
+            child = walk_new_node(name, strlen(name), node->depth + 1);
+            if (child != NULL)
+            {
+                child->next = *files;
+                *files = child;
+                *bytes += entry.size;
+            }
+        }
+        result = (child != NULL) ? 0 : -1;
+        vfs_free(allocated);
     }
 
-    DMOD_LOG_INFO("File '%s' removed successfully\n", path);
-    return 0;
+    dmvfs_closedir(dp);
+    return result;
 }
 
 /**
- * @brief Create a directory in DMVFS
+ * @brief Remove a directory tree
  *
- * This function creates a directory at the specified path with the given mode.
- * It resolves the mount point for the directory and invokes the file system's mkdir function.
+ * The tree is removed depth first without recursion. Each directory is
+ * listed once, its files are removed in batches of DMVFS_TREE_BATCH_SIZE
+ * under a single lock of the DMVFS mutex, and the directory itself is
+ * removed after its subdirectories. A path of a file removes just the file.
  *
- * @param path Path to the directory
- * @param mode Permissions mode for the new directory
- * @return 0 on success, -1 on failure
+ * @param path Path of the directory tree
+ * @param progress Function called after every batch and directory (can be NULL)
+ * @param arg Argument passed to the progress function
+ * @param stats Pointer to store the amount of removed entries and the throughput (can be NULL)
+ * @return 0 on success, -1 on failure or when cancelled by the progress function
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _mkdir, (const char* path, int mode))
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _remove_tree, (const char* path, dmvfs_tree_progress_t progress, void* arg, dmvfs_tree_stats_t* stats))
 {
     if (!is_initialized() || path == NULL)
     {
@@ -1807,330 +8399,510 @@ DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _mkdir, (const char* path, int mode)
         return -1;
     }
 
-    if(!lock_mutex())
+    dmvfs_tree_stats_t totals;
+    memset(&totals, 0, sizeof(totals));
+    uint64_t start = (g_clock != NULL) ? g_clock() : 0;
+    bool cancelled = false;
+    int result = 0;
+
+    if (dmvfs_direxists(path) != 1)
     {
-        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
-        return -1;
+        result = dmvfs_unlink(path);
+        totals.files = (result == 0) ? 1 : 0;
     }
-
-    const char* abs_path = to_absolute_path(path);
-    if (!abs_path)
+    else
     {
-        DMOD_LOG_ERROR("Failed to resolve absolute path for '%s'\n", path);
-        unlock_mutex();
-        return -1;
+        walk_node_t* stack = walk_new_node(path, strlen(path), 0);
+        result = (stack != NULL) ? 0 : -1;
+        while (stack != NULL && result == 0 && !cancelled)
+        {
+            walk_node_t* node = stack;
+            if (node->listed)
+            {
+                // all entries of the directory are already removed
+                stack = node->next;
+                result = dmvfs_rmdir(node->path);
+                if (result == 0)
+                {
+                    totals.dirs++;
+                    tree_update_stats(&totals, start);
+                    cancelled = (progress != NULL && !progress(node->path, &totals, arg));
+                }
+                vfs_free(node);
+                continue;
+            }
+
+            node->listed = true;
+            walk_node_t* files = NULL;
+            result = list_for_removal(node, &stack, &files, &totals.bytes);
+            while (files != NULL)
+            {
+                if (result == 0 && !cancelled)
+                {
+                    result = remove_files(node->path, files, DMVFS_TREE_BATCH_SIZE, &totals.files);
+                    tree_update_stats(&totals, start);
+                    cancelled = (progress != NULL && !progress(node->path, &totals, arg));
+                }
+                for (int i = 0; i < DMVFS_TREE_BATCH_SIZE && files != NULL; i++)
+                {
+                    walk_node_t* next = files->next;
+                    vfs_free(files);
+                    files = next;
+                }
+            }
+        }
+
+        while (stack != NULL)
+        {
+            walk_node_t* next = stack->next;
+            vfs_free(stack);
+            stack = next;
+        }
     }
 
-    mount_point_t* mp_entry = get_mount_point_for_path(abs_path);
-    if (!mp_entry)
+    tree_update_stats(&totals, start);
+    if (stats != NULL)
     {
-        DMOD_LOG_ERROR("No mount point found for path '%s'\n", abs_path);
-        Dmod_Free((void*)abs_path);
-        unlock_mutex();
-        return -1;
+        *stats = totals;
     }
 
-    dmod_dmfsi_mkdir_t mkdir_func = (dmod_dmfsi_mkdir_t)Dmod_GetDifFunction(
-        mp_entry->fs_context, dmod_dmfsi_mkdir_sig);
-
-    if (!mkdir_func)
+    if (cancelled)
     {
-        DMOD_LOG_ERROR("File system does not support mkdir for path '%s'\n", abs_path);
-        Dmod_Free((void*)abs_path);
-        unlock_mutex();
+        DMOD_LOG_WARN("Removal of '%s' cancelled\n", path);
         return -1;
     }
-
-    int result = mkdir_func(mp_entry->mount_context, abs_path + strlen(mp_entry->mount_point), mode);
-    Dmod_Free((void*)abs_path);
-    unlock_mutex();
-
     if (result != 0)
     {
-        DMOD_LOG_ERROR("Failed to create directory '%s'\n", path);
+        DMOD_LOG_ERROR("Failed to remove tree '%s'\n", path);
         return -1;
     }
-
-    DMOD_LOG_INFO("Directory '%s' created successfully\n", path);
     return 0;
 }
+
 /**
- * @brief Remove a directory in DMVFS
- *
- * This function removes a directory at the specified path. It resolves the
- * mount point for the directory and invokes the file system's rmdir function.
- *
- * @param path Path to the directory
- * @return 0 on success, -1 on failure
+ * @brief Copy one entry of a directory tree (callback of the tree walk)
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _rmdir, (const char* path))
+static int copy_tree_entry(const char* path, const dmfsi_dir_entry_t* entry, bool is_dir, int depth, void* arg)
 {
-    if (!is_initialized() || path == NULL)
-    {
-        DMOD_LOG_ERROR("DMVFS is not initialized or path is NULL\n");
-        return -1;
-    }
+    (void)entry;
+    (void)depth;
+    tree_copy_t* copy = (tree_copy_t*)arg;
 
-    if(!lock_mutex())
+    char buffer[DMVFS_PATH_MAX];
+    char* allocated = NULL;
+    char* dst = join_path(copy->dst, path + copy->src_length, buffer, sizeof(buffer), &allocated);
+    if (dst == NULL)
     {
-        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
-        return -1;
+        copy->failed = true;
+        return DMVFS_WALK_STOP;
     }
 
-    const char* abs_path = to_absolute_path(path);
-    if (!abs_path)
+    int result = 0;
+    if (is_dir)
     {
-        DMOD_LOG_ERROR("Failed to resolve absolute path for '%s'\n", path);
-        unlock_mutex();
-        return -1;
+        result = (dmvfs_direxists(dst) == 1) ? 0 : dmvfs_mkdir(dst, 0);
+        copy->stats.dirs += (result == 0) ? 1 : 0;
     }
-
-    mount_point_t* mp_entry = get_mount_point_for_path(abs_path);
-    if (!mp_entry)
+    else
     {
-        DMOD_LOG_ERROR("No mount point found for path '%s'\n", abs_path);
-        Dmod_Free((void*)abs_path);
-        unlock_mutex();
-        return -1;
+        dmvfs_copy_stats_t file_stats = {0};
+        result = dmvfs_copy(path, dst, &file_stats);
+        copy->stats.files += (result == 0) ? 1 : 0;
+        copy->stats.bytes += file_stats.bytes;
     }
+    vfs_free(allocated);
 
-    dmod_dmfsi_unlink_t rmdir_func = (dmod_dmfsi_unlink_t)Dmod_GetDifFunction(
-        mp_entry->fs_context, dmod_dmfsi_unlink_sig);
-
-    if (!rmdir_func)
+    if (result != 0)
     {
-        DMOD_LOG_ERROR("File system does not support rmdir for path '%s'\n", abs_path);
-        Dmod_Free((void*)abs_path);
-        unlock_mutex();
-        return -1;
+        copy->failed = true;
+        return DMVFS_WALK_STOP;
     }
 
-    int result = rmdir_func(mp_entry->mount_context, abs_path + strlen(mp_entry->mount_point));
-    Dmod_Free((void*)abs_path);
-    unlock_mutex();
-
-    if (result != 0)
+    tree_update_stats(&copy->stats, copy->start);
+    if (copy->progress != NULL && !copy->progress(path, &copy->stats, copy->arg))
     {
-        DMOD_LOG_ERROR("Failed to remove directory '%s'\n", path);
-        return -1;
+        copy->cancelled = true;
+        return DMVFS_WALK_STOP;
     }
-
-    DMOD_LOG_INFO("Directory '%s' removed successfully\n", path);
-    return 0;
+    return DMVFS_WALK_CONTINUE;
 }
 
 /**
- * @brief Change the current working directory in DMVFS
+ * @brief Copy a directory tree, also between different mount points
  *
- * This function changes the current working directory to the specified path.
- * It resolves the mount point for the directory and verifies its existence.
+ * The source is traversed with dmvfs_walk(), so every directory is created
+ * before its entries are copied, and the files are copied with dmvfs_copy().
+ * Existing directories in the destination are reused and existing files are
+ * overwritten. A path of a file copies just the file.
  *
- * @param path Path to the new working directory
- * @return 0 on success, -1 on failure
+ * @param src Path of the source directory
+ * @param dst Path of the destination directory
+ * @param progress Function called after every copied entry (can be NULL)
+ * @param arg Argument passed to the progress function
+ * @param stats Pointer to store the amount of copied entries and the throughput (can be NULL)
+ * @return 0 on success, -1 on failure or when cancelled by the progress function
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _chdir, (const char* path))
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _copy_tree, (const char* src, const char* dst, dmvfs_tree_progress_t progress, void* arg, dmvfs_tree_stats_t* stats))
 {
-    if (!is_initialized() || path == NULL)
+    if (!is_initialized() || src == NULL || dst == NULL)
     {
-        DMOD_LOG_ERROR("DMVFS is not initialized or path is NULL\n");
+        DMOD_LOG_ERROR("DMVFS is not initialized or invalid arguments to _copy_tree\n");
         return -1;
     }
 
+    tree_copy_t copy;
+    memset(&copy, 0, sizeof(copy));
+    copy.start = (g_clock != NULL) ? g_clock() : 0;
+    copy.progress = progress;
+    copy.arg = arg;
+
     if(!lock_mutex())
     {
         DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
         return -1;
     }
+    const cwd_t* cwd = current_cwd();
+    char* resolved_src = to_absolute_path(src, cwd);
+    char* resolved_dst = to_absolute_path(dst, cwd);
+    unlock_mutex();
 
-    const char* abs_path = to_absolute_path(path);
-    if (!abs_path)
+    // normalized, so another spelling of the source is not taken for a different tree
+    char* abs_src = (resolved_src != NULL) ? normalized_path(resolved_src) : NULL;
+    copy.dst = (resolved_dst != NULL) ? normalized_path(resolved_dst) : NULL;
+    vfs_free(resolved_src);
+    vfs_free(resolved_dst);
+
+    int result = -1;
+    if (abs_src != NULL && copy.dst != NULL)
     {
-        DMOD_LOG_ERROR("Failed to resolve absolute path for '%s'\n", path);
-        unlock_mutex();
-        return -1;
+        size_t src_length = strlen(abs_src);
+        while (src_length > 1 && abs_src[src_length - 1] == '/')
+        {
+            abs_src[--src_length] = '\0';
+        }
+        // the walk reports "<src>/<name>", the destination gets "<name>"
+        copy.src_length = (src_length == 1) ? 1 : src_length + 1;
+
+        if (strncmp(copy.dst, abs_src, src_length) == 0 &&
+            (copy.dst[src_length] == '\0' || copy.dst[src_length] == '/' || src_length == 1))
+        {
+            DMOD_LOG_ERROR("Cannot copy '%s' into itself\n", src);
+        }
+        else if (dmvfs_direxists(abs_src) != 1)
+        {
+            dmvfs_copy_stats_t file_stats = {0};
+            result = dmvfs_copy(abs_src, copy.dst, &file_stats);
+            copy.stats.files = (result == 0) ? 1 : 0;
+            copy.stats.bytes = file_stats.bytes;
+        }
+        else if (dmvfs_direxists(copy.dst) == 1 || dmvfs_mkdir(copy.dst, 0) == 0)
+        {
+            copy.stats.dirs = 1;
+            int walked = dmvfs_walk(abs_src, 0, 0, copy_tree_entry, &copy);
+            result = (walked < 0 || copy.failed || copy.cancelled) ? -1 : 0;
+        }
     }
+    vfs_free(abs_src);
+    vfs_free(copy.dst);
 
-    mount_point_t* mp_entry = get_mount_point_for_path(abs_path);
-    if (!mp_entry)
+    tree_update_stats(&copy.stats, copy.start);
+    if (stats != NULL)
     {
-        DMOD_LOG_ERROR("No mount point found for path '%s'\n", abs_path);
-        Dmod_Free((void*)abs_path);
-        unlock_mutex();
-        return -1;
+        *stats = copy.stats;
     }
 
-    dmod_dmfsi_direxists_t direxists_func = (dmod_dmfsi_direxists_t)Dmod_GetDifFunction(
-        mp_entry->fs_context, dmod_dmfsi_direxists_sig);
-
-    if (!direxists_func || !direxists_func(mp_entry->mount_context, abs_path + strlen(mp_entry->mount_point)))
+    if (copy.cancelled)
     {
-        DMOD_LOG_ERROR("Directory '%s' does not exist\n", abs_path);
-        Dmod_Free((void*)abs_path);
-        unlock_mutex();
+        DMOD_LOG_WARN("Copy of '%s' cancelled\n", src);
         return -1;
     }
-
-    g_cwd = update_string(g_cwd, abs_path);
-    Dmod_Free((void*)abs_path);
-
-    if (!g_cwd)
+    if (result != 0)
     {
-        DMOD_LOG_ERROR("Failed to update current working directory\n");
-        unlock_mutex();
+        DMOD_LOG_ERROR("Failed to copy tree '%s' to '%s'\n", src, dst);
         return -1;
     }
-
-    DMOD_LOG_INFO("Current working directory changed to '%s'\n", g_cwd);
-    unlock_mutex();
     return 0;
 }
 
 /**
- * @brief Open a directory in DMVFS
- *
- * This function opens a directory at the specified path and returns a directory
- * handle that can be used for reading directory entries.
- *
- * @param dp Pointer to store the directory handle
- * @param path Path to the directory
- * @return 0 on success, -1 on failure
+ * @brief Match one character of a name against one element of a glob pattern
+ * @param pattern Pattern element ('?', a bracket expression or a character)
+ * @param c Character of the name
+ * @return Pointer to the next pattern element, or NULL if the character does not match
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _opendir, (void** dp, const char* path))
+static const char* glob_match_char(const char* pattern, char c)
 {
-    if (!is_initialized() || dp == NULL || path == NULL)
+    if(*pattern == '\0')
     {
-        DMOD_LOG_ERROR("DMVFS is not initialized or invalid arguments to _opendir\n");
-        return -1;
+        return NULL;
     }
-
-    if(!lock_mutex())
+    if(*pattern == '?')
     {
-        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
-        return -1;
+        return pattern + 1;
     }
-
-    const char* abs_path = to_absolute_path(path);
-    if (!abs_path)
+    if(*pattern != '[')
     {
-        DMOD_LOG_ERROR("Failed to resolve absolute path for '%s'\n", path);
-        unlock_mutex();
-        return -1;
+        return (*pattern == c) ? pattern + 1 : NULL;
     }
 
-    mount_point_t* mp_entry = get_mount_point_for_path(abs_path);
-    if (!mp_entry)
+    const char* p = pattern + 1;
+    bool negate = (*p == '!' || *p == '^');
+    p += negate ? 1 : 0;
+    bool matched = false;
+    // a ']' right after the opening bracket is a member of the set
+    do
     {
-        DMOD_LOG_ERROR("No mount point found for path '%s'\n", abs_path);
-        Dmod_Free((void*)abs_path);
-        unlock_mutex();
-        return -1;
-    }
+        if(*p == '\0')
+        {
+            // not a bracket expression, just a '['
+            return (c == '[') ? pattern + 1 : NULL;
+        }
+        if(p[1] == '-' && p[2] != ']' && p[2] != '\0')
+        {
+            matched |= (c >= p[0] && c <= p[2]);
+            p += 3;
+        }
+        else
+        {
+            matched |= (c == *p);
+            p++;
+        }
+    } while(*p != ']');
 
-    dmod_dmfsi_opendir_t opendir_func = (dmod_dmfsi_opendir_t)Dmod_GetDifFunction(
-        mp_entry->fs_context, dmod_dmfsi_opendir_sig);
+    return (matched != negate) ? p + 1 : NULL;
+}
 
-    if (!opendir_func)
+/**
+ * @brief Match a name against one component of a glob pattern
+ *
+ * Supports '*', '?' and bracket expressions ("[abc]", "[a-z]", "[!abc]").
+ * A '*' is retried from the next character of the name only when the rest
+ * of the pattern fails, so the match is linear for a single '*'.
+ *
+ * @param pattern Pattern component
+ * @param name Entry name
+ * @return true if the name matches
+ */
+static bool glob_match(const char* pattern, const char* name)
+{
+    const char* star = NULL;
+    const char* resume = NULL;
+    while(*name != '\0')
     {
-        DMOD_LOG_ERROR("File system does not support opendir for path '%s'\n", abs_path);
-        Dmod_Free((void*)abs_path);
-        unlock_mutex();
-        return -1;
+        if(*pattern == '*')
+        {
+            star = pattern++;
+            resume = name;
+            continue;
+        }
+        const char* next = glob_match_char(pattern, *name);
+        if(next != NULL)
+        {
+            pattern = next;
+            name++;
+        }
+        else if(star != NULL)
+        {
+            pattern = star + 1;
+            name = ++resume;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    while(*pattern == '*')
+    {
+        pattern++;
     }
+    return *pattern == '\0';
+}
 
-    void* dir_handle = NULL;
-    int result = opendir_func(mp_entry->mount_context, &dir_handle, abs_path + strlen(mp_entry->mount_point));
-    Dmod_Free((void*)abs_path);
+/**
+ * @brief Get the length of the literal prefix of a pattern component
+ * @param component Pattern component
+ * @return Length of the part before the first wildcard (the whole length if there is none)
+ */
+static size_t glob_literal_length(const char* component)
+{
+    return strcspn(component, "*?[");
+}
 
-    if (result != 0 || dir_handle == NULL)
+/**
+ * @brief Report a match of a glob search
+ * @param state Glob search
+ * @param path Path of the matching entry
+ * @param entry Directory entry
+ */
+static void glob_report(glob_state_t* state, const char* path, const dmfsi_dir_entry_t* entry)
+{
+    state->matches++;
+    if(state->callback != NULL && !state->callback(path, entry, state->arg))
     {
-        DMOD_LOG_ERROR("Failed to open directory '%s'\n", path);
-        unlock_mutex();
-        return -1;
+        state->stop = true;
     }
+}
 
-    file_t* free_entry = find_free_file_entry();
-    if (free_entry == NULL) {
-        DMOD_LOG_ERROR("No free file entries available for directory\n");
-        unlock_mutex();
-        return -1;
+/**
+ * @brief Push a directory to the stack of a glob search
+ * @param state Glob search
+ * @param path Path of the directory
+ * @param index Index of the pattern component to match in the directory
+ */
+static void glob_push(glob_state_t* state, const char* path, int index)
+{
+    walk_node_t* node = walk_new_node(path, strlen(path), index);
+    if(node == NULL)
+    {
+        state->failed = true;
+        return;
     }
-    free_entry->mount_point = mp_entry;
-    free_entry->fs_file = dir_handle;
-    free_entry->pid = 0; 
-
-    *dp = free_entry;
-    DMOD_LOG_INFO("Directory '%s' opened successfully\n", path);
-    unlock_mutex();
-    return 0;
+    node->next = state->stack;
+    state->stack = node;
 }
+
 /**
- * @brief Read the next directory entry in DMVFS
- *
- * This function reads the next directory entry from an open directory handle.
- * It invokes the file system's readdir function to retrieve the directory entry.
- *
- * @param dp Pointer to the directory handle
- * @param entry Pointer to a structure to store the directory entry
- * @return 0 on success, -1 on failure or end of directory
+ * @brief Match a literal pattern component without listing the directory
+ * @param state Glob search
+ * @param node Directory node
+ * @param last True if the component is the last one of the pattern
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _readdir, (void* dp, dmfsi_dir_entry_t* entry))
+static void glob_literal(glob_state_t* state, const walk_node_t* node, bool last)
 {
-    if (!is_initialized() || dp == NULL || entry == NULL)
+    const char* component = state->components[node->depth];
+    char buffer[DMVFS_PATH_MAX];
+    char* allocated = NULL;
+    char* path = join_path(node->path, component, buffer, sizeof(buffer), &allocated);
+    if(path == NULL)
     {
-        DMOD_LOG_ERROR("DMVFS is not initialized or invalid arguments to _readdir\n");
-        return -1;
+        state->failed = true;
+        return;
     }
 
-    if(!lock_mutex())
+    bool is_dir = (dmvfs_direxists(path) == 1);
+    if(!last)
     {
-        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
-        return -1;
+        if(is_dir)
+        {
+            glob_push(state, path, node->depth + 1);
+        }
+        vfs_free(allocated);
+        return;
     }
 
-    file_t* dir_entry = (file_t*)dp;
+    dmfsi_dir_entry_t entry;
+    dmfsi_stat_t stat;
+    memset(&entry, 0, sizeof(entry));
+    strncpy(entry.name, component, sizeof(entry.name) - 1);
+    if(!is_dir && dmvfs_stat(path, &stat) == 0)
+    {
+        entry.size = stat.size;
+        entry.attr = stat.attr;
+        entry.time = stat.mtime;
+        glob_report(state, path, &entry);
+    }
+    else if(is_dir)
+    {
+#ifdef DMFSI_ATTR_DIRECTORY
+        entry.attr = DMFSI_ATTR_DIRECTORY;
+#endif
+        glob_report(state, path, &entry);
+    }
+    vfs_free(allocated);
+}
 
-    if (dir_entry->mount_point == NULL || dir_entry->fs_file == NULL)
+/**
+ * @brief Match one pattern component against the entries of a directory
+ *
+ * Only the entries that start with the literal prefix of the component are
+ * read (see dmvfs_readdir_prefix). A "**" component matches the directory
+ * itself and all of its subdirectories.
+ *
+ * @param state Glob search
+ * @param node Directory node, its depth is the index of the pattern component
+ */
+static void glob_directory(glob_state_t* state, const walk_node_t* node)
+{
+    const char* component = state->components[node->depth];
+    bool last = (node->depth == state->count - 1);
+    bool recursive = (strcmp(component, "**") == 0);
+    size_t literal = glob_literal_length(component);
+    if(!recursive && component[literal] == '\0')
     {
-        DMOD_LOG_ERROR("Invalid directory handle\n");
-        unlock_mutex();
-        return -1;
+        glob_literal(state, node, last);
+        return;
+    }
+    if(recursive && !last)
+    {
+        // "**" matching no directory at all
+        glob_push(state, node->path, node->depth + 1);
     }
 
-    dmod_dmfsi_readdir_t readdir_func = (dmod_dmfsi_readdir_t)Dmod_GetDifFunction(
-        dir_entry->mount_point->fs_context, dmod_dmfsi_readdir_sig);
+    char prefix[DMVFS_PATH_MAX];
+    literal = recursive ? 0 : literal;
+    literal = (literal < sizeof(prefix)) ? literal : sizeof(prefix) - 1;
+    memcpy(prefix, component, literal);
+    prefix[literal] = '\0';
 
-    if (!readdir_func)
+    void* dp = NULL;
+    if(dmvfs_opendir(&dp, node->path) != 0)
     {
-        DMOD_LOG_ERROR("File system does not support readdir\n");
-        unlock_mutex();
-        return -1;
+        return;
     }
 
-    int result = readdir_func(dir_entry->mount_point->mount_context, dir_entry->fs_file, entry);
-    unlock_mutex();
-
-    if (result != 0)
+    dmfsi_dir_entry_t entry;
+    while(!state->stop && !state->failed && dmvfs_readdir_prefix(dp, prefix, &entry) == 0)
     {
-        DMOD_LOG_VERBOSE("End of directory or error reading directory\n");
-        return -1;
-    }
+        const char* name = entry_name(&entry);
+        if(name == NULL || (!recursive && !glob_match(component, name)))
+        {
+            continue;
+        }
 
-    return 0;
+        char buffer[DMVFS_PATH_MAX];
+        char* allocated = NULL;
+        char* path = join_path(node->path, name, buffer, sizeof(buffer), &allocated);
+        if(path == NULL)
+        {
+            state->failed = true;
+            break;
+        }
+
+        if(last)
+        {
+            glob_report(state, path, &entry);
+        }
+        if((recursive || !last) && dmvfs_direxists(path) == 1)
+        {
+            glob_push(state, path, recursive ? node->depth : node->depth + 1);
+        }
+        vfs_free(allocated);
+    }
+    dmvfs_closedir(dp);
 }
+
 /**
- * @brief Close an open directory in DMVFS
+ * @brief Find the paths that match a glob pattern
  *
- * This function closes a directory that was previously opened in DMVFS.
- * It invokes the file system's closedir function and releases the directory handle.
+ * The pattern is matched component by component while the directories are
+ * enumerated, so only the directories that can contain a match are listed:
+ * the leading components without wildcards are resolved directly, literal
+ * components after a wildcard are checked without listing, and entries are
+ * filtered by the literal prefix of their component before they reach the
+ * caller. Components support '*', '?' and bracket expressions, and "**"
+ * matches any number of directories (also none). Directories that cannot
+ * be listed are skipped.
  *
- * @param dp Pointer to the directory handle
- * @return 0 on success, -1 on failure
+ * @param pattern Absolute or relative pattern (e.g. "/sd/logs/[a-c]?.bin")
+ * @param callback Function called for every match (can be NULL to only count the matches)
+ * @param arg Argument passed to the callback
+ * @return Number of matches, or -1 on failure
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _closedir, (void* dp))
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _glob, (const char* pattern, dmvfs_glob_callback_t callback, void* arg))
 {
-    if (!is_initialized() || dp == NULL)
+    if (!is_initialized() || pattern == NULL)
     {
-        DMOD_LOG_ERROR("DMVFS is not initialized or invalid directory handle\n");
+        DMOD_LOG_ERROR("DMVFS is not initialized or pattern is NULL\n");
         return -1;
     }
 
@@ -2139,56 +8911,106 @@ DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _closedir, (void* dp))
         DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
         return -1;
     }
-
-    file_t* dir_entry = (file_t*)dp;
-
-    if (dir_entry->mount_point == NULL || dir_entry->fs_file == NULL)
+    char* abs_pattern = to_absolute_path(pattern, current_cwd());
+    unlock_mutex();
+    if (abs_pattern == NULL)
     {
-        DMOD_LOG_ERROR("Invalid directory handle\n");
-        unlock_mutex();
+        DMOD_LOG_ERROR("Failed to resolve pattern '%s'\n", pattern);
         return -1;
     }
 
-    dmod_dmfsi_closedir_t closedir_func = (dmod_dmfsi_closedir_t)Dmod_GetDifFunction(
-        dir_entry->mount_point->fs_context, dmod_dmfsi_closedir_sig);
-
-    if (!closedir_func)
+    size_t length = strlen(abs_pattern);
+    char** components = (char**)vfs_malloc(sizeof(char*) * (length + 1));
+    char* base = (char*)vfs_malloc(length + 2);
+    if (components == NULL || base == NULL)
     {
-        DMOD_LOG_ERROR("File system does not support closedir\n");
-        unlock_mutex();
+        DMOD_LOG_ERROR("Failed to allocate glob pattern\n");
+        vfs_free(components);
+        vfs_free(base);
+        vfs_free(abs_pattern);
         return -1;
     }
 
-    int result = closedir_func(dir_entry->mount_point->mount_context, dir_entry->fs_file);
+    glob_state_t state;
+    memset(&state, 0, sizeof(state));
+    state.components = components;
+    state.callback = callback;
+    state.arg = arg;
 
-    if (result != 0)
+    char* cursor = abs_pattern;
+    while (*cursor != '\0')
     {
-        DMOD_LOG_ERROR("Failed to close directory\n");
-        unlock_mutex();
-        return -1;
+        while (*cursor == '/')
+        {
+            *cursor++ = '\0';
+        }
+        if (*cursor != '\0')
+        {
+            components[state.count++] = cursor;
+        }
+        while (*cursor != '\0' && *cursor != '/')
+        {
+            cursor++;
+        }
     }
 
-    dir_entry->mount_point = NULL;
-    dir_entry->fs_file = NULL;
+    // the components before the first wildcard are resolved directly
+    int first = 0;
+    while (first < state.count - 1 && components[first][glob_literal_length(components[first])] == '\0')
+    {
+        first++;
+    }
+    size_t base_length = 0;
+    base[base_length++] = '/';
+    for (int i = 0; i < first; i++)
+    {
+        size_t component_length = strlen(components[i]);
+        memcpy(base + base_length, components[i], component_length);
+        base_length += component_length;
+        base[base_length++] = '/';
+    }
+    base[(base_length > 1) ? base_length - 1 : base_length] = '\0';
 
-    DMOD_LOG_INFO("Directory closed successfully\n");
-    unlock_mutex();
-    return 0;
+    if (state.count > 0)
+    {
+        glob_push(&state, base, first);
+    }
+    while (state.stack != NULL)
+    {
+        walk_node_t* node = state.stack;
+        state.stack = node->next;
+        if (!state.stop && !state.failed)
+        {
+            glob_directory(&state, node);
+        }
+        vfs_free(node);
+    }
+
+    vfs_free(base);
+    vfs_free(components);
+    vfs_free(abs_pattern);
+    if (state.failed)
+    {
+        DMOD_LOG_ERROR("Failed to search for pattern '%s'\n", pattern);
+        return -1;
+    }
+    return state.matches;
 }
+
 /**
- * @brief Check if a directory exists in DMVFS
+ * @brief Get the current working directory in DMVFS
  *
- * This function checks if a directory exists at the specified path.
- * It resolves the mount point for the directory and invokes the file system's direxists function.
+ * This function retrieves the current working directory and copies it to the provided buffer.
  *
- * @param path Path to the directory
- * @return 1 if the directory exists, 0 if it does not exist, -1 on error
+ * @param buffer Buffer to store the current working directory
+ * @param size Size of the buffer
+ * @return 0 on success, -1 on failure (e.g., buffer too small or DMVFS not initialized)
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _direxists, (const char* path))
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _getcwd, (char* buffer, size_t size))
 {
-    if (!is_initialized() || path == NULL)
+    if (!is_initialized() || buffer == NULL || size == 0)
     {
-        DMOD_LOG_ERROR("DMVFS is not initialized or path is NULL\n");
+        DMOD_LOG_ERROR("DMVFS is not initialized or invalid arguments to _getcwd\n");
         return -1;
     }
 
@@ -2198,55 +9020,36 @@ DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _direxists, (const char* path))
         return -1;
     }
 
-    char* abs_path = to_absolute_path(path);
-    if (!abs_path)
-    {
-        DMOD_LOG_ERROR("Failed to resolve absolute path for '%s'\n", path);
-        unlock_mutex();
-        return -1;
-    }
-
-    mount_point_t* mp_entry = get_mount_point_for_path(abs_path);
-    if (!mp_entry)
-    {
-        DMOD_LOG_ERROR("No mount point found for path '%s'\n", abs_path);
-        Dmod_Free((void*)abs_path);
-        unlock_mutex();
-        return -1;
-    }
-
-    dmod_dmfsi_direxists_t direxists_func = (dmod_dmfsi_direxists_t)Dmod_GetDifFunction(
-        mp_entry->fs_context, dmod_dmfsi_direxists_sig);
-
-    if (!direxists_func)
+    const cwd_t* cwd = current_cwd();
+    if (strlen(cwd->path) + 1 > size)
     {
-        DMOD_LOG_ERROR("File system does not support direxists for path '%s'\n", abs_path);
-        Dmod_Free((void*)abs_path);
+        DMOD_LOG_ERROR("Buffer too small for current working directory\n");
         unlock_mutex();
         return -1;
     }
 
-    int result = direxists_func(mp_entry->mount_context, abs_path + strlen(mp_entry->mount_point));
-    Dmod_Free((void*)abs_path);
+    strcpy(buffer, cwd->path);
     unlock_mutex();
-
-    return result;
+    return 0;
 }
 
 /**
- * @brief Get the current working directory in DMVFS
+ * @brief Get the working directory of a process in DMVFS
  *
- * This function retrieves the current working directory and copies it to the provided buffer.
+ * This function retrieves the working directory used by the given process
+ * (the global one if the process did not set its own) and copies it to the
+ * provided buffer.
  *
- * @param buffer Buffer to store the current working directory
+ * @param buffer Buffer to store the working directory
  * @param size Size of the buffer
+ * @param pid Process ID
  * @return 0 on success, -1 on failure (e.g., buffer too small or DMVFS not initialized)
  */
-DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _getcwd, (char* buffer, size_t size))
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _getcwd_process, (char* buffer, size_t size, int pid))
 {
     if (!is_initialized() || buffer == NULL || size == 0)
     {
-        DMOD_LOG_ERROR("DMVFS is not initialized or invalid arguments to _getcwd\n");
+        DMOD_LOG_ERROR("DMVFS is not initialized or invalid arguments to _getcwd_process\n");
         return -1;
     }
 
@@ -2256,14 +9059,15 @@ DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _getcwd, (char* buffer, size_t size)
         return -1;
     }
 
-    if (strlen(g_cwd) + 1 > size)
+    const cwd_t* cwd = get_cwd(pid);
+    if (strlen(cwd->path) + 1 > size)
     {
-        DMOD_LOG_ERROR("Buffer too small for current working directory\n");
+        DMOD_LOG_ERROR("Buffer too small for working directory of process ID %d\n", pid);
         unlock_mutex();
         return -1;
     }
 
-    strcpy(buffer, g_cwd);
+    strcpy(buffer, cwd->path);
     unlock_mutex();
     return 0;
 }
@@ -2349,14 +9153,15 @@ DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _toabs, (const char* path, char* abs
             return -1;
         }
 
-        if (g_cwd == NULL)
+        const cwd_t* cwd = current_cwd();
+        if (cwd->path == NULL)
         {
             DMOD_LOG_ERROR("CWD is NULL\n");
             unlock_mutex();
             return -1;
         }
 
-        size_t cwd_len = strlen(g_cwd);
+        size_t cwd_len = strlen(cwd->path);
         size_t path_len = strlen(path);
 
         if (cwd_len + 1 + path_len + 1 > size)
@@ -2366,7 +9171,7 @@ DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _toabs, (const char* path, char* abs
             return -1;
         }
 
-        strncpy(abs_path, g_cwd, size - 1);
+        strncpy(abs_path, cwd->path, size - 1);
         abs_path[size - 1] = '\0';
         strncat(abs_path, "/", size - strlen(abs_path) - 1);
         strncat(abs_path, path, size - strlen(abs_path) - 1);
@@ -2374,4 +9179,256 @@ DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _toabs, (const char* path, char* abs
     }
 
     return 0;
-}
\ No newline at end of file
+}
+/**
+ * @brief Set the clock source used by DMVFS
+ *
+ * The clock is used to timestamp trace records and to measure the duration
+ * of backend calls. It must be monotonic and return microseconds.
+ *
+ * @param clock Clock function (NULL to disable time measurement)
+ * @return true on success, false on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, bool, _set_clock, (dmvfs_clock_t clock))
+{
+    g_clock = clock;
+    return true;
+}
+
+/**
+ * @brief Set the function used to sleep
+ *
+ * Reads and writes that exceed the throttling limits sleep with this function
+ * until the tokens are refilled. Without it they fail with DMVFS_ERR_AGAIN.
+ * The internal locks that have no mutex to block on also sleep with it for
+ * a microsecond after spinning for a while, to let a preempted owner run.
+ *
+ * @param sleep Sleep function (NULL to fail throttled requests at once)
+ * @return true on success, false on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, bool, _set_sleep, (dmvfs_sleep_t sleep))
+{
+    g_sleep = sleep;
+    return true;
+}
+
+/**
+ * @brief Set the function that returns the ID of the calling process
+ *
+ * Once it is set, dmvfs_chdir() and dmvfs_getcwd() work on the working
+ * directory of the calling process, and all calls that accept a path
+ * resolve relative paths against it, so a dmvfs_chdir() of one process does
+ * not move the others. Processes that never changed their directory use the
+ * global one.
+ *
+ * @param getpid Function returning the calling process ID (NULL to use the global working directory)
+ * @return true on success, false on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, bool, _set_getpid, (dmvfs_getpid_t getpid))
+{
+    g_getpid = getpid;
+    return true;
+}
+
+/**
+ * @brief Start recording operations in the trace ring buffer
+ *
+ * The function allocates a ring buffer for the given number of records
+ * (rounded up to a power of two) and enables tracing. When the buffer is
+ * full the oldest records are overwritten. Starting the trace again clears
+ * the previously captured records.
+ *
+ * Operations can record while the trace is restarted, so a replaced ring is
+ * kept (and reused for the same capacity) until dmvfs_deinit().
+ *
+ * @param capacity Number of records in the ring buffer
+ * @return true on success, false on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, bool, _trace_start, (size_t capacity))
+{
+    if (!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return false;
+    }
+
+    if (capacity == 0 || capacity > 0x80000000u)
+    {
+        DMOD_LOG_ERROR("Invalid trace capacity: %zu\n", capacity);
+        return false;
+    }
+
+    uint32_t rounded = 1;
+    while (rounded < capacity)
+    {
+        rounded <<= 1;
+    }
+
+    // On 32-bit targets the size of a large ring does not fit in size_t
+    size_t max_records = (SIZE_MAX - sizeof(trace_ring_t)) / sizeof(dmvfs_trace_entry_t);
+    if (rounded > max_records)
+    {
+        DMOD_LOG_ERROR("Trace capacity too large: %zu\n", capacity);
+        return false;
+    }
+
+    if(!lock_mutex())
+    {
+        DMOD_LOG_ERROR("Failed to lock DMVFS mutex\n");
+        return false;
+    }
+
+    __atomic_store_n(&g_trace_enabled, false, __ATOMIC_RELEASE);
+
+    trace_ring_t* ring = g_trace_rings;
+    while (ring != NULL && ring->capacity != rounded)
+    {
+        ring = ring->next;
+    }
+
+    if (ring == NULL)
+    {
+        ring = (trace_ring_t*)vfs_malloc(sizeof(trace_ring_t) + sizeof(dmvfs_trace_entry_t) * rounded);
+        if (ring == NULL)
+        {
+            DMOD_LOG_ERROR("Failed to allocate memory for trace buffer\n");
+            unlock_mutex();
+            return false;
+        }
+        ring->capacity = rounded;
+        ring->next = g_trace_rings;
+        g_trace_rings = ring;
+    }
+
+    memset(ring->entries, 0, sizeof(dmvfs_trace_entry_t) * rounded);
+    __atomic_store_n(&g_trace_head, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_trace_ring, ring, __ATOMIC_RELEASE);
+    __atomic_store_n(&g_trace_enabled, true, __ATOMIC_RELEASE);
+
+    unlock_mutex();
+    DMOD_LOG_INFO("Tracing started with %u records\n", (unsigned)rounded);
+    return true;
+}
+
+/**
+ * @brief Stop recording operations
+ *
+ * The captured records are kept and can still be read or saved.
+ *
+ * @return true on success, false if tracing was not started
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, bool, _trace_stop, (void))
+{
+    if (!is_initialized())
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized\n");
+        return false;
+    }
+
+    if (__atomic_load_n(&g_trace_ring, __ATOMIC_ACQUIRE) == NULL)
+    {
+        DMOD_LOG_WARN("Tracing is not started\n");
+        return false;
+    }
+
+    __atomic_store_n(&g_trace_enabled, false, __ATOMIC_RELEASE);
+    DMOD_LOG_INFO("Tracing stopped\n");
+    return true;
+}
+
+/**
+ * @brief Read records from the trace ring buffer
+ *
+ * The function copies the newest records (oldest first) without stopping
+ * the trace. Records that are being written at the moment are skipped.
+ *
+ * @param entries Array to store the records
+ * @param max_entries Size of the array
+ * @return Number of records copied, or -1 on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _trace_read, (dmvfs_trace_entry_t* entries, size_t max_entries))
+{
+    if (!is_initialized() || entries == NULL || max_entries == 0)
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized or invalid arguments to _trace_read\n");
+        return -1;
+    }
+
+    const trace_ring_t* ring = __atomic_load_n(&g_trace_ring, __ATOMIC_ACQUIRE);
+    if (ring == NULL)
+    {
+        DMOD_LOG_ERROR("Tracing is not started\n");
+        return -1;
+    }
+
+    return (int)trace_copy(ring, entries, max_entries, NULL);
+}
+
+/**
+ * @brief Save the trace to a file
+ *
+ * The function writes a dmvfs_trace_header_t followed by the captured records
+ * to the given path. Tracing is paused while the file is written so that the
+ * trace does not record its own I/O.
+ *
+ * @param path Path of the file to create
+ * @return Number of saved records, or -1 on failure
+ */
+DMOD_INPUT_API_DECLARATION(dmvfs, 1.0, int, _trace_save, (const char* path))
+{
+    if (!is_initialized() || path == NULL)
+    {
+        DMOD_LOG_ERROR("DMVFS is not initialized or path is NULL\n");
+        return -1;
+    }
+
+    const trace_ring_t* ring = __atomic_load_n(&g_trace_ring, __ATOMIC_ACQUIRE);
+    if (ring == NULL)
+    {
+        DMOD_LOG_ERROR("Tracing is not started\n");
+        return -1;
+    }
+
+    bool was_enabled = __atomic_exchange_n(&g_trace_enabled, false, __ATOMIC_ACQ_REL);
+
+    size_t buffer_size = sizeof(dmvfs_trace_header_t) + sizeof(dmvfs_trace_entry_t) * ring->capacity;
+    uint8_t* buffer = (uint8_t*)vfs_malloc(buffer_size);
+    if (buffer == NULL)
+    {
+        DMOD_LOG_ERROR("Failed to allocate memory for trace file\n");
+        __atomic_store_n(&g_trace_enabled, was_enabled, __ATOMIC_RELEASE);
+        return -1;
+    }
+
+    dmvfs_trace_header_t* header = (dmvfs_trace_header_t*)buffer;
+    dmvfs_trace_entry_t* entries = (dmvfs_trace_entry_t*)(buffer + sizeof(dmvfs_trace_header_t));
+    uint32_t dropped = 0;
+    size_t count = trace_copy(ring, entries, ring->capacity, &dropped);
+
+    header->magic = DMVFS_TRACE_MAGIC;
+    header->version = DMVFS_TRACE_VERSION;
+    header->entry_size = sizeof(dmvfs_trace_entry_t);
+    header->count = (uint32_t)count;
+    header->dropped = dropped;
+
+    void* fp = NULL;
+    size_t to_write = sizeof(dmvfs_trace_header_t) + sizeof(dmvfs_trace_entry_t) * count;
+    size_t written = 0;
+    int result = dmvfs_fopen(&fp, path, DMFSI_O_CREAT | DMFSI_O_WRONLY | DMFSI_O_TRUNC, 0, 0);
+    if (result == 0)
+    {
+        result = dmvfs_fwrite(fp, buffer, to_write, &written);
+        dmvfs_fclose(fp);
+    }
+    vfs_free(buffer);
+    __atomic_store_n(&g_trace_enabled, was_enabled, __ATOMIC_RELEASE);
+
+    if (result != 0 || written != to_write)
+    {
+        DMOD_LOG_ERROR("Failed to save trace to '%s'\n", path);
+        return -1;
+    }
+
+    DMOD_LOG_INFO("Saved %zu trace records to '%s'\n", count, path);
+    return (int)count;
+}
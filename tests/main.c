@@ -16,6 +16,7 @@ static TestResults test_results = {0};
 static bool read_only_mode = false;
 static const char* test_file_path = NULL;
 static const char* test_dir_path = NULL;
+static const char* test_module_name = NULL;
 
 // -----------------------------------------
 //
@@ -504,6 +505,1343 @@ bool test_directory_creation_and_listing(void)
     return true;
 }
 
+// -----------------------------------------
+//
+//      Test: Per-process working directory
+//
+// -----------------------------------------
+static int test_pid = 0;
+
+static int test_getpid(void)
+{
+    return test_pid;
+}
+
+bool test_process_cwd(void)
+{
+    TEST_START("Per-process working directory");
+
+    if (dmvfs_mkdir("/mnt/pcwd", 0) != DMFSI_OK) {
+        TEST_FAIL("Cannot create directory");
+        return false;
+    }
+
+    if (dmvfs_chdir_process("/mnt/pcwd", 5) != 0) {
+        TEST_FAIL("Cannot change working directory of the process");
+        return false;
+    }
+
+    char cwd[64];
+    char global_cwd[64];
+    if (dmvfs_getcwd_process(cwd, sizeof(cwd), 5) != 0 || strcmp(cwd, "/mnt/pcwd") != 0 ||
+        dmvfs_getcwd(global_cwd, sizeof(global_cwd)) != 0 || strcmp(global_cwd, "/mnt/pcwd") == 0) {
+        dmvfs_chdir_process(NULL, 5);
+        TEST_FAIL("Working directory of the process is not separated");
+        return false;
+    }
+
+    void* fp = NULL;
+    int ret = dmvfs_fopen(&fp, "relative.txt", DMFSI_O_CREAT | DMFSI_O_WRONLY, 0, 5);
+    if (ret != DMFSI_OK || fp == NULL) {
+        dmvfs_chdir_process(NULL, 5);
+        TEST_FAIL("Cannot open relative path of the process");
+        return false;
+    }
+    dmvfs_fclose(fp);
+
+    dmfsi_stat_t stat;
+    ret = dmvfs_stat("/mnt/pcwd/relative.txt", &stat);
+    dmvfs_unlink("/mnt/pcwd/relative.txt");
+    dmvfs_chdir_process(NULL, 5);
+    if (ret != DMFSI_OK) {
+        TEST_FAIL("File not created in the working directory of the process");
+        return false;
+    }
+
+    if (dmvfs_getcwd_process(cwd, sizeof(cwd), 5) != 0 || strcmp(cwd, global_cwd) != 0) {
+        TEST_FAIL("Process doesn't use global working directory after release");
+        return false;
+    }
+
+    // With the calling process known, every path call and chdir are per process
+    dmvfs_set_getpid(test_getpid);
+    test_pid = 6;
+    bool chdir_ok = dmvfs_chdir("/mnt/pcwd") == 0;
+    bool mkdir_ok = dmvfs_mkdir("sub", 0) == DMFSI_OK;
+    test_pid = 7;
+    bool other_ok = dmvfs_direxists("sub") != 1 && dmvfs_getcwd(cwd, sizeof(cwd)) == 0 && strcmp(cwd, global_cwd) == 0;
+    test_pid = 6;
+    void* dp = NULL;
+    bool own_ok = dmvfs_direxists("sub") == 1 && dmvfs_opendir(&dp, "sub") == DMFSI_OK;
+    if (dp != NULL) {
+        dmvfs_closedir(dp);
+    }
+    own_ok = own_ok && dmvfs_rmdir("sub") == DMFSI_OK;
+    dmvfs_set_getpid(NULL);
+    dmvfs_chdir_process(NULL, 6);
+    dmvfs_rmdir("/mnt/pcwd/sub");
+    if (!chdir_ok || !mkdir_ok || !other_ok || !own_ok) {
+        TEST_FAIL("Path calls do not use the working directory of the calling process");
+        return false;
+    }
+
+    TEST_PASS();
+    return true;
+}
+
+// -----------------------------------------
+//
+//      Test: Trace ring buffer
+//
+// -----------------------------------------
+static uint64_t test_clock_us = 0;
+static uint64_t test_clock(void)
+{
+    test_clock_us += 10;
+    return test_clock_us;
+}
+
+bool test_trace_capture(void)
+{
+    TEST_START("Trace capture");
+    dmvfs_set_clock(test_clock);
+
+    if (!dmvfs_trace_start(16)) {
+        TEST_FAIL("Cannot start trace");
+        return false;
+    }
+
+    void* fp = NULL;
+    size_t written = 0;
+    int ret = dmvfs_fopen(&fp, "/mnt/trace_test.txt", DMFSI_O_CREAT | DMFSI_O_WRONLY, 0, 7);
+    if (ret != DMFSI_OK) {
+        dmvfs_trace_stop();
+        TEST_FAIL("Cannot open file");
+        return false;
+    }
+    dmvfs_fwrite(fp, "trace", 5, &written);
+    dmvfs_lseek(fp, -2, DMFSI_SEEK_CUR);
+    dmvfs_fclose(fp);
+    dmvfs_trace_stop();
+
+    dmvfs_trace_entry_t entries[16];
+    int count = dmvfs_trace_read(entries, 16);
+    bool found_write = false;
+    bool found_seek = false;
+    for (int i = 0; i < count; i++) {
+        if (entries[i].op == DMVFS_TRACE_OP_FWRITE && entries[i].size == 5 &&
+            entries[i].arg == 5 && entries[i].pid == 7 && entries[i].duration > 0) {
+            found_write = true;
+        }
+        if (entries[i].op == DMVFS_TRACE_OP_LSEEK && entries[i].offset == -2 &&
+            entries[i].arg == DMFSI_SEEK_CUR) {
+            found_seek = true;
+        }
+    }
+    if (count < 4 || entries[0].op != DMVFS_TRACE_OP_FOPEN || !found_write || !found_seek) {
+        dmvfs_unlink("/mnt/trace_test.txt");
+        TEST_FAIL("Trace records don't match performed operations");
+        return false;
+    }
+
+    int saved = dmvfs_trace_save("/mnt/trace.bin");
+    dmfsi_stat_t stat;
+    if (saved != count || dmvfs_stat("/mnt/trace.bin", &stat) != DMFSI_OK ||
+        stat.size != sizeof(dmvfs_trace_header_t) + saved * sizeof(dmvfs_trace_entry_t)) {
+        dmvfs_unlink("/mnt/trace_test.txt");
+        dmvfs_unlink("/mnt/trace.bin");
+        TEST_FAIL("Cannot save trace");
+        return false;
+    }
+
+    dmvfs_unlink("/mnt/trace_test.txt");
+    dmvfs_unlink("/mnt/trace.bin");
+    TEST_PASS();
+    return true;
+}
+
+// -----------------------------------------
+//
+//      Test: Mount capabilities
+//
+// -----------------------------------------
+bool test_mount_caps(void)
+{
+    TEST_START("Mount capabilities");
+
+    dmvfs_mount_ops_t ops = {0};
+    if (!dmvfs_get_mount_ops("/mnt", &ops) || ops.caps != 0) {
+        TEST_FAIL("Unexpected default capabilities");
+        return false;
+    }
+
+    ops.caps = DMVFS_CAP_THREAD_SAFE;
+    if (!dmvfs_set_mount_ops("/mnt", &ops)) {
+        TEST_FAIL("Cannot set capabilities");
+        return false;
+    }
+
+    void* fp = NULL;
+    size_t written = 0;
+    size_t read_bytes = 0;
+    char buffer[8] = {0};
+    int ret = dmvfs_fopen(&fp, "/mnt/caps.txt", DMFSI_O_CREAT | DMFSI_O_RDWR, 0, 0);
+    if (ret == DMFSI_OK && fp != NULL) {
+        dmvfs_fwrite(fp, "caps", 4, &written);
+        dmvfs_lseek(fp, 0, DMFSI_SEEK_SET);
+        dmvfs_fread(fp, buffer, 4, &read_bytes);
+        dmvfs_fclose(fp);
+    }
+    dmvfs_unlink("/mnt/caps.txt");
+
+    dmvfs_mount_ops_t current = {0};
+    bool caps_ok = dmvfs_get_mount_ops("/mnt", &current) && current.caps == DMVFS_CAP_THREAD_SAFE;
+    ops.caps = 0;
+    dmvfs_set_mount_ops("/mnt", &ops);
+
+    if (!caps_ok) {
+        TEST_FAIL("Capabilities not stored");
+        return false;
+    }
+
+    if (ret != DMFSI_OK || written != 4 || read_bytes != 4 || memcmp(buffer, "caps", 4) != 0) {
+        TEST_FAIL("I/O failed on thread safe mount");
+        return false;
+    }
+
+    TEST_PASS();
+    return true;
+}
+
+// -----------------------------------------
+//
+//      Test: Allocator statistics
+//
+// -----------------------------------------
+bool test_alloc_stats(void)
+{
+    TEST_START("Allocator statistics");
+
+    dmvfs_mkdir("/mnt/slab", 0);
+    dmvfs_mkdir("/mnt/slab/with_longer_name", 0);
+    if (dmvfs_chdir_process("/mnt/slab/with_longer_name", 9) != 0 ||
+        dmvfs_chdir_process("/mnt/slab", 9) != 0) {
+        dmvfs_chdir_process(NULL, 9);
+        TEST_FAIL("Cannot change working directory");
+        return false;
+    }
+
+    dmvfs_alloc_stats_t before;
+    dmvfs_alloc_stats_t after;
+    if (!dmvfs_get_alloc_stats(&before) || before.used_blocks == 0) {
+        dmvfs_chdir_process(NULL, 9);
+        TEST_FAIL("Cannot get allocator statistics");
+        return false;
+    }
+
+    for (int i = 0; i < 100; i++) {
+        dmvfs_chdir_process((i % 2) ? "/mnt/slab" : "/mnt/slab/with_longer_name", 9);
+    }
+
+    dmvfs_get_alloc_stats(&after);
+    dmvfs_chdir_process(NULL, 9);
+    if (after.used_blocks != before.used_blocks || after.slab_pages != before.slab_pages ||
+        after.allocations < before.allocations + 100) {
+        TEST_FAIL("Released blocks are not reused");
+        return false;
+    }
+
+    TEST_PASS();
+    return true;
+}
+
+// -----------------------------------------
+//
+//      Test: Static memory arena
+//
+// -----------------------------------------
+static uint64_t test_arena[1024];
+
+static bool restore_heap_mode(void)
+{
+    dmvfs_unmount_fs("/mnt");
+    dmvfs_deinit();
+    return dmvfs_set_arena(NULL, 0) && dmvfs_init(16, 32) &&
+           dmvfs_mount_fs(test_module_name, "/mnt", NULL);
+}
+
+bool test_static_arena(void)
+{
+    TEST_START("Static memory arena");
+
+    if (dmvfs_set_arena(test_arena, sizeof(test_arena))) {
+        TEST_FAIL("Arena changed while DMVFS is initialized");
+        return false;
+    }
+
+    dmvfs_unmount_fs("/mnt");
+    dmvfs_deinit();
+    if (!dmvfs_set_arena(test_arena, sizeof(test_arena)) || !dmvfs_init(4, 8) ||
+        !dmvfs_mount_fs(test_module_name, "/mnt", NULL)) {
+        restore_heap_mode();
+        TEST_FAIL("Cannot initialize DMVFS in an arena");
+        return false;
+    }
+
+    // Repeated changes of the working directory must reuse arena blocks
+    dmvfs_mkdir("/mnt/arena", 0);
+    dmvfs_mkdir("/mnt/arena_directory_with_longer_name", 0);
+    for (int i = 0; i < 1000; i++) {
+        if (dmvfs_chdir((i % 2) ? "/mnt/arena" : "/mnt/arena_directory_with_longer_name") != 0) {
+            restore_heap_mode();
+            TEST_FAIL("Cannot change working directory in arena mode");
+            return false;
+        }
+    }
+
+    void* fp = NULL;
+    size_t written = 0;
+    int ret = dmvfs_fopen(&fp, "arena.txt", DMFSI_O_CREAT | DMFSI_O_WRONLY, 0, 0);
+    if (ret == DMFSI_OK && fp != NULL) {
+        ret = dmvfs_fwrite(fp, "arena", 5, &written);
+        dmvfs_fclose(fp);
+    }
+    dmvfs_unlink("/mnt/arena/arena.txt");
+    dmvfs_rmdir("/mnt/arena");
+    dmvfs_rmdir("/mnt/arena_directory_with_longer_name");
+
+    if (!restore_heap_mode()) {
+        TEST_FAIL("Cannot go back to heap mode");
+        return false;
+    }
+
+    if (ret != DMFSI_OK || written != 5) {
+        TEST_FAIL("File operations failed in arena mode");
+        return false;
+    }
+
+    TEST_PASS();
+    return true;
+}
+
+// -----------------------------------------
+//
+//      Test: Unmount modes
+//
+// -----------------------------------------
+bool test_unmount_modes(void)
+{
+    TEST_START("Unmount modes");
+
+    void* fp = NULL;
+    size_t written = 0;
+    if (!dmvfs_mount_fs(test_module_name, "/umnt", NULL)) {
+        TEST_FAIL("Cannot mount second instance");
+        return false;
+    }
+    if (dmvfs_fopen(&fp, "/umnt/busy.txt", DMFSI_O_CREAT | DMFSI_O_RDWR, 0, 0) != DMFSI_OK) {
+        dmvfs_unmount_fs("/umnt");
+        TEST_FAIL("Cannot open file on second instance");
+        return false;
+    }
+
+    // A plain unmount must not pull the file system from under an open file
+    if (dmvfs_unmount_fs_ex("/umnt", 0)) {
+        TEST_FAIL("Busy mount point was unmounted");
+        return false;
+    }
+
+    // A lazy unmount hides the mount point, but the open file keeps working
+    if (!dmvfs_unmount_fs_ex("/umnt", DMVFS_UNMOUNT_LAZY)) {
+        dmvfs_fclose(fp);
+        dmvfs_unmount_fs("/umnt");
+        TEST_FAIL("Lazy unmount failed");
+        return false;
+    }
+    void* other = NULL;
+    bool hidden = dmvfs_fopen(&other, "/umnt/other.txt", DMFSI_O_CREAT | DMFSI_O_RDWR, 0, 0) != DMFSI_OK &&
+                  !dmvfs_unmount_fs("/umnt");
+    int ret = dmvfs_fwrite(fp, "lazy", 4, &written);
+    dmvfs_fclose(fp);
+    if (!hidden || ret != DMFSI_OK || written != 4) {
+        TEST_FAIL("Lazily unmounted file system is not detached correctly");
+        return false;
+    }
+
+    // A forced unmount invalidates the open handles at once
+    fp = NULL;
+    if (!dmvfs_mount_fs(test_module_name, "/umnt", NULL) ||
+        dmvfs_fopen(&fp, "/umnt/force.txt", DMFSI_O_CREAT | DMFSI_O_RDWR, 0, 0) != DMFSI_OK) {
+        dmvfs_unmount_fs("/umnt");
+        TEST_FAIL("Cannot remount second instance");
+        return false;
+    }
+    if (!dmvfs_unmount_fs_ex("/umnt", DMVFS_UNMOUNT_FORCE)) {
+        TEST_FAIL("Forced unmount failed");
+        return false;
+    }
+    if (dmvfs_fwrite(fp, "force", 5, &written) == DMFSI_OK) {
+        dmvfs_fclose(fp);
+        TEST_FAIL("Handle still usable after forced unmount");
+        return false;
+    }
+    dmvfs_fclose(fp);
+
+    TEST_PASS();
+    return true;
+}
+
+// -----------------------------------------
+//
+//      Test: I/O scheduler
+//
+// -----------------------------------------
+bool test_io_sched(void)
+{
+    TEST_START("I/O scheduler");
+
+    dmvfs_io_sched_t sched = { 1, { 0, 0, 0 } };
+    if (!dmvfs_set_io_sched("/mnt", &sched)) {
+        TEST_FAIL("Cannot enable I/O scheduler");
+        return false;
+    }
+    if (dmvfs_set_io_class(0, DMVFS_IO_CLASSES) || !dmvfs_set_io_class(0, DMVFS_IO_CLASS_IDLE)) {
+        TEST_FAIL("I/O class of a process not validated");
+        return false;
+    }
+
+    void* fp = NULL;
+    size_t written = 0;
+    size_t read_bytes = 0;
+    char buffer[5] = {0};
+    int ret = dmvfs_fopen(&fp, "/mnt/sched.txt", DMFSI_O_CREAT | DMFSI_O_RDWR, 0, 0);
+    if (ret == DMFSI_OK && fp != NULL) {
+        dmvfs_set_file_io_class(fp, DMVFS_IO_CLASS_RT);
+        dmvfs_fwrite(fp, "sched", 5, &written);
+        dmvfs_lseek(fp, 0, DMFSI_SEEK_SET);
+        dmvfs_fread(fp, buffer, 5, &read_bytes);
+        dmvfs_fclose(fp);
+    }
+    dmvfs_unlink("/mnt/sched.txt");
+
+    dmvfs_io_sched_stats_t stats = {0};
+    bool stats_ok = dmvfs_get_io_sched_stats("/mnt", &stats);
+    sched.max_active = 0;
+    dmvfs_set_io_sched("/mnt", &sched);
+    dmvfs_set_io_class(0, -1);
+
+    if (ret != DMFSI_OK || written != 5 || read_bytes != 5 || memcmp(buffer, "sched", 5) != 0) {
+        TEST_FAIL("I/O failed with the scheduler enabled");
+        return false;
+    }
+    if (!stats_ok || stats.requests < 2 || stats.delayed != 0 || stats.queue_depth != 0) {
+        TEST_FAIL("Unexpected scheduler statistics");
+        return false;
+    }
+
+    TEST_PASS();
+    return true;
+}
+
+// -----------------------------------------
+//
+//      Test: I/O throttling
+//
+// -----------------------------------------
+static uint64_t test_slept_us = 0;
+static void test_sleep(uint64_t us)
+{
+    // Advance the test clock instead of blocking
+    test_slept_us += us;
+    test_clock_us += us;
+}
+
+bool test_throttle(void)
+{
+    TEST_START("I/O throttling");
+
+    dmvfs_set_clock(test_clock);
+    dmvfs_throttle_t limits = { 0, 2, 0, 1 };
+    if (!dmvfs_set_throttle(11, &limits)) {
+        TEST_FAIL("Cannot set throttling limits");
+        return false;
+    }
+
+    void* fp = NULL;
+    size_t written = 0;
+    int again = DMFSI_OK;
+    bool send_again = false;
+    int ret = dmvfs_fopen(&fp, "/mnt/throttle.txt", DMFSI_O_CREAT | DMFSI_O_WRONLY, 0, 11);
+    uint64_t start = test_clock_us;
+    test_slept_us = 0;
+    if (ret == DMFSI_OK && fp != NULL) {
+        // Without a sleep function the request over the limit fails at once
+        ret = dmvfs_fwrite(fp, "x", 1, &written);
+        again = dmvfs_fwrite(fp, "x", 1, &written);
+
+        // A sendfile into the throttled file is held off the same way
+        void* src = NULL;
+        if (dmvfs_fopen(&src, "/mnt/throttle_src.txt", DMFSI_O_CREAT | DMFSI_O_RDWR, 0, 0) == DMFSI_OK && src != NULL) {
+            size_t sent = 0;
+            dmvfs_fwrite(src, "y", 1, &written);
+            dmvfs_lseek(src, 0, DMFSI_SEEK_SET);
+            send_again = dmvfs_sendfile(fp, src, NULL, 1, &sent) == DMVFS_ERR_AGAIN && sent == 0 && dmvfs_ftell(src) == 0;
+            dmvfs_fclose(src);
+        }
+
+        dmvfs_set_sleep(test_sleep);
+        for (int i = 0; i < 2 && ret == DMFSI_OK; i++) {
+            ret = dmvfs_fwrite(fp, "x", 1, &written);
+        }
+        dmvfs_set_sleep(NULL);
+        dmvfs_fclose(fp);
+    }
+    uint64_t elapsed = test_clock_us - start;
+    dmvfs_set_throttle(11, NULL);
+    dmvfs_unlink("/mnt/throttle.txt");
+    dmvfs_unlink("/mnt/throttle_src.txt");
+
+    if (ret != DMFSI_OK) {
+        TEST_FAIL("Throttled writes failed");
+        return false;
+    }
+    if (again != DMVFS_ERR_AGAIN) {
+        TEST_FAIL("Write over the limit did not fail without a sleep function");
+        return false;
+    }
+    if (!send_again) {
+        TEST_FAIL("Sendfile over the limit did not fail or moved the source position");
+        return false;
+    }
+    // 2 operations per second with a burst of 1: the 2nd and 3rd writes sleep 0.5 s each
+    if (elapsed < 1000000 || test_slept_us == 0) {
+        TEST_FAIL("Writes were not throttled");
+        return false;
+    }
+
+    TEST_PASS();
+    return true;
+}
+
+// -----------------------------------------
+//
+//      Test: Write coalescing
+//
+// -----------------------------------------
+bool test_write_coalescing(void)
+{
+    TEST_START("Write coalescing");
+
+    dmvfs_coalesce_t config = { 16, 64 };
+    if (!dmvfs_set_write_coalescing("/mnt", &config)) {
+        TEST_FAIL("Cannot enable write coalescing");
+        return false;
+    }
+
+    // 40 writes of 5 bytes = 3 full erase blocks and 8 bytes flushed on close
+    void* fp = NULL;
+    size_t written = 0;
+    int ret = dmvfs_fopen(&fp, "/mnt/coalesce.txt", DMFSI_O_CREAT | DMFSI_O_WRONLY | DMFSI_O_TRUNC, 0, 0);
+    if (ret == DMFSI_OK && fp != NULL) {
+        for (int i = 0; i < 40 && ret == DMFSI_OK; i++) {
+            ret = dmvfs_fwrite(fp, "01234", 5, &written);
+        }
+        dmvfs_fclose(fp);
+    }
+
+    dmvfs_coalesce_stats_t stats = {0};
+    bool stats_ok = dmvfs_get_write_coalescing_stats("/mnt", &stats);
+    dmvfs_set_write_coalescing("/mnt", NULL);
+
+    dmfsi_stat_t stat = {0};
+    char buffer[5] = {0};
+    size_t read_bytes = 0;
+    bool content_ok = dmvfs_stat("/mnt/coalesce.txt", &stat) == DMFSI_OK && stat.size == 200;
+    if (content_ok && dmvfs_fopen(&fp, "/mnt/coalesce.txt", DMFSI_O_RDONLY, 0, 0) == DMFSI_OK) {
+        dmvfs_lseek(fp, 195, DMFSI_SEEK_SET);
+        dmvfs_fread(fp, buffer, 5, &read_bytes);
+        dmvfs_fclose(fp);
+        content_ok = read_bytes == 5 && memcmp(buffer, "01234", 5) == 0;
+    }
+    dmvfs_unlink("/mnt/coalesce.txt");
+
+    if (ret != DMFSI_OK || !content_ok) {
+        TEST_FAIL("Coalesced data not written correctly");
+        return false;
+    }
+    if (!stats_ok || stats.writes != 40 || stats.bytes != 200 || stats.backend_bytes != 200 ||
+        stats.backend_writes != 4 || stats.aligned_writes != 3 || stats.partial_flushes != 1) {
+        TEST_FAIL("Unexpected write coalescing statistics");
+        return false;
+    }
+
+    TEST_PASS();
+    return true;
+}
+
+bool test_bounce_pool(void)
+{
+    TEST_START("Bounce buffer pool");
+
+    if (!dmvfs_set_bounce_pool(2, 64, 32)) {
+        TEST_FAIL("Cannot set up bounce buffer pool");
+        return false;
+    }
+    dmvfs_mount_ops_t ops = {0};
+    ops.caps = DMVFS_CAP_ALIGNED_IO;
+    ops.alignment = 32;
+    dmvfs_set_mount_ops("/mnt", &ops);
+
+    // 150 bytes from an odd address - staged in chunks of 64 bytes
+    static uint8_t data[160];
+    static uint8_t check[160];
+    for (int i = 0; i < (int)sizeof(data); i++) {
+        data[i] = (uint8_t)i;
+    }
+    void* fp = NULL;
+    size_t written = 0;
+    size_t read_bytes = 0;
+    int ret = dmvfs_fopen(&fp, "/mnt/bounce.bin", DMFSI_O_CREAT | DMFSI_O_RDWR | DMFSI_O_TRUNC, 0, 0);
+    if (ret == DMFSI_OK && fp != NULL) {
+        ret = dmvfs_fwrite(fp, data + 1, 150, &written);
+        dmvfs_lseek(fp, 0, DMFSI_SEEK_SET);
+        if (ret == DMFSI_OK) {
+            ret = dmvfs_fread(fp, check + 3, 150, &read_bytes);
+        }
+        dmvfs_fclose(fp);
+    }
+    dmvfs_unlink("/mnt/bounce.bin");
+
+    // Buffers lent to a backend are aligned and go back to the pool
+    uint8_t* lent = dmvfs_bounce_alloc(64);
+    bool lent_ok = lent != NULL && ((uintptr_t)lent % 32) == 0 && dmvfs_bounce_alloc(65) == NULL;
+    dmvfs_bounce_stats_t stats = {0};
+    bool busy_ok = !dmvfs_set_bounce_pool(0, 0, 0);
+    dmvfs_bounce_free(lent);
+    bool stats_ok = dmvfs_get_bounce_stats(&stats);
+
+    ops.caps = 0;
+    ops.alignment = 0;
+    dmvfs_set_mount_ops("/mnt", &ops);
+    bool freed = dmvfs_set_bounce_pool(0, 0, 0);
+
+    if (ret != DMFSI_OK || written != 150 || read_bytes != 150 || memcmp(data + 1, check + 3, 150) != 0) {
+        TEST_FAIL("Staged data not transferred correctly");
+        return false;
+    }
+    if (!lent_ok || !busy_ok || !freed) {
+        TEST_FAIL("Bounce buffers not lent correctly");
+        return false;
+    }
+    if (!stats_ok || stats.buffers != 2 || stats.buffer_size != 64 || stats.staged != 2 ||
+        stats.staged_bytes != 300 || stats.lent != 1 || stats.in_use != 0) {
+        TEST_FAIL("Unexpected bounce buffer statistics");
+        return false;
+    }
+
+    TEST_PASS();
+    return true;
+}
+
+bool test_handle_cache(void)
+{
+    TEST_START("Open-handle cache");
+
+    if (!dmvfs_set_handle_cache(2)) {
+        TEST_FAIL("Cannot enable handle cache");
+        return false;
+    }
+
+    void* fp = NULL;
+    size_t bytes = 0;
+    char buffer[4] = {0};
+    bool data_ok = true;
+    if (dmvfs_fopen(&fp, "/mnt/cached.txt", DMFSI_O_CREAT | DMFSI_O_WRONLY | DMFSI_O_TRUNC, 0, 0) == DMFSI_OK) {
+        dmvfs_fwrite(fp, "abc", 3, &bytes);
+        dmvfs_fclose(fp);
+    }
+
+    // The second open reuses the handle of the first one, rewound to the start,
+    // also when the path is spelled differently
+    for (int i = 0; i < 2; i++) {
+        memset(buffer, 0, sizeof(buffer));
+        if (dmvfs_fopen(&fp, (i == 0) ? "/mnt/cached.txt" : "/mnt//./cached.txt", DMFSI_O_RDONLY, 0, 0) != DMFSI_OK) {
+            data_ok = false;
+            break;
+        }
+        dmvfs_fread(fp, buffer, 3, &bytes);
+        dmvfs_fclose(fp);
+        data_ok = data_ok && bytes == 3 && memcmp(buffer, "abc", 3) == 0;
+    }
+
+    // Opening for writing drops the cached handle, whatever the spelling of the path
+    dmvfs_handle_cache_stats_t dropped = {0};
+    if (dmvfs_fopen(&fp, "/mnt/sub/../cached.txt", DMFSI_O_WRONLY, 0, 0) == DMFSI_OK) {
+        dmvfs_fclose(fp);
+    }
+    bool dropped_ok = dmvfs_get_handle_cache_stats(&dropped) && dropped.cached == 0;
+    if (dmvfs_fopen(&fp, "/mnt/cached.txt", DMFSI_O_WRONLY | DMFSI_O_TRUNC, 0, 0) == DMFSI_OK) {
+        dmvfs_fwrite(fp, "xyz", 3, &bytes);
+        dmvfs_fclose(fp);
+    }
+    memset(buffer, 0, sizeof(buffer));
+    if (dmvfs_fopen(&fp, "/mnt/cached.txt", DMFSI_O_RDONLY, 0, 0) == DMFSI_OK) {
+        dmvfs_fread(fp, buffer, 3, &bytes);
+        dmvfs_fclose(fp);
+    }
+    data_ok = data_ok && bytes == 3 && memcmp(buffer, "xyz", 3) == 0;
+
+    dmvfs_handle_cache_stats_t stats = {0};
+    bool stats_ok = dmvfs_get_handle_cache_stats(&stats) && stats.cached == 1;
+    dmvfs_unlink("/mnt/cached.txt");
+    stats_ok = stats_ok && dmvfs_get_handle_cache_stats(&stats);
+    dmvfs_set_handle_cache(0);
+
+    if (!data_ok) {
+        TEST_FAIL("Cached handle returned wrong data");
+        return false;
+    }
+    if (!stats_ok || !dropped_ok || stats.cached != 0 || stats.hits != 1 || stats.misses != 2 || stats.invalidations != 2) {
+        TEST_FAIL("Unexpected handle cache statistics");
+        return false;
+    }
+
+    TEST_PASS();
+    return true;
+}
+
+bool test_at_operations(void)
+{
+    TEST_START("Directory-relative operations");
+
+    void* dp = NULL;
+    if (dmvfs_mkdir("/mnt/atdir", 0) != DMFSI_OK || dmvfs_opendir(&dp, "/mnt/atdir") != DMFSI_OK) {
+        dmvfs_rmdir("/mnt/atdir");
+        TEST_FAIL("Cannot open base directory");
+        return false;
+    }
+
+    void* fp = NULL;
+    size_t written = 0;
+    dmfsi_stat_t stat_at = {0};
+    dmfsi_stat_t stat_abs = {0};
+    int ret = dmvfs_mkdirat(dp, "sub", 0);
+    if (ret == DMFSI_OK) {
+        ret = dmvfs_openat(&fp, dp, "sub/at.txt", DMFSI_O_CREAT | DMFSI_O_WRONLY, 0, 0);
+    }
+    if (ret == DMFSI_OK && fp != NULL) {
+        dmvfs_fwrite(fp, "at", 2, &written);
+        dmvfs_fclose(fp);
+        ret = dmvfs_statat(dp, "sub/at.txt", &stat_at);
+    }
+    bool abs_ok = dmvfs_stat("/mnt/atdir/sub/at.txt", &stat_abs) == DMFSI_OK;
+    bool bad_ok = dmvfs_statat(fp, "sub/at.txt", &stat_at) != DMFSI_OK;
+    dmvfs_closedir(dp);
+
+    dmvfs_unlink("/mnt/atdir/sub/at.txt");
+    dmvfs_rmdir("/mnt/atdir/sub");
+    dmvfs_rmdir("/mnt/atdir");
+
+    if (ret != DMFSI_OK || !abs_ok || stat_at.size != 2 || stat_abs.size != 2) {
+        TEST_FAIL("Relative operations did not reach the directory");
+        return false;
+    }
+    if (!bad_ok) {
+        TEST_FAIL("File handle accepted as a directory");
+        return false;
+    }
+
+    TEST_PASS();
+    return true;
+}
+
+bool test_read_file(void)
+{
+    TEST_START("Whole-file read");
+
+    void* fp = NULL;
+    size_t written = 0;
+    if (dmvfs_fopen(&fp, "/mnt/whole.txt", DMFSI_O_CREAT | DMFSI_O_WRONLY | DMFSI_O_TRUNC, 0, 0) != DMFSI_OK) {
+        TEST_FAIL("Cannot create file");
+        return false;
+    }
+    dmvfs_fwrite(fp, "hello world", 11, &written);
+    dmvfs_fclose(fp);
+
+    // Buffer allocated by DMVFS
+    void* data = NULL;
+    size_t size = 0;
+    int ret = dmvfs_read_file("/mnt/whole.txt", &data, &size);
+    bool alloc_ok = ret == DMFSI_OK && data != NULL && size == 11 && strcmp((const char*)data, "hello world") == 0;
+    dmvfs_free_buffer(data);
+
+    // Buffer of the caller, smaller than the file - the size of the file is reported
+    char buffer[11];
+    void* user = buffer;
+    size_t user_size = 5;
+    ret = dmvfs_read_file("/mnt/whole.txt", &user, &user_size);
+    bool user_ok = ret == DMVFS_ERR_TOO_BIG && user == buffer && user_size == 11 && memcmp(buffer, "hello", 5) == 0;
+
+    // Buffer of the caller that fits the file exactly
+    user_size = sizeof(buffer);
+    ret = dmvfs_read_file("/mnt/whole.txt", &user, &user_size);
+    user_ok = user_ok && ret == DMFSI_OK && user_size == 11 && memcmp(buffer, "hello world", 11) == 0;
+
+    data = NULL;
+    bool missing_ok = dmvfs_read_file("/mnt/missing.txt", &data, &size) != DMFSI_OK && data == NULL;
+    dmvfs_unlink("/mnt/whole.txt");
+
+    if (!alloc_ok || !user_ok) {
+        TEST_FAIL("File content not read correctly");
+        return false;
+    }
+    if (!missing_ok) {
+        TEST_FAIL("Missing file was read");
+        return false;
+    }
+
+    TEST_PASS();
+    return true;
+}
+
+bool test_write_file_atomic(void)
+{
+    TEST_START("Atomic whole-file write");
+
+    int ret = dmvfs_write_file_atomic("/mnt/atomic.cfg", "v1", 2);
+    if (ret == DMFSI_OK) {
+        ret = dmvfs_write_file_atomic("/mnt/atomic.cfg", "version2", 8);
+    }
+
+    char buffer[16] = {0};
+    void* data = buffer;
+    size_t size = sizeof(buffer);
+    bool content_ok = ret == DMFSI_OK && dmvfs_read_file("/mnt/atomic.cfg", &data, &size) == DMFSI_OK &&
+                      size == 8 && memcmp(buffer, "version2", 8) == 0;
+    // The temporary files have unique names - none of them may be left in the directory
+    bool temp_gone = true;
+    void* dp = NULL;
+    if (dmvfs_opendir(&dp, "/mnt") == DMFSI_OK) {
+        dmfsi_dir_entry_t entry;
+        while (dmvfs_readdir(dp, &entry) == DMFSI_OK) {
+            if (strstr(entry.name, "atomic.cfg.") != NULL) {
+                temp_gone = false;
+            }
+        }
+        dmvfs_closedir(dp);
+    }
+    dmfsi_stat_t stat = {0};
+    dmvfs_unlink("/mnt/atomic.cfg");
+    bool replaced = dmvfs_stat("/mnt/atomic.cfg", &stat) != DMFSI_OK;
+
+    if (!content_ok) {
+        TEST_FAIL("File content not replaced");
+        return false;
+    }
+    if (!temp_gone || !replaced) {
+        TEST_FAIL("Temporary or old file left behind");
+        return false;
+    }
+
+    TEST_PASS();
+    return true;
+}
+
+bool test_copy_move(void)
+{
+    TEST_START("Copy and move between mounts");
+
+    if (!dmvfs_mount_fs(test_module_name, "/cpy", NULL)) {
+        TEST_FAIL("Cannot mount second file system");
+        return false;
+    }
+
+    static uint8_t data[3000];
+    for (int i = 0; i < (int)sizeof(data); i++) {
+        data[i] = (uint8_t)(i * 7);
+    }
+    int ret = dmvfs_write_file_atomic("/mnt/copy_src.bin", data, sizeof(data));
+
+    // Cross-mount copy keeps the source
+    dmvfs_copy_stats_t stats = {0};
+    if (ret == DMFSI_OK) {
+        ret = dmvfs_copy("/mnt/copy_src.bin", "/cpy/copy.bin", &stats);
+    }
+    bool copy_ok = ret == DMFSI_OK && stats.bytes == sizeof(data) && !stats.renamed;
+
+    // Copying a file onto itself is rejected instead of truncating the source
+    dmfsi_stat_t self_stat = {0};
+    bool self_ok = dmvfs_copy("/mnt/copy_src.bin", "/mnt//./copy_src.bin", NULL) != DMFSI_OK &&
+                   dmvfs_stat("/mnt/copy_src.bin", &self_stat) == DMFSI_OK && self_stat.size == sizeof(data);
+
+    // Same-mount move is a rename, cross-mount move removes the source
+    dmvfs_copy_stats_t rename_stats = {0};
+    bool move_ok = dmvfs_move("/cpy/copy.bin", "/cpy/moved.bin", &rename_stats) == DMFSI_OK && rename_stats.renamed &&
+                   dmvfs_move("/cpy/moved.bin", "/mnt/moved.bin", &stats) == DMFSI_OK && !stats.renamed;
+
+    static uint8_t check[3000];
+    void* buffer = check;
+    size_t size = sizeof(check);
+    dmfsi_stat_t stat = {0};
+    bool content_ok = dmvfs_read_file("/mnt/moved.bin", &buffer, &size) == DMFSI_OK && size == sizeof(data) &&
+                      memcmp(check, data, sizeof(data)) == 0;
+    bool source_gone = dmvfs_stat("/cpy/moved.bin", &stat) != DMFSI_OK && dmvfs_stat("/mnt/copy_src.bin", &stat) == DMFSI_OK;
+
+    dmvfs_unlink("/mnt/copy_src.bin");
+    dmvfs_unlink("/mnt/moved.bin");
+    dmvfs_unmount_fs("/cpy");
+
+    if (!copy_ok || !move_ok) {
+        TEST_FAIL("Copy or move failed");
+        return false;
+    }
+    if (!self_ok) {
+        TEST_FAIL("Copy of a file onto itself not rejected");
+        return false;
+    }
+    if (!content_ok || !source_gone) {
+        TEST_FAIL("Moved file has wrong content or source left behind");
+        return false;
+    }
+
+    TEST_PASS();
+    return true;
+}
+
+bool test_sendfile(void)
+{
+    TEST_START("Sendfile between handles");
+
+    void* in_fp = NULL;
+    void* out_fp = NULL;
+    if (dmvfs_write_file_atomic("/mnt/sf_in.txt", "0123456789", 10) != DMFSI_OK ||
+        dmvfs_fopen(&in_fp, "/mnt/sf_in.txt", DMFSI_O_RDONLY, 0, 0) != DMFSI_OK) {
+        TEST_FAIL("Cannot create input file");
+        return false;
+    }
+    if (dmvfs_fopen(&out_fp, "/mnt/sf_out.txt", DMFSI_O_CREAT | DMFSI_O_WRONLY | DMFSI_O_TRUNC, 0, 0) != DMFSI_OK) {
+        dmvfs_fclose(in_fp);
+        TEST_FAIL("Cannot create output file");
+        return false;
+    }
+
+    // With an offset the position of the input is kept
+    long offset = 2;
+    size_t sent = 0;
+    int ret = dmvfs_sendfile(out_fp, in_fp, &offset, 5, &sent);
+    bool offset_ok = ret == DMFSI_OK && sent == 5 && offset == 7 && dmvfs_ftell(in_fp) == 0;
+
+    // Without an offset the transfer stops at the end of the input
+    ret = dmvfs_sendfile(out_fp, in_fp, NULL, 100, &sent);
+    bool eof_ok = ret == DMFSI_OK && sent == 10;
+    dmvfs_fclose(in_fp);
+    dmvfs_fclose(out_fp);
+
+    char buffer[16] = {0};
+    void* data = buffer;
+    size_t size = sizeof(buffer);
+    bool content_ok = dmvfs_read_file("/mnt/sf_out.txt", &data, &size) == DMFSI_OK && size == 15 &&
+                      memcmp(buffer, "234560123456789", 15) == 0;
+    dmvfs_unlink("/mnt/sf_in.txt");
+    dmvfs_unlink("/mnt/sf_out.txt");
+
+    if (!offset_ok || !eof_ok) {
+        TEST_FAIL("Unexpected amount of transferred data");
+        return false;
+    }
+    if (!content_ok) {
+        TEST_FAIL("Transferred data is wrong");
+        return false;
+    }
+
+    TEST_PASS();
+    return true;
+}
+
+bool test_hash_file(void)
+{
+    TEST_START("File hashing");
+
+    static const uint8_t crc_check[4] = { 0xE3, 0x06, 0x92, 0x83 };
+    static const uint8_t sha_check[32] = {
+        0x24, 0x8d, 0x6a, 0x61, 0xd2, 0x06, 0x38, 0xb8, 0xe5, 0xc0, 0x26, 0x93, 0x0c, 0x3e, 0x60, 0x39,
+        0xa3, 0x3c, 0xe4, 0x59, 0x64, 0xff, 0x21, 0x67, 0xf6, 0xec, 0xed, 0xd4, 0x19, 0xdb, 0x06, 0xc1
+    };
+    const char* sha_input = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+
+    uint8_t digest[32] = {0};
+    int crc_len = -1;
+    int sha_len = -1;
+    bool crc_ok = false;
+    bool sha_ok = false;
+    if (dmvfs_write_file_atomic("/mnt/hash1.bin", "123456789", 9) == DMFSI_OK) {
+        crc_len = dmvfs_hash_file("/mnt/hash1.bin", DMVFS_HASH_CRC32C, digest, sizeof(digest));
+        crc_ok = crc_len == 4 && memcmp(digest, crc_check, 4) == 0;
+    }
+    if (dmvfs_write_file_atomic("/mnt/hash2.bin", sha_input, strlen(sha_input)) == DMFSI_OK) {
+        sha_len = dmvfs_hash_file("/mnt/hash2.bin", DMVFS_HASH_SHA256, digest, sizeof(digest));
+        sha_ok = sha_len == 32 && memcmp(digest, sha_check, 32) == 0;
+    }
+    bool small_ok = dmvfs_hash_file("/mnt/hash2.bin", DMVFS_HASH_SHA256, digest, 16) < 0;
+    dmvfs_unlink("/mnt/hash1.bin");
+    dmvfs_unlink("/mnt/hash2.bin");
+
+    if (!crc_ok || !sha_ok) {
+        TEST_FAIL("Wrong checksum or digest");
+        return false;
+    }
+    if (!small_ok) {
+        TEST_FAIL("Digest written to a too small buffer");
+        return false;
+    }
+
+    TEST_PASS();
+    return true;
+}
+
+typedef struct {
+    int calls;
+    int dirs;
+    int deep_depth;
+    const char* only;
+    const char* prune;
+    bool stop;
+} test_walk_t;
+
+static int test_walk_callback(const char* path, const dmfsi_dir_entry_t* entry, bool is_dir, int depth, void* arg)
+{
+    (void)entry;
+    test_walk_t* walk = (test_walk_t*)arg;
+    if (walk->only != NULL && depth == 1 && strcmp(path, walk->only) != 0) {
+        return DMVFS_WALK_PRUNE;
+    }
+    walk->calls++;
+    walk->dirs += is_dir ? 1 : 0;
+    if (strcmp(path, "/wlk/a/b/f3.txt") == 0 && !is_dir) {
+        walk->deep_depth = depth;
+    }
+    if (walk->stop) {
+        return DMVFS_WALK_STOP;
+    }
+    if (walk->prune != NULL && is_dir && strcmp(path, walk->prune) == 0) {
+        return DMVFS_WALK_PRUNE;
+    }
+    return DMVFS_WALK_CONTINUE;
+}
+
+bool test_walk(void)
+{
+    TEST_START("Recursive tree walk");
+
+    if (!dmvfs_mount_fs(test_module_name, "/wlk", NULL)) {
+        TEST_FAIL("Cannot mount file system for the walk");
+        return false;
+    }
+    bool setup_ok = dmvfs_mkdir("/wlk/a", 0) == DMFSI_OK &&
+                    dmvfs_mkdir("/wlk/a/b", 0) == DMFSI_OK &&
+                    dmvfs_write_file_atomic("/wlk/f1.txt", "1", 1) == DMFSI_OK &&
+                    dmvfs_write_file_atomic("/wlk/a/f2.txt", "2", 1) == DMFSI_OK &&
+                    dmvfs_write_file_atomic("/wlk/a/b/f3.txt", "3", 1) == DMFSI_OK;
+
+    test_walk_t all = {0};
+    int all_count = setup_ok ? dmvfs_walk("/wlk", 0, 0, test_walk_callback, &all) : -1;
+
+    // The root directory is not mounted, its entries are the mount points
+    test_walk_t mounts = { .only = "/wlk" };
+    int mounts_count = dmvfs_walk("/", 0, DMVFS_WALK_MOUNTS, test_walk_callback, &mounts);
+
+    test_walk_t shallow = {0};
+    int shallow_count = dmvfs_walk("/wlk", 1, 0, test_walk_callback, &shallow);
+
+    test_walk_t pruned = { .prune = "/wlk/a" };
+    int pruned_count = dmvfs_walk("/wlk", 0, 0, test_walk_callback, &pruned);
+
+    test_walk_t dirs = {0};
+    int dirs_count = dmvfs_walk("/wlk", 0, DMVFS_WALK_DIRS_ONLY, test_walk_callback, &dirs);
+
+    // A walk can be driven by several calls of dmvfs_walk_run
+    test_walk_t stopped = { .stop = true };
+    dmvfs_walk_t* walk = dmvfs_walk_open("/wlk", 0, 0, test_walk_callback, &stopped);
+    bool run_ok = walk != NULL && dmvfs_walk_run(walk) == 0 && dmvfs_walk_run(walk) == 0;
+    int stopped_count = dmvfs_walk_close(walk);
+
+    bool missing_ok = dmvfs_walk("/wlk/missing", 0, 0, NULL, NULL) < 0;
+
+    // The path of the mount point itself is the root directory of its file system
+    bool mount_root_ok = dmvfs_direxists("/wlk") == 1;
+
+    dmvfs_unlink("/wlk/a/b/f3.txt");
+    dmvfs_unlink("/wlk/a/f2.txt");
+    dmvfs_unlink("/wlk/f1.txt");
+    dmvfs_unmount_fs("/wlk");
+
+    if (!setup_ok) {
+        TEST_FAIL("Cannot create the directory tree");
+        return false;
+    }
+    if (all_count != 5 || all.calls != 5 || all.dirs != 2 || all.deep_depth != 3) {
+        TEST_FAIL("Wrong entries reported by the walk");
+        return false;
+    }
+    if (mounts_count < 6 || mounts.calls != 6 || mounts.dirs != 3 || mounts.deep_depth != 4) {
+        TEST_FAIL("Mount points not walked");
+        return false;
+    }
+    if (shallow_count != 2 || pruned_count != 2 || pruned.calls != 2) {
+        TEST_FAIL("Depth limit or pruning not respected");
+        return false;
+    }
+    if (dirs_count != 5 || dirs.calls != 2) {
+        TEST_FAIL("Files reported in directory-only walk");
+        return false;
+    }
+    if (!run_ok || stopped_count != 1 || stopped.calls != 1) {
+        TEST_FAIL("Walk not stopped by the callback");
+        return false;
+    }
+    if (!missing_ok) {
+        TEST_FAIL("Walk of a missing directory succeeded");
+        return false;
+    }
+    if (!mount_root_ok) {
+        TEST_FAIL("Mount point path not resolved to the root of its file system");
+        return false;
+    }
+
+    TEST_PASS();
+    return true;
+}
+
+typedef struct {
+    int calls;
+    bool cancel;
+} test_tree_progress_t;
+
+static bool test_tree_progress(const char* path, const dmvfs_tree_stats_t* stats, void* arg)
+{
+    (void)path;
+    (void)stats;
+    test_tree_progress_t* progress = (test_tree_progress_t*)arg;
+    progress->calls++;
+    return !progress->cancel;
+}
+
+bool test_tree_copy_remove(void)
+{
+    TEST_START("Recursive copy and removal");
+
+    if (!dmvfs_mount_fs(test_module_name, "/tr1", NULL) || !dmvfs_mount_fs(test_module_name, "/tr2", NULL)) {
+        TEST_FAIL("Cannot mount file systems for the trees");
+        return false;
+    }
+
+    static uint8_t data[300];
+    memset(data, 0x5A, sizeof(data));
+    bool setup_ok = dmvfs_mkdir("/tr1/src", 0) == DMFSI_OK &&
+                    dmvfs_mkdir("/tr1/src/a", 0) == DMFSI_OK &&
+                    dmvfs_mkdir("/tr1/src/a/b", 0) == DMFSI_OK &&
+                    dmvfs_write_file_atomic("/tr1/src/x.bin", data, 100) == DMFSI_OK &&
+                    dmvfs_write_file_atomic("/tr1/src/a/y.bin", data, 200) == DMFSI_OK &&
+                    dmvfs_write_file_atomic("/tr1/src/a/b/z.bin", data, 300) == DMFSI_OK;
+
+    // Cross-mount copy of the whole tree
+    test_tree_progress_t copy_progress = {0};
+    dmvfs_tree_stats_t copy_stats = {0};
+    int ret = setup_ok ? dmvfs_copy_tree("/tr1/src", "/tr2/dst", test_tree_progress, &copy_progress, &copy_stats) : -1;
+    dmfsi_stat_t stat = {0};
+    bool copy_ok = ret == DMFSI_OK && copy_stats.files == 3 && copy_stats.dirs == 3 && copy_stats.bytes == 600 &&
+                   copy_progress.calls == 5 && dmvfs_stat("/tr2/dst/a/b/z.bin", &stat) == DMFSI_OK && stat.size == 300;
+    bool itself_ok = dmvfs_copy_tree("/tr1/src", "/tr1/src/a/c", NULL, NULL, NULL) < 0;
+
+    // A cancelled removal leaves the rest of the tree in place
+    test_tree_progress_t cancel_progress = { .cancel = true };
+    bool cancel_ok = dmvfs_remove_tree("/tr2/dst", test_tree_progress, &cancel_progress, NULL) < 0 &&
+                     cancel_progress.calls == 1 && dmvfs_direxists("/tr2/dst") == 1;
+    bool rest_ok = dmvfs_remove_tree("/tr2/dst", NULL, NULL, NULL) == DMFSI_OK && dmvfs_direxists("/tr2/dst") == 0;
+
+    dmvfs_tree_stats_t remove_stats = {0};
+    ret = dmvfs_remove_tree("/tr1/src", NULL, NULL, &remove_stats);
+    bool remove_ok = ret == DMFSI_OK && remove_stats.files == 3 && remove_stats.dirs == 3 &&
+                     remove_stats.bytes == 600 && dmvfs_direxists("/tr1/src") == 0;
+
+    dmvfs_unmount_fs("/tr2");
+    dmvfs_unmount_fs("/tr1");
+
+    if (!setup_ok) {
+        TEST_FAIL("Cannot create the directory tree");
+        return false;
+    }
+    if (!copy_ok || !itself_ok) {
+        TEST_FAIL("Tree copy failed");
+        return false;
+    }
+    if (!cancel_ok || !rest_ok) {
+        TEST_FAIL("Cancelled removal not handled");
+        return false;
+    }
+    if (!remove_ok) {
+        TEST_FAIL("Tree removal failed");
+        return false;
+    }
+
+    TEST_PASS();
+    return true;
+}
+
+typedef struct {
+    int matches;
+    int limit;
+    bool deep_found;
+} test_glob_t;
+
+static bool test_glob_callback(const char* path, const dmfsi_dir_entry_t* entry, void* arg)
+{
+    (void)entry;
+    test_glob_t* glob = (test_glob_t*)arg;
+    glob->matches++;
+    if (strcmp(path, "/glb/logs/old/deep/e.bin") == 0) {
+        glob->deep_found = true;
+    }
+    return glob->limit == 0 || glob->matches < glob->limit;
+}
+
+static int test_prefix_calls;
+static char test_prefix_seen[16];
+
+static int test_readdir_prefix(dmfsi_context_t ctx, void* dir, const char* prefix, dmfsi_dir_entry_t* entry)
+{
+    (void)ctx;
+    (void)dir;
+    // Pretend the backend answers the query from an index of two entries
+    static const char* names[] = { "pre_one", "pre_two" };
+    if (test_prefix_calls >= 2) {
+        return DMFSI_ERR_NOT_FOUND;
+    }
+    strncpy(test_prefix_seen, prefix, sizeof(test_prefix_seen) - 1);
+    memset(entry, 0, sizeof(*entry));
+    strcpy(entry->name, names[test_prefix_calls++]);
+    return DMFSI_OK;
+}
+
+bool test_glob(void)
+{
+    TEST_START("Glob pattern search");
+
+    if (!dmvfs_mount_fs(test_module_name, "/glb", NULL)) {
+        TEST_FAIL("Cannot mount file system for the search");
+        return false;
+    }
+    bool setup_ok = dmvfs_mkdir("/glb/logs", 0) == DMFSI_OK &&
+                    dmvfs_mkdir("/glb/logs/old", 0) == DMFSI_OK &&
+                    dmvfs_mkdir("/glb/logs/old/deep", 0) == DMFSI_OK &&
+                    dmvfs_write_file_atomic("/glb/logs/a.bin", "a", 1) == DMFSI_OK &&
+                    dmvfs_write_file_atomic("/glb/logs/b.bin", "b", 1) == DMFSI_OK &&
+                    dmvfs_write_file_atomic("/glb/logs/c.txt", "c", 1) == DMFSI_OK &&
+                    dmvfs_write_file_atomic("/glb/logs/old/d.bin", "d", 1) == DMFSI_OK &&
+                    dmvfs_write_file_atomic("/glb/logs/old/deep/e.bin", "e", 1) == DMFSI_OK;
+
+    bool wildcard_ok = setup_ok &&
+                       dmvfs_glob("/glb/logs/*.bin", NULL, NULL) == 2 &&
+                       dmvfs_glob("/glb/logs/?.txt", NULL, NULL) == 1 &&
+                       dmvfs_glob("/glb/logs/[ab].bin", NULL, NULL) == 2 &&
+                       dmvfs_glob("/glb/logs/[!a-b].*", NULL, NULL) == 1 &&
+                       dmvfs_glob("/glb/*/old/d.bin", NULL, NULL) == 1 &&
+                       dmvfs_glob("/glb/logs/*.xyz", NULL, NULL) == 0 &&
+                       dmvfs_glob("/glb/logs/old/deep/e.bin", NULL, NULL) == 1;
+
+    test_glob_t recursive = {0};
+    bool recursive_ok = dmvfs_glob("/glb/**/*.bin", test_glob_callback, &recursive) == 4 &&
+                        recursive.matches == 4 && recursive.deep_found &&
+                        dmvfs_glob("/glb/logs/**", NULL, NULL) == 7;
+
+    test_glob_t limited = { .limit = 1 };
+    bool stop_ok = dmvfs_glob("/glb/logs/*", test_glob_callback, &limited) == 1 && limited.matches == 1;
+
+    // A backend with an index answers the prefix query itself
+    dmvfs_mount_ops_t ops = {0};
+    ops.readdir_prefix = test_readdir_prefix;
+    bool pushdown_ok = dmvfs_set_mount_ops("/glb", &ops) &&
+                       dmvfs_glob("/glb/pre*", NULL, NULL) == 2 &&
+                       test_prefix_calls == 2 && strcmp(test_prefix_seen, "pre") == 0;
+    ops.readdir_prefix = NULL;
+    dmvfs_set_mount_ops("/glb", &ops);
+
+    dmvfs_remove_tree("/glb/logs", NULL, NULL, NULL);
+    dmvfs_unmount_fs("/glb");
+
+    if (!setup_ok) {
+        TEST_FAIL("Cannot create the directory tree");
+        return false;
+    }
+    if (!wildcard_ok) {
+        TEST_FAIL("Wrong matches of a wildcard pattern");
+        return false;
+    }
+    if (!recursive_ok) {
+        TEST_FAIL("Wrong matches of a recursive pattern");
+        return false;
+    }
+    if (!stop_ok) {
+        TEST_FAIL("Search not stopped by the callback");
+        return false;
+    }
+    if (!pushdown_ok) {
+        TEST_FAIL("Prefix query not passed to the backend");
+        return false;
+    }
+
+    TEST_PASS();
+    return true;
+}
+
+// -----------------------------------------
+//
+//      Test: Nested mount points
+//
+// -----------------------------------------
+bool test_nested_mounts(void)
+{
+    TEST_START("Nested mount points");
+
+    if (!dmvfs_mount_fs(test_module_name, "/nst", NULL)) {
+        TEST_FAIL("Cannot mount outer file system");
+        return false;
+    }
+    if (!dmvfs_mount_fs(test_module_name, "/nst/in", NULL)) {
+        dmvfs_unmount_fs("/nst");
+        TEST_FAIL("Cannot mount inner file system");
+        return false;
+    }
+
+    char cwd[64] = {0};
+    dmfsi_stat_t stat;
+    bool cwd_saved = dmvfs_getcwd(cwd, sizeof(cwd)) == 0;
+    bool absolute_ok = dmvfs_write_file_atomic("/nst/in/a.txt", "a", 1) == DMFSI_OK &&
+                       dmvfs_stat("/nst/in/a.txt", &stat) == DMFSI_OK;
+    bool relative_ok = cwd_saved && dmvfs_chdir("/nst/in") == DMFSI_OK &&
+                       dmvfs_stat("a.txt", &stat) == DMFSI_OK;
+    if (cwd_saved) {
+        dmvfs_chdir(cwd);
+    }
+
+    // The file has to be stored by the inner mount point, not the outer one
+    dmvfs_unmount_fs("/nst/in");
+    bool inner_ok = dmvfs_stat("/nst/in/a.txt", &stat) != DMFSI_OK;
+    dmvfs_unmount_fs("/nst");
+
+    if (!absolute_ok || !inner_ok) {
+        TEST_FAIL("Path not resolved by the longest mount point");
+        return false;
+    }
+    if (!relative_ok) {
+        TEST_FAIL("Relative path not resolved by the longest mount point");
+        return false;
+    }
+
+    TEST_PASS();
+    return true;
+}
+
 // -----------------------------------------
 //
 //      Run all tests
@@ -643,6 +1981,48 @@ void run_all_tests(void)
         
         TEST_START("Directory creation visibility");
         TEST_SKIP("Read-only mode");
+        TEST_START("Per-process working directory");
+        TEST_SKIP("Read-only mode");
+        TEST_START("Trace capture");
+        TEST_SKIP("Read-only mode");
+        TEST_START("Mount capabilities");
+        TEST_SKIP("Read-only mode");
+        TEST_START("Allocator statistics");
+        TEST_SKIP("Read-only mode");
+        TEST_START("Static memory arena");
+        TEST_SKIP("Read-only mode");
+        TEST_START("Unmount modes");
+        TEST_SKIP("Read-only mode");
+        TEST_START("I/O scheduler");
+        TEST_SKIP("Read-only mode");
+        TEST_START("I/O throttling");
+        TEST_SKIP("Read-only mode");
+        TEST_START("Write coalescing");
+        TEST_SKIP("Read-only mode");
+        TEST_START("Bounce buffer pool");
+        TEST_SKIP("Read-only mode");
+        TEST_START("Open-handle cache");
+        TEST_SKIP("Read-only mode");
+        TEST_START("Directory-relative operations");
+        TEST_SKIP("Read-only mode");
+        TEST_START("Whole-file read");
+        TEST_SKIP("Read-only mode");
+        TEST_START("Atomic whole-file write");
+        TEST_SKIP("Read-only mode");
+        TEST_START("Copy and move between mounts");
+        TEST_SKIP("Read-only mode");
+        TEST_START("Sendfile between handles");
+        TEST_SKIP("Read-only mode");
+        TEST_START("File hashing");
+        TEST_SKIP("Read-only mode");
+        TEST_START("Recursive tree walk");
+        TEST_SKIP("Read-only mode");
+        TEST_START("Recursive copy and removal");
+        TEST_SKIP("Read-only mode");
+        TEST_START("Glob pattern search");
+        TEST_SKIP("Read-only mode");
+        TEST_START("Nested mount points");
+        TEST_SKIP("Read-only mode");
     } else {
         // Full test suite for writable filesystems
         test_file_open_close();
@@ -657,6 +2037,27 @@ void run_all_tests(void)
         test_directory_operations();
         test_directory_listing();
         test_directory_creation_and_listing();
+        test_process_cwd();
+        test_trace_capture();
+        test_mount_caps();
+        test_alloc_stats();
+        test_static_arena();
+        test_unmount_modes();
+        test_io_sched();
+        test_throttle();
+        test_write_coalescing();
+        test_bounce_pool();
+        test_handle_cache();
+        test_at_operations();
+        test_read_file();
+        test_write_file_atomic();
+        test_copy_move();
+        test_sendfile();
+        test_hash_file();
+        test_walk();
+        test_tree_copy_remove();
+        test_glob();
+        test_nested_mounts();
     }
     
     // Print summary
@@ -737,6 +2138,7 @@ int main( int argc, char *argv[] )
     }
 
     const char* module_name = Dmod_GetName( context );
+    test_module_name = module_name;
     printf("Module '%s' loaded and enabled successfully.\n", module_name);
 
     if (!dmvfs_init( 16, 32 ))
@@ -93,6 +93,7 @@ typedef struct {
 typedef struct {
     int dir_index;
     int entry_pos;
+    int subdir_pos;
     int open;
 } testfs_dp_t;
 
@@ -146,6 +147,25 @@ int dmod_deinit(void)
     return 0;
 }
 
+// Helper: remove a file and its directory entry
+static void testfs_remove_file(testfs_context_t* fs, int file_index) {
+    fs->files[file_index].used = 0;
+    fs->file_count--;
+    // Remove from directory
+    for (int d = 0; d < TESTFS_MAX_DIRS; ++d) {
+        if (fs->dirs[d].used) {
+            for (int e = 0; e < fs->dirs[d].file_count; ++e) {
+                if (fs->dirs[d].file_indices[e] == file_index) {
+                    for (int k = e; k < fs->dirs[d].file_count - 1; ++k)
+                        fs->dirs[d].file_indices[k] = fs->dirs[d].file_indices[k+1];
+                    fs->dirs[d].file_count--;
+                    break;
+                }
+            }
+        }
+    }
+}
+
 // Helper: find directory by path
 static int testfs_find_dir(testfs_context_t* fs, const char* path) {
     for (int i = 0; i < TESTFS_MAX_DIRS; ++i) {
@@ -372,6 +392,7 @@ dmod_dmfsi_dif_api_declaration( 1.0, testfs, int, _opendir, (dmfsi_context_t ctx
     if (!handle) return DMFSI_ERR_GENERAL;
     handle->dir_index = dir_index;
     handle->entry_pos = 0;
+    handle->subdir_pos = 0;
     handle->open = 1;
     *dp = handle;
     return DMFSI_OK;
@@ -386,7 +407,26 @@ dmod_dmfsi_dif_api_declaration( 1.0, testfs, int, _readdir, (dmfsi_context_t ctx
     testfs_dp_t* handle = (testfs_dp_t*)dp;
     testfs_context_t* fs = &ctx->ramfs;
     testfs_dir_t* dir = &fs->dirs[handle->dir_index];
-    if (handle->entry_pos >= dir->file_count) return DMFSI_ERR_NOT_FOUND;
+    if (handle->entry_pos >= dir->file_count) {
+        // Files first, then the subdirectories of this directory
+        char parent[TESTFS_MAX_DIRNAME];
+        char name[TESTFS_MAX_FILENAME];
+        while (handle->subdir_pos < TESTFS_MAX_DIRS) {
+            testfs_dir_t* sub = &fs->dirs[handle->subdir_pos++];
+            if (!sub->used || !testfs_split_path(sub->name, parent, name)) continue;
+            if (name[0] == '\0' || testfs_strcmp(parent, dir->name) != 0) continue;
+            testfs_strncpy(entry->name, sub->name, sizeof(entry->name));
+            entry->size = 0;
+#ifdef DMFSI_ATTR_DIRECTORY
+            entry->attr = DMFSI_ATTR_DIRECTORY;
+#else
+            entry->attr = 0;
+#endif
+            entry->time = 0;
+            return DMFSI_OK;
+        }
+        return DMFSI_ERR_NOT_FOUND;
+    }
     int file_idx = dir->file_indices[handle->entry_pos];
     testfs_file_t* file = &fs->files[file_idx];
     testfs_strncpy(entry->name, file->name, sizeof(entry->name));
@@ -466,22 +506,23 @@ dmod_dmfsi_dif_api_declaration( 1.0, testfs, int, _unlink, (dmfsi_context_t ctx,
             break;
         }
     }
-    if (file_index == -1) return DMFSI_ERR_NOT_FOUND;
-    fs->files[file_index].used = 0;
-    fs->file_count--;
-    // Remove from directory
-    for (int d = 0; d < TESTFS_MAX_DIRS; ++d) {
-        if (fs->dirs[d].used) {
-            for (int e = 0; e < fs->dirs[d].file_count; ++e) {
-                if (fs->dirs[d].file_indices[e] == file_index) {
-                    for (int k = e; k < fs->dirs[d].file_count - 1; ++k)
-                        fs->dirs[d].file_indices[k] = fs->dirs[d].file_indices[k+1];
-                    fs->dirs[d].file_count--;
-                    break;
-                }
-            }
+    if (file_index == -1) {
+        // DMVFS removes directories with unlink, only empty ones can go
+        int dir_index = testfs_find_dir(fs, path);
+        if (dir_index <= 0) return DMFSI_ERR_NOT_FOUND;
+        if (fs->dirs[dir_index].file_count != 0) return DMFSI_ERR_GENERAL;
+        char parent[TESTFS_MAX_DIRNAME];
+        char name[TESTFS_MAX_FILENAME];
+        for (int i = 0; i < TESTFS_MAX_DIRS; ++i) {
+            if (fs->dirs[i].used && testfs_split_path(fs->dirs[i].name, parent, name) &&
+                name[0] != '\0' && testfs_strcmp(parent, path) == 0)
+                return DMFSI_ERR_GENERAL;
         }
+        fs->dirs[dir_index].used = 0;
+        fs->dir_count--;
+        return DMFSI_OK;
     }
+    testfs_remove_file(fs, file_index);
     return DMFSI_OK;
 }
 
@@ -491,6 +532,13 @@ dmod_dmfsi_dif_api_declaration( 1.0, testfs, int, _rename, (dmfsi_context_t ctx,
     testfs_context_t* fs = &ctx->ramfs;
     for (int i = 0; i < TESTFS_MAX_FILES; ++i) {
         if (fs->files[i].used && testfs_strcmp(fs->files[i].name, oldpath) == 0) {
+            // Like POSIX rename, replace an existing file with the new name
+            for (int j = 0; j < TESTFS_MAX_FILES; ++j) {
+                if (j != i && fs->files[j].used && testfs_strcmp(fs->files[j].name, newpath) == 0) {
+                    testfs_remove_file(fs, j);
+                    break;
+                }
+            }
             testfs_strncpy(fs->files[i].name, newpath, TESTFS_MAX_FILENAME);
             return DMFSI_OK;
         }
@@ -0,0 +1,488 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include "dmod.h"
+#include "dmvfs.h"
+
+#define MAX_REPLAY_BUFFER   (1024 * 1024)
+
+// Statistics of replayed operations
+typedef struct {
+    uint32_t count;
+    uint64_t recorded_us;
+    uint64_t replayed_us;
+    uint64_t replayed_max_us;
+} OpStats;
+
+static const char* op_names[DMVFS_TRACE_OP_COUNT] = {
+    [DMVFS_TRACE_OP_NONE]       = "none",
+    [DMVFS_TRACE_OP_FOPEN]      = "fopen",
+    [DMVFS_TRACE_OP_FCLOSE]     = "fclose",
+    [DMVFS_TRACE_OP_FREAD]      = "fread",
+    [DMVFS_TRACE_OP_FWRITE]     = "fwrite",
+    [DMVFS_TRACE_OP_LSEEK]      = "lseek",
+    [DMVFS_TRACE_OP_FTELL]      = "ftell",
+    [DMVFS_TRACE_OP_FEOF]       = "feof",
+    [DMVFS_TRACE_OP_FFLUSH]     = "fflush",
+    [DMVFS_TRACE_OP_ERROR]      = "error",
+    [DMVFS_TRACE_OP_REMOVE]     = "remove",
+    [DMVFS_TRACE_OP_RENAME]     = "rename",
+    [DMVFS_TRACE_OP_IOCTL]      = "ioctl",
+    [DMVFS_TRACE_OP_SYNC]       = "sync",
+    [DMVFS_TRACE_OP_STAT]       = "stat",
+    [DMVFS_TRACE_OP_GETC]       = "getc",
+    [DMVFS_TRACE_OP_PUTC]       = "putc",
+    [DMVFS_TRACE_OP_CHMOD]      = "chmod",
+    [DMVFS_TRACE_OP_UTIME]      = "utime",
+    [DMVFS_TRACE_OP_UNLINK]     = "unlink",
+    [DMVFS_TRACE_OP_MKDIR]      = "mkdir",
+    [DMVFS_TRACE_OP_RMDIR]      = "rmdir",
+    [DMVFS_TRACE_OP_CHDIR]      = "chdir",
+    [DMVFS_TRACE_OP_OPENDIR]    = "opendir",
+    [DMVFS_TRACE_OP_READDIR]    = "readdir",
+    [DMVFS_TRACE_OP_CLOSEDIR]   = "closedir",
+    [DMVFS_TRACE_OP_DIREXISTS]  = "direxists",
+};
+
+// -----------------------------------------
+//
+//      Prints usage message
+//
+// -----------------------------------------
+void PrintUsage( const char* AppName )
+{
+    printf("Usage: %s dump path/to/trace.bin\n", AppName);
+    printf("       %s replay [--no-timing] path/to/trace.bin path/to/file.dmf\n", AppName);
+}
+
+// -----------------------------------------
+//
+//      Prints help message
+//
+// -----------------------------------------
+void PrintHelp( const char* AppName )
+{
+    printf("-- DMVFS Trace Tool ver. " DMOD_VERSION_STRING " --\n\n");
+    printf("This tool dumps traces saved by dmvfs_trace_save() and replays\n");
+    printf("them against a file system module mounted at /mnt\n\n");
+    PrintUsage(AppName);
+    printf("Options:\n");
+    printf("  -h, --help                  Print this help message\n");
+    printf("  --no-timing                 Replay as fast as possible instead of\n");
+    printf("                              reproducing the recorded time gaps\n");
+}
+
+// -----------------------------------------
+//
+//      Returns name of the operation
+//
+// -----------------------------------------
+static const char* OpName( uint16_t op )
+{
+    if (op < DMVFS_TRACE_OP_COUNT && op_names[op] != NULL) {
+        return op_names[op];
+    }
+    return "unknown";
+}
+
+// -----------------------------------------
+//
+//      Returns host time in microseconds
+//
+// -----------------------------------------
+static uint64_t HostTimeUs( void )
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+// -----------------------------------------
+//
+//      Loads trace file to memory
+//
+// -----------------------------------------
+static dmvfs_trace_entry_t* LoadTrace( const char* path, dmvfs_trace_header_t* header )
+{
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        printf("Cannot open trace file: %s\n", path);
+        return NULL;
+    }
+
+    if (fread(header, sizeof(*header), 1, file) != 1 ||
+        header->magic != DMVFS_TRACE_MAGIC ||
+        header->version != DMVFS_TRACE_VERSION ||
+        header->entry_size != sizeof(dmvfs_trace_entry_t)) {
+        printf("Invalid trace file: %s\n", path);
+        fclose(file);
+        return NULL;
+    }
+
+    dmvfs_trace_entry_t* entries = calloc(header->count + 1, sizeof(dmvfs_trace_entry_t));
+    if (entries == NULL || fread(entries, sizeof(dmvfs_trace_entry_t), header->count, file) != header->count) {
+        printf("Cannot read %u records from trace file: %s\n", (unsigned)header->count, path);
+        free(entries);
+        fclose(file);
+        return NULL;
+    }
+
+    fclose(file);
+    return entries;
+}
+
+// -----------------------------------------
+//
+//      Dumps trace records
+//
+// -----------------------------------------
+static int DumpTrace( const char* path )
+{
+    dmvfs_trace_header_t header;
+    dmvfs_trace_entry_t* entries = LoadTrace(path, &header);
+    if (entries == NULL) {
+        return -1;
+    }
+
+    printf("Records: %u, dropped: %u\n\n", (unsigned)header.count, (unsigned)header.dropped);
+    printf("%10s %14s %10s %6s %-10s %5s %6s %10s %10s %8s\n",
+           "seq", "timestamp", "duration", "pid", "op", "mount", "handle", "size", "arg", "result");
+    for (uint32_t i = 0; i < header.count; i++) {
+        const dmvfs_trace_entry_t* e = &entries[i];
+        printf("%10u %14llu %10u %6d %-10s %5d %6d %10lld %10d %8d\n",
+               (unsigned)e->sequence, (unsigned long long)e->timestamp, (unsigned)e->duration,
+               (int)e->pid, OpName(e->op), (int)e->mount_index, (int)e->handle,
+               (e->op == DMVFS_TRACE_OP_LSEEK) ? (long long)e->offset : (long long)e->size,
+               (int)e->arg, (int)e->result);
+    }
+
+    free(entries);
+    return 0;
+}
+
+// -----------------------------------------
+//
+//      Creates the replay files
+//
+//      The trace does not contain file data, so every handle is
+//      replayed on its own file that is filled with zeros up to the
+//      largest offset the traced handle reached. Otherwise each replayed
+//      read would hit an empty file.
+//
+// -----------------------------------------
+static bool PresizeFiles( const dmvfs_trace_entry_t* entries, uint32_t count, uint32_t max_handles, void* buffer )
+{
+    int64_t* positions = calloc(max_handles, sizeof(int64_t));
+    int64_t* extents = calloc(max_handles, sizeof(int64_t));
+    if (positions == NULL || extents == NULL) {
+        free(positions);
+        free(extents);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        const dmvfs_trace_entry_t* e = &entries[i];
+        if (e->handle < 0 || (uint32_t)e->handle >= max_handles) {
+            continue;
+        }
+
+        int64_t* position = &positions[e->handle];
+        int64_t* extent = &extents[e->handle];
+        int64_t moved = 0;
+        switch (e->op) {
+            case DMVFS_TRACE_OP_FOPEN:
+                *position = (e->arg & DMFSI_O_APPEND) ? *extent : 0;
+                break;
+            case DMVFS_TRACE_OP_LSEEK:
+                if (e->result >= 0) {
+                    int64_t base = (e->arg == DMFSI_SEEK_CUR) ? *position :
+                                   (e->arg == DMFSI_SEEK_END) ? *extent : 0;
+                    *position = (base + e->offset > 0) ? base + e->offset : 0;
+                }
+                break;
+            case DMVFS_TRACE_OP_FREAD:
+            case DMVFS_TRACE_OP_FWRITE:
+                moved = (e->arg > 0) ? e->arg : 0;
+                break;
+            case DMVFS_TRACE_OP_GETC:
+            case DMVFS_TRACE_OP_PUTC:
+                moved = (e->result >= 0) ? 1 : 0;
+                break;
+            default:
+                break;
+        }
+        *position += moved;
+        if (*position > *extent) {
+            *extent = *position;
+        }
+    }
+
+    bool success = true;
+    memset(buffer, 0, MAX_REPLAY_BUFFER);
+    for (uint32_t handle = 0; handle < max_handles && success; handle++) {
+        if (extents[handle] == 0) {
+            continue;
+        }
+
+        char path[64];
+        void* fp = NULL;
+        snprintf(path, sizeof(path), "/mnt/trace_%u.bin", (unsigned)handle);
+        if (dmvfs_fopen(&fp, path, DMFSI_O_CREAT | DMFSI_O_WRONLY | DMFSI_O_TRUNC, 0, 0) != 0) {
+            printf("Cannot create replay file: %s\n", path);
+            success = false;
+            break;
+        }
+
+        int64_t left = extents[handle];
+        while (left > 0) {
+            size_t chunk = (left < MAX_REPLAY_BUFFER) ? (size_t)left : MAX_REPLAY_BUFFER;
+            size_t written = 0;
+            if (dmvfs_fwrite(fp, buffer, chunk, &written) != 0 || written == 0) {
+                printf("Cannot fill replay file: %s\n", path);
+                success = false;
+                break;
+            }
+            left -= (int64_t)written;
+        }
+        dmvfs_fclose(fp);
+    }
+
+    free(positions);
+    free(extents);
+    return success;
+}
+
+// -----------------------------------------
+//
+//      Replays a single record
+//
+// -----------------------------------------
+static bool ReplayEntry( const dmvfs_trace_entry_t* e, void** handles, uint32_t max_handles, void* buffer )
+{
+    if (e->handle < 0 || (uint32_t)e->handle >= max_handles) {
+        // Path based operations do not record the path
+        return false;
+    }
+
+    void** fp = &handles[e->handle];
+    char path[64];
+    size_t bytes = 0;
+    size_t size = (e->size < MAX_REPLAY_BUFFER) ? e->size : MAX_REPLAY_BUFFER;
+
+    switch (e->op) {
+        case DMVFS_TRACE_OP_FOPEN:
+            if (*fp != NULL) {
+                dmvfs_fclose(*fp);
+                *fp = NULL;
+            }
+            snprintf(path, sizeof(path), "/mnt/trace_%d.bin", (int)e->handle);
+            dmvfs_fopen(fp, path, e->arg | DMFSI_O_CREAT, 0, e->pid);
+            return true;
+        case DMVFS_TRACE_OP_OPENDIR:
+            if (*fp != NULL) {
+                dmvfs_closedir(*fp);
+                *fp = NULL;
+            }
+            dmvfs_opendir(fp, "/mnt/");
+            return true;
+        default:
+            break;
+    }
+
+    if (*fp == NULL) {
+        return false;
+    }
+
+    switch (e->op) {
+        case DMVFS_TRACE_OP_FCLOSE:     dmvfs_fclose(*fp); *fp = NULL; break;
+        case DMVFS_TRACE_OP_FREAD:      dmvfs_fread(*fp, buffer, size, &bytes); break;
+        case DMVFS_TRACE_OP_FWRITE:     dmvfs_fwrite(*fp, buffer, size, &bytes); break;
+        case DMVFS_TRACE_OP_LSEEK:      dmvfs_lseek(*fp, (long)e->offset, e->arg); break;
+        case DMVFS_TRACE_OP_FTELL:      dmvfs_ftell(*fp); break;
+        case DMVFS_TRACE_OP_FEOF:       dmvfs_feof(*fp); break;
+        case DMVFS_TRACE_OP_FFLUSH:     dmvfs_fflush(*fp); break;
+        case DMVFS_TRACE_OP_ERROR:      dmvfs_error(*fp); break;
+        case DMVFS_TRACE_OP_SYNC:       dmvfs_sync(*fp); break;
+        case DMVFS_TRACE_OP_GETC:       dmvfs_getc(*fp); break;
+        case DMVFS_TRACE_OP_PUTC:       dmvfs_putc(*fp, e->arg); break;
+        case DMVFS_TRACE_OP_READDIR: {
+            dmfsi_dir_entry_t entry;
+            dmvfs_readdir(*fp, &entry);
+            break;
+        }
+        case DMVFS_TRACE_OP_CLOSEDIR:   dmvfs_closedir(*fp); *fp = NULL; break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+// -----------------------------------------
+//
+//      Replays trace against a mounted module
+//
+// -----------------------------------------
+static int ReplayTrace( const char* path, const char* module_path, bool timing )
+{
+    dmvfs_trace_header_t header;
+    dmvfs_trace_entry_t* entries = LoadTrace(path, &header);
+    if (entries == NULL) {
+        return -1;
+    }
+
+    uint32_t max_handles = 1;
+    for (uint32_t i = 0; i < header.count; i++) {
+        if (entries[i].handle >= 0 && (uint32_t)entries[i].handle >= max_handles) {
+            max_handles = (uint32_t)entries[i].handle + 1;
+        }
+    }
+
+    void** handles = calloc(max_handles, sizeof(void*));
+    void* buffer = calloc(1, MAX_REPLAY_BUFFER);
+    if (handles == NULL || buffer == NULL) {
+        printf("Cannot allocate replay buffers\n");
+        free(handles);
+        free(buffer);
+        free(entries);
+        return -1;
+    }
+
+    Dmod_Context_t* context = Dmod_LoadFile( module_path );
+    if (context == NULL || !Dmod_Enable( context, false, NULL )) {
+        printf("Cannot load module: %s\n", module_path);
+        free(handles);
+        free(buffer);
+        free(entries);
+        return -1;
+    }
+
+    const char* module_name = Dmod_GetName( context );
+    if (!dmvfs_init( 16, (int)max_handles ) || !dmvfs_mount_fs( module_name, "/mnt", NULL )) {
+        printf("Cannot mount %s at /mnt\n", module_name);
+        dmvfs_deinit();
+        Dmod_Unload( context, false );
+        free(handles);
+        free(buffer);
+        free(entries);
+        return -1;
+    }
+
+    if (!PresizeFiles(entries, header.count, max_handles, buffer)) {
+        dmvfs_deinit();
+        Dmod_Unload( context, false );
+        free(handles);
+        free(buffer);
+        free(entries);
+        return -1;
+    }
+
+    OpStats stats[DMVFS_TRACE_OP_COUNT];
+    memset(stats, 0, sizeof(stats));
+    uint32_t skipped = 0;
+    uint64_t first_timestamp = (header.count > 0) ? entries[0].timestamp : 0;
+    uint64_t replay_start = HostTimeUs();
+
+    for (uint32_t i = 0; i < header.count; i++) {
+        const dmvfs_trace_entry_t* e = &entries[i];
+        if (e->op >= DMVFS_TRACE_OP_COUNT) {
+            skipped++;
+            continue;
+        }
+
+        if (timing && e->timestamp >= first_timestamp) {
+            uint64_t due = replay_start + (e->timestamp - first_timestamp);
+            uint64_t now = HostTimeUs();
+            if (due > now) {
+                struct timespec delay = { (time_t)((due - now) / 1000000u), (long)((due - now) % 1000000u) * 1000 };
+                nanosleep(&delay, NULL);
+            }
+        }
+
+        uint64_t start = HostTimeUs();
+        if (!ReplayEntry(e, handles, max_handles, buffer)) {
+            skipped++;
+            continue;
+        }
+        uint64_t duration = HostTimeUs() - start;
+
+        OpStats* s = &stats[e->op];
+        s->count++;
+        s->recorded_us += e->duration;
+        s->replayed_us += duration;
+        if (duration > s->replayed_max_us) {
+            s->replayed_max_us = duration;
+        }
+    }
+
+    printf("\n%-10s %8s %14s %14s %14s\n", "op", "count", "recorded avg", "replayed avg", "replayed max");
+    for (int op = 0; op < DMVFS_TRACE_OP_COUNT; op++) {
+        const OpStats* s = &stats[op];
+        if (s->count == 0) {
+            continue;
+        }
+        printf("%-10s %8u %14llu %14llu %14llu\n", OpName((uint16_t)op), (unsigned)s->count,
+               (unsigned long long)(s->recorded_us / s->count),
+               (unsigned long long)(s->replayed_us / s->count),
+               (unsigned long long)s->replayed_max_us);
+    }
+    printf("\nReplayed in %llu us, %u records skipped (path based or without an open handle)\n",
+           (unsigned long long)(HostTimeUs() - replay_start), (unsigned)skipped);
+
+    for (uint32_t i = 0; i < max_handles; i++) {
+        if (handles[i] != NULL) {
+            dmvfs_fclose(handles[i]);
+        }
+    }
+    dmvfs_unmount_fs( "/mnt" );
+    dmvfs_deinit();
+    Dmod_Unload( context, false );
+    free(handles);
+    free(buffer);
+    free(entries);
+    return 0;
+}
+
+// -----------------------------------------
+//
+//      Main function
+//
+// -----------------------------------------
+int main( int argc, char *argv[] )
+{
+    if (argc < 2) {
+        PrintUsage(argv[0]);
+        return 0;
+    }
+
+    if (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0) {
+        PrintHelp(argv[0]);
+        return 0;
+    }
+
+    if (strcmp(argv[1], "dump") == 0 && argc == 3) {
+        return DumpTrace(argv[2]);
+    }
+
+    if (strcmp(argv[1], "replay") == 0) {
+        bool timing = true;
+        const char* trace_path = NULL;
+        const char* module_path = NULL;
+        for (int i = 2; i < argc; i++) {
+            if (strcmp(argv[i], "--no-timing") == 0) {
+                timing = false;
+            } else if (trace_path == NULL) {
+                trace_path = argv[i];
+            } else {
+                module_path = argv[i];
+            }
+        }
+        if (trace_path != NULL && module_path != NULL) {
+            return ReplayTrace(trace_path, module_path, timing);
+        }
+    }
+
+    PrintUsage(argv[0]);
+    return -1;
+}